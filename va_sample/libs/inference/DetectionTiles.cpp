@@ -0,0 +1,56 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DetectionTiles.h"
+
+DetectionTiles::DetectionTiles()
+{
+}
+
+void DetectionTiles::Configure(const TileGrid &grid)
+{
+    m_grid = grid;
+    m_gather.Configure(m_grid.TileNum(), []() { return new VADetections; });
+}
+
+VADetections *DetectionTiles::AddTile(uint32_t channel, uint32_t frame, uint32_t roi, uint32_t tile, const VADetections &boxes)
+{
+    return m_gather.AddTile(channel, frame, roi, tile, [&](VADetections *frameBoxes, bool first) {
+        if (first)
+        {
+            frameBoxes->Clear();
+        }
+        // tile coordinates to frame coordinates
+        uint32_t x, y;
+        m_grid.TileOrigin(tile, &x, &y);
+        float scaleX = (float)m_grid.TileWidth() / m_grid.FrameWidth();
+        float scaleY = (float)m_grid.TileHeight() / m_grid.FrameHeight();
+        float offsetX = (float)x / m_grid.FrameWidth();
+        float offsetY = (float)y / m_grid.FrameHeight();
+        for (size_t i = 0; i < boxes.Size(); i++)
+        {
+            frameBoxes->Push(offsetX + boxes.left[i] * scaleX, offsetY + boxes.top[i] * scaleY,
+                             offsetX + boxes.right[i] * scaleX, offsetY + boxes.bottom[i] * scaleY,
+                             boxes.classId[i], boxes.confidence[i]);
+        }
+    });
+}
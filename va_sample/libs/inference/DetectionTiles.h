@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __DETECTION_TILES_H__
+#define __DETECTION_TILES_H__
+
+#include <stdint.h>
+#include "Detections.h"
+#include "TileGather.h"
+#include "TileGrid.h"
+
+// Gathers the boxes a detection model found in the tiles of a frame, in the normalized coordinates
+// of the frame. An object crossing the border of two tiles is found in both, the caller merges the
+// duplicates with a non maximum suppression. The tiles of a frame can come back in any order and
+// from several inference requests.
+class DetectionTiles
+{
+public:
+    DetectionTiles();
+
+    DetectionTiles(const DetectionTiles&) = delete;
+    DetectionTiles& operator=(const DetectionTiles&) = delete;
+
+    void Configure(const TileGrid &grid);
+
+    // adds the boxes of one tile of an image, in the normalized coordinates of the tile, returns
+    // the boxes of the image once all its tiles are in, nullptr before, they must be given back
+    // with Release()
+    VADetections *AddTile(uint32_t channel, uint32_t frame, uint32_t roi, uint32_t tile, const VADetections &boxes);
+    // a tile whose inference failed, the image gets no boxes, its other tiles are only counted
+    void DropTile(uint32_t channel, uint32_t frame, uint32_t roi, uint32_t tile)
+    {
+        m_gather.DropTile(channel, frame, roi, tile);
+    }
+    void Release(VADetections *boxes) { m_gather.Release(boxes); }
+
+protected:
+    TileGrid m_grid;
+    TileGather<VADetections> m_gather;
+};
+
+#endif //__DETECTION_TILES_H__
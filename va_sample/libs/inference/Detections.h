@@ -0,0 +1,64 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __DETECTIONS_H__
+#define __DETECTIONS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// candidate boxes of one image as a structure of arrays, in normalized coordinates,
+// kept by the inference instance and reused for every image so it doesn't allocate
+struct VADetections
+{
+    std::vector<float> left;
+    std::vector<float> top;
+    std::vector<float> right;
+    std::vector<float> bottom;
+    std::vector<float> confidence;
+    std::vector<int32_t> classId;
+
+    size_t Size() const { return confidence.size(); }
+
+    void Clear()
+    {
+        left.clear();
+        top.clear();
+        right.clear();
+        bottom.clear();
+        confidence.clear();
+        classId.clear();
+    }
+
+    void Push(float l, float t, float r, float b, int32_t c, float conf)
+    {
+        left.push_back(l);
+        top.push_back(t);
+        right.push_back(r);
+        bottom.push_back(b);
+        classId.push_back(c);
+        confidence.push_back(conf);
+    }
+};
+
+#endif //__DETECTIONS_H__
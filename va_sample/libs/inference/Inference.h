@@ -58,14 +58,50 @@ public:
     virtual int InsertImage(const cv::Mat &image, uint32_t channelId, uint32_t frameId, uint32_t roiId) = 0;
     virtual int InsertImage(const int surfID, uint32_t channelId, uint32_t frameId, uint32_t roiId = 0) = 0;
 
+    // inserts the image of a USER_SURFACE data, with zero copy enabled its buffer becomes the request input when
+    // it suits the model, the data is then referenced until the request completes
+    virtual int InsertData(VAData *data) = 0;
+
     virtual int Wait() = 0;
 
-    virtual int GetOutput(std::vector<VAData *> &datas, std::vector<uint32_t> &channels, std::vector<uint32_t> &frames) = 0;
+    // waits up to timeoutUs for a result when all the inference requests are busy
+    virtual int GetOutput(std::vector<VAData *> &datas, std::vector<uint32_t> &channels, std::vector<uint32_t> &frames, uint32_t timeoutUs = 0) = 0;
 
     virtual void GetRequirements(uint32_t *width, uint32_t *height, uint32_t *fourcc) = 0;
 
     virtual void JoinVAContext(void *va_dpy) = 0;
 
+    // wrap the USER_SURFACE buffers in the request inputs instead of copying them, only used with batch 1
+    virtual void EnableZeroCopy(bool enable) {}
+
+    // directory of the compiled models, they are compiled at every load when not set
+    virtual void SetCacheDir(const char *dir) {}
+
+    // a partially filled batch is submitted once its first image waited this long, 0 waits for a full batch
+    virtual void SetMaxBatchDelay(uint32_t us) {}
+
+    // IoU threshold of the non maximum suppression of the detection models, 0 keeps the default of the model,
+    // with crossClass the boxes of different classes suppress each other too
+    virtual void SetNMS(float iouThreshold, bool crossClass) {}
+
+    // number of most likely classes the classification models report per image, with softmax their
+    // scores are turned into probabilities first
+    virtual void SetTopK(uint32_t k, bool softmax) {}
+
+    // frames larger than the model input are split in overlapping tiles of the input size, the
+    // detections of the tiles are merged and the upscaled tiles blended back into one frame,
+    // 0 uses the model input size as the frame size
+    virtual void SetTiling(uint32_t frameWidth, uint32_t frameHeight, uint32_t overlap) {}
+
+    // microseconds before the partial batch gets submitted, -1 if no batch is waiting for images
+    virtual int32_t GetBatchTimeout() { return -1; }
+
+    // true while submitted requests haven't been returned by GetOutput(), their results come without new images
+    virtual bool InFlight() { return false; }
+
+    // waits up to timeoutUs for an in flight request to complete, GetOutput() then returns its results
+    virtual void WaitCompleted(uint32_t timeoutUs) {}
+
 protected:
     InferenceBlock() {};
     virtual ~InferenceBlock() {};
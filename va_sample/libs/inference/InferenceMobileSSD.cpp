@@ -30,6 +30,8 @@ using namespace std;
 using namespace InferenceEngine::details;
 using namespace InferenceEngine;
 
+const float defaultNMSIoUThreshold = 0.5;
+
 InferenceMobileSSD::InferenceMobileSSD():
     m_inputWidth(0),
     m_inputHeight(0),
@@ -92,14 +94,21 @@ int InferenceMobileSSD::Load(const char *device, const char *model, const char *
     m_inputWidth = inputDims[3];
     m_inputHeight = inputDims[2];
 
+    ret = ConfigureTiles("MobileSSD");
+    if (ret)
+    {
+        return ret;
+    }
+    m_tiles.Configure(m_grid);
+
     return 0;
 }
 
 void InferenceMobileSSD::GetRequirements(uint32_t *width, uint32_t *height, uint32_t *fourcc)
 {
     TRACE("");
-    *width = m_inputWidth;
-    *height = m_inputHeight;
+    *width = Tiled() ? m_frameWidth : m_inputWidth;
+    *height = Tiled() ? m_frameHeight : m_inputHeight;
     *fourcc = m_shareSurfaceWithVA?0x3231564e:0x50424752; //MFX_FOURCC_RGBP
 }
 
@@ -124,21 +133,45 @@ void InferenceMobileSSD::CopyImage(const uint8_t *img, void *dst, uint32_t batch
     TRACE("");
 }
 
+void InferenceMobileSSD::DropResults(uint32_t count, uint32_t *channelIds, uint32_t *frameIds, uint32_t *roiIds)
+{
+    if (!Tiled())
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        m_tiles.DropTile(channelIds[i], frameIds[i], TileGrid::RoiOf(roiIds[i]), TileGrid::TileOf(roiIds[i]));
+    }
+}
+
 int InferenceMobileSSD::Translate(std::vector<VAData *> &datas, uint32_t count, void *result, uint32_t *channelIds, uint32_t *frameIds, uint32_t *roiIds)
 {
     TRACE("");
     std::map<std::string, const float*>* curResults = (std::map<std::string, const float*>*) result;
     float* curResult = (float*)curResults->find(m_outputsNames[0])->second;
-    typedef std::vector<VAData *> VADataVector;
-    VADataVector *tempBuffer = new VADataVector[count];
+    if (m_candidates.size() < count)
+    {
+        m_candidates.resize(count);
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_candidates[i].Clear();
+    }
 
     for (int i = 0; i < m_maxResultNum; i ++)
     {
         int imgid = (int)curResult[0];
-        if (imgid < 0 || curResult[2] == 0 || imgid > count)
+        if (imgid < 0 || curResult[2] == 0)
         {
             break;
         }
+        if (imgid >= count)
+        {
+            // padding of a partial batch
+            curResult += m_resultSize;
+            continue;
+        }
         int c = (int)curResult[1];
         float conf = curResult[2];
         if(curResult[2] < m_confidenceThreshold){
@@ -153,20 +186,46 @@ int InferenceMobileSSD::Translate(std::vector<VAData *> &datas, uint32_t count,
         if (t < 0.0) t = 0.0;
         if (r > 1.0) r = 1.0;
         if (b > 1.0) b = 1.0;
-        VAData *data = VAData::Create(l, t, r, b, c, conf);
-        data->SetID(channelIds[imgid], frameIds[imgid]);
-        // ssd model may create multip roi regions for one frame, re-index the rois
-        data->SetRoiIndex(tempBuffer[imgid].size());
-        tempBuffer[imgid].push_back(data);
+        m_candidates[imgid].Push(l, t, r, b, c, conf);
         curResult += m_resultSize;
     }
 
-    for (int i = 0; i < count; i++)
+    // the DetectionOutput layer of the model already suppresses the overlapping boxes of each class,
+    // it is only done again when asked, e.g. across the classes, or to merge the objects found in
+    // several tiles
+    bool suppress = m_nmsIoUThreshold > 0 || m_nmsCrossClass || Tiled();
+    m_nms.SetIoUThreshold(m_nmsIoUThreshold > 0 ? m_nmsIoUThreshold : defaultNMSIoUThreshold);
+    m_nms.SetCrossClass(m_nmsCrossClass);
+
+    for (uint32_t i = 0; i < count; i++)
     {
-        datas.insert(datas.end(), tempBuffer[i].begin(), tempBuffer[i].end());
+        VADetections *tileBoxes = nullptr;
+        if (Tiled())
+        {
+            // the frame goes on with its last tile
+            tileBoxes = m_tiles.AddTile(channelIds[i], frameIds[i], TileGrid::RoiOf(roiIds[i]), TileGrid::TileOf(roiIds[i]), m_candidates[i]);
+            if (!tileBoxes)
+            {
+                continue;
+            }
+        }
+        VADetections &boxes = tileBoxes ? *tileBoxes : m_candidates[i];
+        uint32_t keepNum = boxes.Size();
+        if (suppress)
+        {
+            keepNum = m_nms.Run(boxes, m_keep);
+        }
+        for (uint32_t k = 0; k < keepNum; k++)
+        {
+            uint32_t j = suppress ? m_keep[k] : k;
+            VAData *data = VAData::Create(boxes.left[j], boxes.top[j], boxes.right[j], boxes.bottom[j], boxes.classId[j], boxes.confidence[j]);
+            data->SetID(channelIds[i], frameIds[i]);
+            // ssd model may create multip roi regions for one frame, re-index the rois
+            data->SetRoiIndex(k);
+            datas.push_back(data);
+        }
+        m_tiles.Release(tileBoxes);
     }
 
-    delete[] tempBuffer;
     return 0;
 }
-
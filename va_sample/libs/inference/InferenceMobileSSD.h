@@ -24,6 +24,9 @@
 #define __INFERRENCE_MOBILESSD_H__
 
 #include "InferenceOV.h"
+#include "Detections.h"
+#include "NonMaxSuppression.h"
+#include "DetectionTiles.h"
 
 class InferenceMobileSSD : public InferenceOV
 {
@@ -41,6 +44,7 @@ protected:
 
     // derived classes need to fill VAData by the result, based on their own different output demension
     int Translate(std::vector<VAData *> &datas, uint32_t count, void *result, uint32_t *channels, uint32_t *frames, uint32_t *roiIds);
+    void DropResults(uint32_t count, uint32_t *channels, uint32_t *frames, uint32_t *roiIds);
 
     void SetDataPorts();
 
@@ -53,6 +57,13 @@ protected:
     uint32_t m_channelNum;
     uint32_t m_resultSize; // size per one result
     uint32_t m_maxResultNum; // result number per one request
+
+    // boxes of each image of the batch, reused
+    std::vector<VADetections> m_candidates;
+    NonMaxSuppression m_nms;
+    std::vector<uint32_t> m_keep;
+    // boxes of the tiles of the frames larger than the input
+    DetectionTiles m_tiles;
 };
 
 #endif //__INFERRENCE_MOBILESSD_H__
@@ -22,6 +22,12 @@
 
 #include "InferenceOV.h"
 #include <logs.h>
+#include "DataPacket.h"
+#include <algorithm>
+#include <typeinfo>
+#include <fstream>
+#include <string.h>
+#include <unistd.h>
 #include <cldnn/cldnn_config.hpp>
 
 #include <ie_plugin_config.hpp>
@@ -34,30 +40,73 @@ using namespace InferenceEngine::details;
 using namespace InferenceEngine;
 
 InferenceOV::InferenceOV():
+    m_busyNum(0),
+    m_zeroCopy(false),
+    m_wrappedImages(0),
+    m_copiedImages(0),
+    m_submitSequence(0),
+    m_resultSequence(0),
+    m_frameWidth(0),
+    m_frameHeight(0),
+    m_tileOverlap(0),
+    m_tileChannels(0),
     m_asyncDepth(1),
     m_nStreams(0),
     m_batchNum(1),
-    m_batchIndex(0),
     m_modelInputReshapeWidth(0),
     m_modelInputReshapeHeight(0),
     m_vaDisplay(nullptr),
     m_shareSurfaceWithVA(false),
-    m_confidenceThreshold(0.8)
+    m_confidenceThreshold(0.8),
+    m_nmsIoUThreshold(0),
+    m_nmsCrossClass(false),
+    m_batchIndex(0),
+    m_maxBatchDelay(0),
+    m_batches(0),
+    m_partialBatches(0),
+    m_batchedImages(0),
+    m_totalLatencyMs(0),
+    m_maxLatencyMs(0)
 {
 }
 
 InferenceOV::~InferenceOV()
 {
-    while (m_busyRequest.size() != 0)
+    if (m_batches > 0)
+    {
+        INFO("InferenceOV: %lu batches, %lu partial, fill ratio %.2f, latency avg %.2fms max %.2fms",
+            m_batches, m_partialBatches, (double)m_batchedImages / (m_batches * m_batchNum),
+            m_totalLatencyMs / m_batches, m_maxLatencyMs);
+    }
+    if (m_zeroCopy)
     {
-        Wait();
-        m_busyRequest.pop();
+        INFO("InferenceOV: %lu images wrapped, %lu copied", m_wrappedImages, m_copiedImages);
     }
-    while (m_freeRequest.size() != 0)
     {
-        m_freeRequest.pop();
+        // the completion callbacks must not run after the requests are gone
+        std::unique_lock<std::mutex> lock(m_completedMutex);
+        m_completedCond.wait(lock, [this] { return m_completed.size() >= m_busyNum; });
     }
     m_batchedBlobs.clear();
+
+    for (auto ite = m_requests.begin(); ite != m_requests.end(); ite ++)
+    {
+        ReleaseDatas(*ite);
+        UnwrapInput(*ite);
+    }
+
+    if (m_model)
+    {
+        // give the requests back to the shared network for the next instance
+        std::lock_guard<std::mutex> lock(m_modelsMutex);
+        for (auto ite = m_requests.begin(); ite != m_requests.end(); ite ++)
+        {
+            ite->request->SetCompletionCallback<std::function<void(InferRequest, StatusCode)>>([](InferRequest, StatusCode) {});
+            m_model->freeRequests.push_back(ite->request);
+        }
+        m_requests.clear();
+        m_model.reset();
+    }
 }
 
 int InferenceOV::Initialize(uint32_t batch_num, uint32_t async_depth, uint32_t stream_num, float confidence_threshold,
@@ -75,9 +124,18 @@ int InferenceOV::Initialize(uint32_t batch_num, uint32_t async_depth, uint32_t s
 }
 
 
+std::mutex InferenceOV::m_modelsMutex;
+std::map<std::string, std::weak_ptr<InferenceOV::SharedModel>> InferenceOV::m_models;
+
+InferenceEngine::Core &InferenceOV::GetCore()
+{
+    static InferenceEngine::Core core;
+    return core;
+}
+
 void InferenceOV::IECoreInfo(const char* d)
 {
-    std::map<std::string, Version> vm =  m_ie.GetVersions(d);
+    std::map<std::string, Version> vm =  GetCore().GetVersions(d);
     for(auto p : vm) {
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
         int x = p.second.apiVersion.major;
@@ -92,15 +150,120 @@ void InferenceOV::IECoreInfo(const char* d)
     }
 }
 
+// FNV-1a of the content of the file
+static uint64_t HashFile(const char *filename, uint64_t hash)
+{
+    std::ifstream file(filename, std::ios::binary);
+    char buffer[64 * 1024];
+    while (file)
+    {
+        file.read(buffer, sizeof(buffer));
+        std::streamsize size = file.gcount();
+        for (std::streamsize i = 0; i < size; i ++)
+        {
+            hash = (hash ^ (uint8_t)buffer[i]) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+static uint64_t HashString(const std::string &str, uint64_t hash)
+{
+    for (size_t i = 0; i < str.size(); i ++)
+    {
+        hash = (hash ^ (uint8_t)str[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string InferenceOV::CacheFileName(const char *settings, const char *model, const char *weights, const std::map<std::string, std::string> &config)
+{
+    // the settings hold the device, batch, reshape dimensions and VA sharing, a new model or plugin setting gives a new file
+    uint64_t hash = 14695981039346656037ULL;
+    hash = HashString(settings, hash);
+    hash = HashFile(model, hash);
+    if (weights)
+    {
+        hash = HashFile(weights, hash);
+    }
+    for (auto ite = config.begin(); ite != config.end(); ite ++)
+    {
+        hash = HashString(ite->first + "=" + ite->second + ";", hash);
+    }
+
+    const char *name = strrchr(model, '/');
+    name = name ? name + 1 : model;
+    char filename[64];
+    snprintf(filename, sizeof(filename), ".%016lx.blob", hash);
+    return m_cacheDir + "/" + name + filename;
+}
+
+int InferenceOV::ImportNetwork(const std::string &cacheFile, const char *device, const std::map<std::string, std::string> &config)
+{
+    std::ifstream file(cacheFile, std::ios::binary);
+    if (!file)
+    {
+        return -1;
+    }
+    try {
+        if (m_model->context)
+        {
+            m_model->execNetwork = GetCore().ImportNetwork(file, m_model->context, config);
+        }
+        else
+        {
+            m_model->execNetwork = GetCore().ImportNetwork(file, device, config);
+        }
+    }
+    catch (std::exception &e) {
+        INFO("Failed to import %s, compiling the model: %s", cacheFile.c_str(), e.what());
+        return -1;
+    }
+    return 0;
+}
+
+void InferenceOV::ExportNetwork(const std::string &cacheFile)
+{
+    // written next to the cache file then renamed, a concurrent run never reads a partial file
+    std::string tempFile = cacheFile + "." + std::to_string(getpid());
+    try {
+        std::ofstream file(tempFile, std::ios::binary);
+        m_model->execNetwork.Export(file);
+        file.close();
+        if (!file || rename(tempFile.c_str(), cacheFile.c_str()) != 0)
+        {
+            ERRLOG("Failed to write the model cache %s", cacheFile.c_str());
+            unlink(tempFile.c_str());
+        }
+    }
+    catch (std::exception &e) {
+        // not supported by all the devices, the runtime cache in the same directory is still used
+        INFO("The compiled model can't be exported: %s", e.what());
+        unlink(tempFile.c_str());
+    }
+}
+
 int InferenceOV::Load(const char *device, const char *model, const char *weights)
 {
-    if (m_nStreams > 0)
+    // the instances of the same model type loading the same model with the same settings share the compiled network,
+    // in the process only, the va display sharing the surfaces is part of the key
+    bool shareVA = m_vaDisplay != nullptr && m_shareSurfaceWithVA;
+    char settings[1024];
+    snprintf(settings, sizeof(settings), "%s|%s|%s|%d|%dx%d|%d|%d", typeid(*this).name(), model, device,
+        m_batchNum, m_modelInputReshapeWidth, m_modelInputReshapeHeight, m_nStreams, shareVA);
+    char key[1100];
+    snprintf(key, sizeof(key), "%s|%p", settings, shareVA ? m_vaDisplay : nullptr);
+
+    std::lock_guard<std::mutex> lock(m_modelsMutex);
+    m_model = m_models[key].lock();
+    bool compile = !m_model;
+    if (compile)
     {
-        m_ie.SetConfig({{ CONFIG_KEY(GPU_THROUGHPUT_STREAMS), std::to_string(m_nStreams)}});
+        m_model = std::make_shared<SharedModel>();
+        m_model->network = GetCore().ReadNetwork(model);
+        m_model->network.setBatchSize(m_batchNum);
     }
-    
-    m_network = m_ie.ReadNetwork(model);
-    m_network.setBatchSize(m_batchNum);
+    m_network = m_model->network;
     m_batchNum = m_network.getBatchSize();
 
     INFO("Batch number get from network is %d\n", m_batchNum);
@@ -133,8 +296,12 @@ int InferenceOV::Load(const char *device, const char *model, const char *weights
         m_modelInputReshapeWidth = input_shape[3];//width
     }
 
-    IECoreInfo(device);
+    if (compile)
+    {
+        IECoreInfo(device);
+    }
 
+    // also run by the instances sharing the network, they read their dimensions from it
     SetDataPorts();
     TRACE("SetDataPorts done");
     // ---------------------------Set inputs ------------------------------------------------------	
@@ -156,225 +323,426 @@ int InferenceOV::Load(const char *device, const char *model, const char *weights
     }
 
     // -------------------------Loading model to the plugin-------------------------------------------------
-    //TRACE("---- Loading model to the plugin");
-	//InferenceEngine::ExecutableNetwork exenet;
-    try {
-        if (m_vaDisplay == nullptr || m_shareSurfaceWithVA == false)
-        {   
-            m_execNetwork= m_ie.LoadNetwork(m_network, device, {});
+    if (compile)
+    {
+        auto loadStart = std::chrono::steady_clock::now();
+        std::map<std::string, std::string> config;
+        if (m_nStreams > 0)
+        {
+            if (strncmp(device, "CPU", 3) == 0)
+                config[CONFIG_KEY(CPU_THROUGHPUT_STREAMS)] = std::to_string(m_nStreams);
+            else
+                config[CONFIG_KEY(GPU_THROUGHPUT_STREAMS)] = std::to_string(m_nStreams);
         }
-        else
+        if (shareVA)
         {
             // currently only support nv12 if surface sharing with libva
-            m_sharedContext = gpu::make_shared_context(m_ie, device, m_vaDisplay);
-            m_execNetwork = m_ie.LoadNetwork(m_network, m_sharedContext,
-                {{ GPUConfigParams::KEY_GPU_NV12_TWO_INPUTS, PluginConfigParams::YES } });
+            config[GPUConfigParams::KEY_GPU_NV12_TWO_INPUTS] = PluginConfigParams::YES;
+            m_model->context = gpu::make_shared_context(GetCore(), device, m_vaDisplay);
         }
+
+        std::string cacheFile;
+        if (!m_cacheDir.empty())
+        {
+            // the display pointer changes from run to run, the file name only depends on the settings
+            cacheFile = CacheFileName(settings, model, weights, config);
+        }
+        const char *source = "compiled";
+        if (!cacheFile.empty() && ImportNetwork(cacheFile, device, config) == 0)
+        {
+            source = "imported from the cache";
+        }
+        else
+        {
+            if (!m_cacheDir.empty())
+            {
+                // the runtime also caches what it can't export, like the GPU kernels
+                config[PluginConfigParams::KEY_CACHE_DIR] = m_cacheDir;
+            }
+            try {
+                if (m_model->context)
+                {
+                    m_model->execNetwork = GetCore().LoadNetwork(m_network, m_model->context, config);
+                }
+                else
+                {
+                    m_model->execNetwork = GetCore().LoadNetwork(m_network, device, config);
+                }
+            }
+            catch (InferenceEngine::Exception e) {
+                ERRLOG("Input Model file %s is not supported by current device: %s",  model, device);
+                std::cout<<"   Input Model file"<< model<<" is not supported by current device:"<<device<<std::endl;
+                m_model.reset();
+                return -1;
+            }
+            if (!cacheFile.empty())
+            {
+                ExportNetwork(cacheFile);
+            }
+        }
+        double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+        INFO("%s on %s %s in %.1fms", model, device, source, loadMs);
+        m_models[key] = m_model;
     }
-    catch (InferenceEngine::Exception e) {
-        ERRLOG("Input Model file %s is not supported by current device: %s",  model, device);
-        std::cout<<"   Input Model file"<< model<<" is not supported by current device:"<<device<<std::endl;
-        return -1;
+    else
+    {
+        INFO("Sharing the compiled network of %s on %s", model, device);
     }
+    m_sharedContext = m_model->context;
 
-    for (int i = 0; i < m_asyncDepth; i++)
+    // take the requests left by the instances already destroyed before creating new ones
+    m_requests.resize(m_asyncDepth);
+    for (uint32_t i = 0; i < m_asyncDepth; i++)
     {
-        InferRequest::Ptr request = std::make_shared<InferRequest>(m_execNetwork.CreateInferRequest());
-        m_freeRequest.push(request);
+        Request &slot = m_requests[i];
+        if (m_model->freeRequests.empty())
+        {
+            slot.request = std::make_shared<InferRequest>(m_model->execNetwork.CreateInferRequest());
+        }
+        else
+        {
+            slot.request = m_model->freeRequests.back();
+            m_model->freeRequests.pop_back();
+        }
+        slot.request->SetCompletionCallback<std::function<void(InferRequest, StatusCode)>>(
+            [this, i](InferRequest, StatusCode status) { RequestCompleted(i, status); });
+        slot.inputBlob = slot.request->GetBlob(m_inputName);
+        m_freeRequest.push(i);
     }
 
     return 0;
 }
 
+int InferenceOV::ConfigureTiles(const char *name)
+{
+    if (!Tiled())
+    {
+        return 0;
+    }
+    if (m_shareSurfaceWithVA)
+    {
+        ERRLOG("%s: the tiles need system memory frames", name);
+        return -1;
+    }
+    int ret = m_grid.Configure(m_frameWidth, m_frameHeight, GetInputWidth(), GetInputHeight(), m_tileOverlap);
+    if (ret)
+    {
+        return ret;
+    }
+    InferenceEngine::InputsDataMap inputInfo(m_network.getInputsInfo());
+    m_tileChannels = inputInfo.begin()->second->getTensorDesc().getDims()[1];
+    INFO("%s: %dx%d frames split in %d tiles", name, m_frameWidth, m_frameHeight, m_grid.TileNum());
+    if (m_batchNum < m_grid.TileNum())
+    {
+        INFO("%s: a batch of %d takes all the tiles of a frame in one request", name, m_grid.TileNum());
+    }
+    return 0;
+}
+
 int InferenceOV::InsertImage(const uint8_t *img, uint32_t channelId, uint32_t frameId, uint32_t roiId)
 {
     TRACE("img %p, channelId %d  frameId %d, roiId %d  \n", img, channelId, frameId, roiId);
 
-    if (m_freeRequest.size() == 0)
+    if (Tiled())
     {
-        //std::cout << "Warning: No free worker in Inference now" << std::endl;
-        Wait();
-        GetOutputInternal(m_internalDatas, m_internalChannels, m_internalFrames);
+        // the rows of the planar tiles are gathered from the frame straight into the u8 planar input
+        // of the batches, they fill as many requests as needed
+        uint32_t tileWidth = m_grid.TileWidth();
+        uint32_t tileHeight = m_grid.TileHeight();
+        size_t planeSize = (size_t)m_frameWidth * m_frameHeight;
+        size_t tileSize = (size_t)m_tileChannels * tileWidth * tileHeight;
+        for (uint32_t tile = 0; tile < m_grid.TileNum(); tile ++)
+        {
+            InferRequest::Ptr curRequest = CurrentRequest();
+            UnwrapInput(m_requests[m_freeRequest.front()]);
+            uint8_t *dst = (uint8_t *)curRequest->GetBlob(m_inputName)->buffer() + m_batchIndex * tileSize;
+
+            uint32_t x, y;
+            m_grid.TileOrigin(tile, &x, &y);
+            for (uint32_t c = 0; c < m_tileChannels; c ++)
+            {
+                const uint8_t *src = img + c * planeSize + (size_t)y * m_frameWidth + x;
+                for (uint32_t row = 0; row < tileHeight; row ++, dst += tileWidth, src += m_frameWidth)
+                {
+                    memcpy(dst, src, tileWidth);
+                }
+            }
+            ++ m_copiedImages;
+            ImageInserted(channelId, frameId, TileGrid::TileRoi(roiId, tile));
+        }
+        return 0;
     }
 
-    InferRequest::Ptr curRequest = m_freeRequest.front();
+    InferRequest::Ptr curRequest = CurrentRequest();
+    UnwrapInput(m_requests[m_freeRequest.front()]);
     void *dst = curRequest->GetBlob(m_inputName)->buffer();
 
     CopyImage(img, dst, m_batchIndex);
+    ++ m_copiedImages;
 
-    m_channels.push(channelId);
-    m_frames.push(frameId);
-    m_rois.push(roiId);
+    ImageInserted(channelId, frameId, roiId);
+    return 0;
+}
 
-    ++ m_batchIndex;
-    if (m_batchIndex >= m_batchNum)
+int InferenceOV::InsertData(VAData *data)
+{
+    if (!m_zeroCopy || !CanWrap(data))
     {
-        m_batchIndex = 0;
-        curRequest->StartAsync();
-        m_busyRequest.push(curRequest);
-        m_freeRequest.pop();
+        return InsertImage(data->GetSurfacePointer(), data->ChannelIndex(), data->FrameIndex(), data->RoiIndex());
     }
 
-    return 0;
-}
+    CurrentRequest();
+    Request &slot = m_requests[m_freeRequest.front()];
+    const TensorDesc &desc = slot.inputBlob->getTensorDesc();
+    slot.request->SetBlob(m_inputName, make_shared_blob<uint8_t>(desc, data->GetSurfacePointer()));
+    slot.wrapped = true;
+    ++ m_wrappedImages;
 
-static stopWatch watch;
+    // the producer reuses the buffer once the request released it
+    data->AddRef();
+    slot.datas.push_back(data);
 
+    ImageInserted(data->ChannelIndex(), data->FrameIndex(), data->RoiIndex());
+    return 0;
+}
 
-int InferenceOV::InsertImage(const int surfID, uint32_t channelId, uint32_t frameId, uint32_t roiId)
+bool InferenceOV::CanWrap(VAData *data)
 {
-    TRACE(" surfID %d, channelId %d  frameId %d, roiId %d  \n", surfID, channelId, frameId, roiId);
+    // a batch needs one contiguous input, the images are copied into it
+    if (m_batchNum != 1 || data->Type() != USER_SURFACE)
+    {
+        return false;
+    }
+    const TensorDesc &desc = m_requests[0].inputBlob->getTensorDesc();
+    if (desc.getPrecision() != Precision::U8)
+    {
+        return false;
+    }
+    uint32_t w, h, p, fourcc;
+    data->GetSurfaceInfo(&w, &h, &p, &fourcc);
+    return w == GetInputWidth() && p == w && h == GetInputHeight()
+        && ((uintptr_t)data->GetSurfacePointer() % VA_SURFACE_ALIGNMENT) == 0;
+}
 
-    if (!m_shareSurfaceWithVA)
+void InferenceOV::UnwrapInput(Request &slot)
+{
+    if (slot.wrapped)
     {
-        ERRLOG("VASurface sharing not enabled\n");
-        return -1;
+        slot.request->SetBlob(m_inputName, slot.inputBlob);
+        slot.wrapped = false;
     }
-    if (m_freeRequest.size() == 0)
+}
+
+void InferenceOV::ReleaseDatas(Request &slot)
+{
+    for (auto ite = slot.datas.begin(); ite != slot.datas.end(); ite ++)
     {
-        //std::cout << "Warning: No free worker in Inference now" << std::endl;
-        Wait();
-        GetOutputInternal(m_internalDatas, m_internalChannels, m_internalFrames);
+        (*ite)->DeRef();
     }
+    slot.datas.clear();
+}
 
-    InferRequest::Ptr curRequest = m_freeRequest.front();
-    auto nv12_blob = gpu::make_shared_blob_nv12(GetInputHeight(), GetInputWidth(), m_sharedContext, surfID);
-    m_batchedBlobs.push_back(nv12_blob);
+InferRequest::Ptr InferenceOV::CurrentRequest()
+{
+    while (m_freeRequest.size() == 0)
+    {
+        // whichever request completes first is reused, its results wait in m_results
+        CollectCompleted(WAIT_FREE_REQUEST_US);
+    }
+    return m_requests[m_freeRequest.front()].request;
+}
 
-    m_channels.push(channelId);
-    m_frames.push(frameId);
-    m_rois.push(roiId);
+void InferenceOV::ImageInserted(uint32_t channelId, uint32_t frameId, uint32_t roiId)
+{
+    Request &slot = m_requests[m_freeRequest.front()];
+    if (m_batchIndex == 0)
+    {
+        slot.start = std::chrono::steady_clock::now();
+    }
+    slot.channels.push_back(channelId);
+    slot.frames.push_back(frameId);
+    slot.rois.push_back(roiId);
 
     ++ m_batchIndex;
     if (m_batchIndex >= m_batchNum)
     {
-        m_batchIndex = 0;
-        //startTimer(&watch);
+        SubmitBatch();
+    }
+}
+
+void InferenceOV::SubmitBatch()
+{
+    Request &slot = m_requests[m_freeRequest.front()];
+    if (!m_batchedBlobs.empty())
+    {
+        // pad with the last surface, the results of the padding are not translated
+        while (m_batchedBlobs.size() < m_batchNum)
+        {
+            m_batchedBlobs.push_back(m_batchedBlobs.back());
+        }
         auto blobs = make_shared_blob<BatchedBlob>(m_batchedBlobs);
-        curRequest->SetBlob(m_inputName, blobs);
-        TRACE("StartAsync inference");
-        //stopTimer(&watch);
-        //printf("In inferenceOV, SetBlob takes %fms\n", watch.elapsed);
-        //startTimer(&watch);
-        curRequest->StartAsync();
-        //stopTimer(&watch);
-        //printf("In inferenceOV, StartAsync takes %fms\n", watch.elapsed);
-        m_busyRequest.push(curRequest);
-        m_freeRequest.pop();
+        slot.request->SetBlob(m_inputName, blobs);
         m_batchedBlobs.clear();
     }
-    return 0;
+    if (m_batchIndex < m_batchNum)
+    {
+        ++ m_partialBatches;
+    }
+    m_batchIndex = 0;
+
+    slot.sequence = m_submitSequence ++;
+    m_freeRequest.pop();
+    ++ m_busyNum;
+    TRACE("StartAsync inference with %d images", slot.channels.size());
+    slot.request->StartAsync();
 }
 
-int InferenceOV::Wait()
+int32_t InferenceOV::GetBatchTimeout()
 {
-    if (m_busyRequest.size() == 0)
+    if (m_batchIndex == 0 || m_maxBatchDelay.count() == 0)
     {
         return -1;
     }
-    TRACE("");
-    InferRequest::Ptr curRequest = m_busyRequest.front();
-    InferenceEngine::StatusCode ret = curRequest->Wait(IInferRequest::WaitMode::RESULT_READY);
-    TRACE("InferenceEngine::StatusCode %X", (int)ret);
-    if (ret == InferenceEngine::OK)
+    TimePoint start = m_requests[m_freeRequest.front()].start;
+    auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return (waited >= m_maxBatchDelay) ? 0 : (int32_t)(m_maxBatchDelay - waited).count();
+}
+
+void InferenceOV::WaitCompleted(uint32_t timeoutUs)
+{
+    std::unique_lock<std::mutex> lock(m_completedMutex);
+    m_completedCond.wait_for(lock, std::chrono::microseconds(timeoutUs), [this] { return !m_completed.empty(); });
+}
+
+void InferenceOV::RequestCompleted(uint32_t index, StatusCode status)
+{
+    // notified under the lock, the destructor can't destroy the condition before the callback returned
+    std::lock_guard<std::mutex> lock(m_completedMutex);
+    m_requests[index].status = status;
+    m_completed.push_back(index);
+    m_completedCond.notify_all();
+}
+
+static stopWatch watch;
+
+
+int InferenceOV::InsertImage(const int surfID, uint32_t channelId, uint32_t frameId, uint32_t roiId)
+{
+    TRACE(" surfID %d, channelId %d  frameId %d, roiId %d  \n", surfID, channelId, frameId, roiId);
+
+    if (!m_shareSurfaceWithVA)
     {
-        return 0;
+        ERRLOG("VASurface sharing not enabled\n");
+        return -1;
     }
-    else
+    CurrentRequest();
+    auto nv12_blob = gpu::make_shared_blob_nv12(GetInputHeight(), GetInputWidth(), m_sharedContext, surfID);
+    m_batchedBlobs.push_back(nv12_blob);
+
+    ImageInserted(channelId, frameId, roiId);
+    return 0;
+}
+
+int InferenceOV::Wait()
+{
+    if (m_busyNum == 0)
     {
-        ERRLOG("return value %Xx \n", (int)ret);
-        return ret;
+        return -1;
     }
+    TRACE("");
+    std::unique_lock<std::mutex> lock(m_completedMutex);
+    m_completedCond.wait(lock, [this] { return !m_completed.empty(); });
+    return 0;
 }
 
-int InferenceOV::GetOutput(std::vector<VAData *> &datas, std::vector<uint32_t> &channels, std::vector<uint32_t> &frames)
+int InferenceOV::GetOutput(std::vector<VAData *> &datas, std::vector<uint32_t> &channels, std::vector<uint32_t> &frames, uint32_t timeoutUs)
 {
     TRACE("");
-    if (m_internalDatas.size() > 0 && m_internalChannels.size() > 0 && m_internalFrames.size() > 0)
+    if (GetBatchTimeout() == 0)
     {
-        datas.insert(datas.end(), m_internalDatas.begin(), m_internalDatas.end());
-        m_internalDatas.clear();
-        channels.insert(channels.end(), m_internalChannels.begin(), m_internalChannels.end());
-        m_internalChannels.clear();
-        frames.insert(frames.end(), m_internalFrames.begin(), m_internalFrames.end());
-        m_internalFrames.clear();
+        // the first image of the partial batch waited long enough
+        SubmitBatch();
     }
-    return GetOutputInternal(datas, channels, frames);
-}
 
-int InferenceOV::GetOutputInternal(std::vector<VAData *> &datas, std::vector<uint32_t> &channels, std::vector<uint32_t> &frames)
-{
+    CollectCompleted(timeoutUs);
 
-    if (m_busyRequest.size() == 0 && m_batchIndex == 0)
+    // return the results in submission order
+    for (auto ite = m_results.begin(); ite != m_results.end() && ite->first == m_resultSequence; ite = m_results.erase(ite))
     {
-        // inference free, can pop all the results, we need the input
-        return -1;
+        Results &results = ite->second;
+        datas.insert(datas.end(), results.datas.begin(), results.datas.end());
+        channels.insert(channels.end(), results.channels.begin(), results.channels.end());
+        frames.insert(frames.end(), results.frames.begin(), results.frames.end());
+        ++ m_resultSequence;
     }
-    if (m_busyRequest.size() == 0 && m_batchIndex > 0)
+
+    if (m_busyNum == 0 && m_results.empty())
     {
-        // inference free, but still some task queued, so we need the input
-        return -2;
+        // inference free, can pop all the results, we need the input
+        // or still some task queued, so we need the input
+        return (m_batchIndex == 0) ? -1 : -2;
     }
-    uint32_t *channelIds = new uint32_t[m_batchNum];
-    uint32_t *frameIds = new uint32_t[m_batchNum];
-    uint32_t *roiIds = new uint32_t[m_batchNum];
-    TRACE("m_busyRequest.size()  %d \n", m_busyRequest.size());
-    while (m_busyRequest.size() > 0)
+    if (m_freeRequest.size() == 0)
     {
-        InferRequest::Ptr curRequest = m_busyRequest.front();
-        InferenceEngine::StatusCode status;
+        // there is no freeRequest, we don't need input
+        return 2;
+    }
+    return 0;
+}
 
-        status = curRequest->Wait(IInferRequest::WaitMode::STATUS_ONLY);
+void InferenceOV::CollectCompleted(uint32_t timeoutUs)
+{
+    if (m_busyNum == 0)
+    {
+        return;
+    }
 
-        if (status != InferenceEngine::OK)
+    {
+        std::unique_lock<std::mutex> lock(m_completedMutex);
+        if (m_completed.empty() && m_freeRequest.size() == 0 && timeoutUs > 0)
         {
-            break;
+            m_completedCond.wait_for(lock, std::chrono::microseconds(timeoutUs), [this] { return !m_completed.empty(); });
         }
-        status = curRequest->Wait(IInferRequest::WaitMode::RESULT_READY);
+        m_collected.swap(m_completed);
+    }
 
-        if (status != InferenceEngine::OK)
-        {
-            ERRLOG("status %Xx \n", (int)status);
-            break;
-        }
-        for (int i = 0; i < m_batchNum; i ++)
-        {
-            channelIds[i] = m_channels.front();
-            frameIds[i] = m_frames.front();
-            roiIds[i] = m_rois.front();
-            m_channels.pop();
-            m_frames.pop();
-            m_rois.pop();
-        }
-        // curRequest finished
+    for (auto index = m_collected.begin(); index != m_collected.end(); index ++)
+    {
+        Request &slot = m_requests[*index];
+        uint32_t count = slot.channels.size();
+        Results &results = m_results[slot.sequence];
 
-        std::map<std::string, const float*> results;
-        for (const auto& name : m_outputsNames)
+        if (slot.status == InferenceEngine::OK)
         {
-            const float* result = curRequest->GetBlob(name)->buffer().as<PrecisionTrait<Precision::FP32>::value_type*>();
-            results.insert(std::pair<std::string, const float*>(name.c_str(), result));
+            std::map<std::string, const float*> outputs;
+            for (const auto& name : m_outputsNames)
+            {
+                const float* result = slot.request->GetBlob(name)->buffer().as<PrecisionTrait<Precision::FP32>::value_type*>();
+                outputs.insert(std::pair<std::string, const float*>(name.c_str(), result));
+            }
+            Translate(results.datas, count, (void*)&outputs, slot.channels.data(), slot.frames.data(), slot.rois.data());
         }
-        int ret = Translate(datas, m_batchNum, (void*)&results, channelIds, frameIds, roiIds);
-
-        for (int i = 0; i < m_batchNum; i ++)
+        else
         {
-            channels.push_back(channelIds[i]);
-            frames.push_back(frameIds[i]);
+            // the frames still go on, without results
+            ERRLOG("inference request failed, status %d", (int)slot.status);
+            DropResults(count, slot.channels.data(), slot.frames.data(), slot.rois.data());
         }
-
-        m_freeRequest.push(curRequest);
-        m_busyRequest.pop();
+        results.channels.swap(slot.channels);
+        results.frames.swap(slot.frames);
+
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - slot.start).count();
+        ++ m_batches;
+        m_batchedImages += count;
+        m_totalLatencyMs += latency;
+        m_maxLatencyMs = std::max(m_maxLatencyMs, latency);
+
+        slot.channels.clear();
+        slot.frames.clear();
+        slot.rois.clear();
+        ReleaseDatas(slot);
+        m_freeRequest.push(*index);
+        -- m_busyNum;
     }
-
-    delete[] channelIds;
-    delete[] frameIds;
-    delete[] roiIds;
-
-    if (m_freeRequest.size() == 0)
-    {
-        // there is no freeRequest, we don't need input
-        return 2;
-    }
-    return 0;
+    m_collected.clear();
 }
-
@@ -29,6 +29,11 @@
 #include <opencv2/opencv.hpp>
 #include <gpu/gpu_context_api_va.hpp>
 
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <queue>
 #include <ie_plugin_config.hpp>
@@ -37,6 +42,7 @@
 #include <ie_compound_blob.h>
 
 #include "Inference.h"
+#include "TileGrid.h"
 
 class InferenceOV : public InferenceBlock
 {
@@ -58,9 +64,11 @@ public:
     // the img should already be in format that the model requests, otherwise, do the conversion outside
     int InsertImage(const int surfID, uint32_t channelId, uint32_t frameId, uint32_t roiId);
 
+    int InsertData(VAData *data);
+
     int Wait();
 
-    int GetOutput(std::vector<VAData *> &datas, std::vector<uint32_t> &channels, std::vector<uint32_t> &frames);
+    int GetOutput(std::vector<VAData *> &datas, std::vector<uint32_t> &channels, std::vector<uint32_t> &frames, uint32_t timeoutUs = 0);
 
     void JoinVAContext(void *va_dpy)
     {
@@ -68,6 +76,31 @@ public:
         m_shareSurfaceWithVA = true;
     }
 
+    void EnableZeroCopy(bool enable) { m_zeroCopy = enable; }
+
+    void SetCacheDir(const char *dir) { m_cacheDir = dir ? dir : ""; }
+
+    void SetMaxBatchDelay(uint32_t us) { m_maxBatchDelay = std::chrono::microseconds(us); }
+
+    int32_t GetBatchTimeout();
+
+    bool InFlight() { return m_busyNum > 0; }
+
+    void WaitCompleted(uint32_t timeoutUs);
+
+    void SetNMS(float iouThreshold, bool crossClass)
+    {
+        m_nmsIoUThreshold = iouThreshold;
+        m_nmsCrossClass = crossClass;
+    }
+
+    void SetTiling(uint32_t frameWidth, uint32_t frameHeight, uint32_t overlap)
+    {
+        m_frameWidth = frameWidth;
+        m_frameHeight = frameHeight;
+        m_tileOverlap = overlap;
+    }
+
 protected:
     // derived classes need to fill the dst with the img, based on their own different input dimension
     virtual void CopyImage(const uint8_t *img, void *dst, uint32_t batchIndex) = 0;
@@ -75,47 +108,138 @@ protected:
     // derived classes need to fill VAData by the result, based on their own different output demension
     virtual int Translate(std::vector<VAData *> &datas, uint32_t count, void *result, uint32_t *channelIds, uint32_t *frameIds, uint32_t *roiIds) = 0;
 
+    // the images of a failed request get no result, derived classes gathering the tiles of a frame drop them
+    virtual void DropResults(uint32_t count, uint32_t *channelIds, uint32_t *frameIds, uint32_t *roiIds) {}
+
     // derived classes need to set the input and output info
     virtual void SetDataPorts() = 0;
 
     virtual uint32_t GetInputWidth() = 0;
     virtual uint32_t GetInputHeight() = 0;
 
-    int GetOutputInternal(std::vector<VAData *> &datas, std::vector<uint32_t> &channels, std::vector<uint32_t> &frames);
     void IECoreInfo(const char* device);
 
-    std::queue<InferenceEngine::InferRequest::Ptr> m_busyRequest;
-    std::queue<InferenceEngine::InferRequest::Ptr> m_freeRequest;
-
-    std::queue<uint64_t> m_ids; // higher 32-bit: channel id, lower 32-bit: frame index
-    std::queue<uint32_t> m_channels;
-    std::queue<uint32_t> m_frames;
-    std::queue<uint32_t> m_rois;
+    // splits the frames in tiles of the model input when SetTiling() gave a frame size, derived
+    // classes call it from Load() once the input size is known
+    int ConfigureTiles(const char *name);
+    inline bool Tiled() {return m_frameWidth > 0; }
+
+    // the request collecting the next batch, waits for a request to complete if all are busy
+    InferenceEngine::InferRequest::Ptr CurrentRequest();
+    // called after an image is copied to the current request, starts it once the batch is full
+    void ImageInserted(uint32_t channelId, uint32_t frameId, uint32_t roiId);
+    // starts the current request, a partial batch is padded and the padding results are dropped
+    void SubmitBatch();
+
+    // translates the completed requests and frees them, waits up to timeoutUs for one when no request is free
+    void CollectCompleted(uint32_t timeoutUs);
+    // called by the inference engine threads
+    void RequestCompleted(uint32_t index, InferenceEngine::StatusCode status);
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+    // an inference request and the images it holds
+    struct Request
+    {
+        InferenceEngine::InferRequest::Ptr request;
+        std::vector<uint32_t> channels;
+        std::vector<uint32_t> frames;
+        std::vector<uint32_t> rois;
+        // when its first image was inserted
+        TimePoint start;
+        // submission order, the results are returned in this order
+        uint64_t sequence;
+        InferenceEngine::StatusCode status;
+        // the input blob of the request, replaced while it wraps the buffers of datas
+        InferenceEngine::Blob::Ptr inputBlob;
+        bool wrapped = false;
+        std::vector<VAData *> datas;
+    };
+    std::vector<Request> m_requests;
+    static const uint32_t WAIT_FREE_REQUEST_US = 100000;
+    // indexes in m_requests, the front one collects the next batch
+    std::queue<uint32_t> m_freeRequest;
+    uint32_t m_busyNum;
+
+    // the data buffer can be the input of the request
+    bool CanWrap(VAData *data);
+    // puts back the input blob of the request before copying an image to it
+    void UnwrapInput(Request &slot);
+    void ReleaseDatas(Request &slot);
+    bool m_zeroCopy;
+    uint64_t m_wrappedImages;
+    uint64_t m_copiedImages;
+
+    // requests completed by the inference engine, in completion order
+    std::mutex m_completedMutex;
+    std::condition_variable m_completedCond;
+    std::vector<uint32_t> m_completed;
+    std::vector<uint32_t> m_collected;
+
+    // translated results by sequence, the requests can complete out of order but the thread
+    // block expects the images of a frame in insertion order
+    struct Results
+    {
+        std::vector<VAData *> datas;
+        std::vector<uint32_t> channels;
+        std::vector<uint32_t> frames;
+    };
+    std::map<uint64_t, Results> m_results;
+    uint64_t m_submitSequence;
+    uint64_t m_resultSequence;
 
     std::vector<InferenceEngine::Blob::Ptr> m_batchedBlobs;
 
+    // the frames larger than the input are split in tiles when m_frameWidth is set
+    uint32_t m_frameWidth;
+    uint32_t m_frameHeight;
+    uint32_t m_tileOverlap;
+    TileGrid m_grid;
+    uint32_t m_tileChannels;
+
     uint32_t m_asyncDepth;
     uint32_t m_nStreams;
     uint32_t m_batchNum;
     uint32_t m_modelInputReshapeWidth;
     uint32_t m_modelInputReshapeHeight;
     float m_confidenceThreshold;
+    // non maximum suppression of the detection models, 0 keeps the default of the model
+    float m_nmsIoUThreshold;
+    bool m_nmsCrossClass;
 
     uint32_t m_batchIndex;
+    std::chrono::microseconds m_maxBatchDelay;
+
+    // batch fill ratio and latency from the first image of a batch to its results
+    uint64_t m_batches;
+    uint64_t m_partialBatches;
+    uint64_t m_batchedImages;
+    double m_totalLatencyMs;
+    double m_maxLatencyMs;
 
     // model related
     std::string m_inputName;
     std::vector<std::string> m_outputsNames;
 
     // openvino related
-    InferenceEngine::Core m_ie;
+    // compiled once per model type, model file, device and settings, with the requests of the destroyed instances
+    struct SharedModel
+    {
+        InferenceEngine::CNNNetwork network;
+        InferenceEngine::RemoteContext::Ptr context;
+        InferenceEngine::ExecutableNetwork execNetwork;
+        std::vector<InferenceEngine::InferRequest::Ptr> freeRequests;
+    };
+    static InferenceEngine::Core &GetCore();
+    // compiled networks exported to m_cacheDir, named after the hash of the model files and of the settings
+    std::string CacheFileName(const char *settings, const char *model, const char *weights, const std::map<std::string, std::string> &config);
+    int ImportNetwork(const std::string &cacheFile, const char *device, const std::map<std::string, std::string> &config);
+    void ExportNetwork(const std::string &cacheFile);
+    std::string m_cacheDir;
+    static std::mutex m_modelsMutex;
+    static std::map<std::string, std::weak_ptr<SharedModel>> m_models;
+    std::shared_ptr<SharedModel> m_model;
+    // the network of m_model, SetDataPorts() of the derived classes reads it
     InferenceEngine::CNNNetwork m_network;
-    InferenceEngine::ExecutableNetwork m_execNetwork;
-
-    // internal buffer to guarantee InsertImage can always find free worker
-    std::vector<VAData *> m_internalDatas;
-    std::vector<uint32_t> m_internalChannels;
-    std::vector<uint32_t> m_internalFrames;
 
     // VA Display for context joining with VA
     void *m_vaDisplay;
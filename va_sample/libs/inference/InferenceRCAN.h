@@ -24,6 +24,8 @@
 #define __INFERRENCE_RCAN_H__
 
 #include "InferenceOV.h"
+#include "SROutput.h"
+#include "SRTiles.h"
 
 class InferenceRCAN : public InferenceOV
 {
@@ -36,10 +38,14 @@ public:
     virtual void GetRequirements(uint32_t *width, uint32_t *height, uint32_t *fourcc);
 protected:
     int InsertImage(const uint8_t *img, uint32_t channelId, uint32_t frameId, uint32_t roiId);
+    // fills the input of the current request with one image or tile, its planes are planeSize apart
+    // and its rows pitch apart
+    int InsertTile(const uint8_t *img, uint32_t pitch, size_t planeSize, uint32_t channelId, uint32_t frameId, uint32_t roiId);
     int InsertImage(const cv::Mat &image, uint32_t channelId, uint32_t frameId, uint32_t roiId);
     void CopyImage(const uint8_t *img, void *dst, uint32_t batchIndex) { return; }
     void CopyImage(const uint8_t *img, void *dst, uint32_t w, uint32_t h, uint32_t c, uint32_t batchIndex);
     int Translate(std::vector<VAData *> &datas, uint32_t count, void *result, uint32_t *channels, uint32_t *frames, uint32_t *roiIds);
+    void DropResults(uint32_t count, uint32_t *channels, uint32_t *frames, uint32_t *roiIds);
     void SetDataPorts();
 
     uint32_t GetInputWidth() {return m_inputWidth; }
@@ -54,7 +60,11 @@ protected:
     uint32_t m_outputHeight;
     uint32_t m_outputChannelNum;
 
-    uint8_t* m_outImg = nullptr;
+    // converts the FP32 RGB outputs to NV12 surfaces in pooled buffers
+    SROutput m_output;
+
+    // blends the upscaled tiles of the frames larger than the input
+    SRTiles m_tiles;
 
     uint32_t m_resultSize; // size per one result
 };
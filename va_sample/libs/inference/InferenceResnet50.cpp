@@ -25,6 +25,8 @@
 #include <inference_engine.hpp>
 #include <logs.h>
 #include "DataPacket.h"
+#include "TopK.h"
+#include <cmath>
 
 using namespace std;
 using namespace InferenceEngine::details;
@@ -34,7 +36,9 @@ InferenceResnet50::InferenceResnet50():
     m_inputWidth(0),
     m_inputHeight(0),
     m_channelNum(1),
-    m_resultSize(0)
+    m_resultSize(0),
+    m_topK(1),
+    m_softmax(false)
 {
 }
 
@@ -92,6 +96,17 @@ void InferenceResnet50::GetRequirements(uint32_t *width, uint32_t *height, uint3
     TRACE("*width %d, *height %d, *fourcc 0x%X \n", *width, *height, *fourcc);
 }
 
+void InferenceResnet50::SetTopK(uint32_t k, bool softmax)
+{
+    if (k == 0 || k > VA_MAX_TOP_CLASSES)
+    {
+        INFO("top %d classes requested, %d reported", k, k ? VA_MAX_TOP_CLASSES : 1);
+        k = k ? VA_MAX_TOP_CLASSES : 1;
+    }
+    m_topK = k;
+    m_softmax = softmax;
+}
+
 void InferenceResnet50::CopyImage(const uint8_t *img, void *dst, uint32_t batchIndex)
 {
     uint8_t *input = (uint8_t *)dst;
@@ -117,20 +132,30 @@ int InferenceResnet50::Translate(std::vector<VAData *> &datas, uint32_t count, v
 {
     std::map<std::string, const float*>* curResults = (std::map<std::string, const float*>*) result;
     float* curResult = (float*)curResults->find(m_outputsNames[0])->second;
-    TRACE("");
+    TRACE("isa %s", TopKIsa());
+    int classes[VA_MAX_TOP_CLASSES];
+    float confs[VA_MAX_TOP_CLASSES];
     for (int i = 0; i < count; i ++)
     {
-        int c = -1;
-        float conf = 0;
-        for (int j = 0; j < m_resultSize; j ++)
+        uint32_t num = TopKScores(curResult, m_resultSize, m_topK, classes, confs);
+        if (m_softmax && num > 0)
+        {
+            float max = confs[0];
+            float sum = SoftmaxSum(curResult, m_resultSize, max);
+            for (uint32_t j = 0; j < num; j ++)
+            {
+                confs[j] = std::exp(confs[j] - max) / sum;
+            }
+        }
+        else
         {
-            if (curResult[j] > conf)
+            // the outputs are already probabilities, a class needs a positive one
+            while (num > 0 && confs[num - 1] <= 0)
             {
-                c = j;
-                conf = curResult[j];
+                num --;
             }
         }
-        VAData *data = VAData::Create(c, conf);
+        VAData *data = num ? VAData::Create(classes, confs, num) : VAData::Create(-1, 0);
         data->SetID(channelIds[i], frameIds[i]);
         // one roi creates one output, just copy the roiIds
         data->SetRoiIndex(roiIds[i]);
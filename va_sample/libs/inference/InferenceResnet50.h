@@ -34,6 +34,8 @@ public:
     virtual int Load(const char *device, const char *model, const char *weights);
 
     virtual void GetRequirements(uint32_t *width, uint32_t *height, uint32_t *fourcc);
+
+    void SetTopK(uint32_t k, bool softmax);
 protected:
     // derived classes need to fill the dst with the img, based on their own different input dimension
     void CopyImage(const uint8_t *img, void *dst, uint32_t batchIndex);
@@ -51,6 +53,10 @@ protected:
     uint32_t m_inputHeight;
     uint32_t m_channelNum;
     uint32_t m_resultSize; // size per one result
+
+    // classes reported per image, at most VA_MAX_TOP_CLASSES
+    uint32_t m_topK;
+    bool m_softmax;
 };
 
 #endif //__INFERRENCE_RESNET50_H__
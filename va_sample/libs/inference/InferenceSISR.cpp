@@ -24,16 +24,12 @@
 #include <ie_plugin_config.hpp>
 
 #include "DataPacket.h"
+#include "PlanarKernels.h"
 
 using namespace std;
 using namespace InferenceEngine::details;
 using namespace InferenceEngine;
 
-inline uint8_t clip(float val)
-{
-    return (val < 0) ? 0 : ((val>255)? 255: (uint8_t)val);
-}
-
 template <typename T>
 void matU8ToBlob(const cv::Mat& orig_image, InferenceEngine::Blob::Ptr& blob, int batchIndex = 0) 
 {
@@ -86,6 +82,7 @@ InferenceSISR::InferenceSISR():
     m_outputChannelNum(0),
     m_resultSize(0)
 {
+    m_output.SetScale(255);
 }
 
 InferenceSISR::~InferenceSISR()
@@ -140,67 +137,136 @@ int InferenceSISR::Load(const char *device, const char *model, const char *weigh
     m_outputHeight = outputDims[2];
     m_outputChannelNum = outputDims[1];
 
+    if (Tiled())
+    {
+        ret = ConfigureTiles("SISR");
+        if (ret)
+        {
+            return ret;
+        }
+        ret = m_tiles.Configure(m_grid, m_outputWidth / m_inputWidth, m_outputChannelNum);
+        if (ret)
+        {
+            return ret;
+        }
+    }
+
     return 0;
 }
 
 void InferenceSISR::GetRequirements(uint32_t *width, uint32_t *height, uint32_t *fourcc)
 {
-    *width = m_inputWidth;
-    *height = m_inputHeight;
+    *width = Tiled() ? m_frameWidth : m_inputWidth;
+    *height = Tiled() ? m_frameHeight : m_inputHeight;
     *fourcc = m_shareSurfaceWithVA ? 0x3231564e : 0x50424752; //MFX_FOURCC_RGBP
 }
 
 int InferenceSISR::InsertImage(const uint8_t *img, uint32_t channelId, uint32_t frameId, uint32_t roiId)
 {
-    std::vector<cv::Mat> imgPlanes;
-    cv::Mat R(m_inputHeight, m_inputWidth, CV_8UC1, (uint8_t*)img);
-    cv::Mat G(m_inputHeight, m_inputWidth, CV_8UC1, (uint8_t*)(img + m_inputHeight*m_inputWidth*1));
-    cv::Mat B(m_inputHeight, m_inputWidth, CV_8UC1, (uint8_t*)(img + m_inputHeight*m_inputWidth*2));
-    imgPlanes.push_back(R);
-    imgPlanes.push_back(G);
-    imgPlanes.push_back(B);
+    if (!Tiled())
+    {
+        return InsertTile(img, m_inputWidth, (size_t)m_inputWidth * m_inputHeight, channelId, frameId, roiId);
+    }
+    // the tiles fill the batches of as many requests as needed
+    for (uint32_t tile = 0; tile < m_grid.TileNum(); tile ++)
+    {
+        uint32_t x, y;
+        m_grid.TileOrigin(tile, &x, &y);
+        int ret = InsertTile(img + (size_t)y * m_frameWidth + x, m_frameWidth, (size_t)m_frameWidth * m_frameHeight,
+                             channelId, frameId, TileGrid::TileRoi(roiId, tile));
+        if (ret)
+        {
+            return ret;
+        }
+    }
+    return 0;
+}
 
-    cv::Mat resultImg;
-    cv::merge(imgPlanes, resultImg);
+int InferenceSISR::InsertTile(const uint8_t *img, uint32_t pitch, size_t planeSize, uint32_t channelId, uint32_t frameId, uint32_t roiId)
+{
+    InferRequest::Ptr curRequest = CurrentRequest();
 
-    InsertImage(resultImg, channelId, frameId, roiId);
+    MemoryBlob::Ptr lrBlob = as<MemoryBlob>(curRequest->GetBlob("0"));
+    if (!lrBlob)
+    {
+        printf("Cannot cast inputBlob to MemoryBlob\n");
+        return -1;
+    }
+    auto lrHolder = lrBlob->wmap();
+    size_t lrPlaneSize = (size_t)m_inputWidth * m_inputHeight;
+    float *lr = lrHolder.as<float *>() + m_batchIndex * m_channelNum * lrPlaneSize;
+    // the RGBP planes are already in the layout of the input
+    if (pitch == m_inputWidth && planeSize == lrPlaneSize)
+    {
+        U8ToFloat(img, lr, m_channelNum * lrPlaneSize);
+    }
+    else
+    {
+        for (uint32_t c = 0; c < m_channelNum; c ++)
+        {
+            for (uint32_t y = 0; y < m_inputHeight; y ++)
+            {
+                U8ToFloat(img + c * planeSize + (size_t)y * pitch, lr + c * lrPlaneSize + (size_t)y * m_inputWidth, m_inputWidth);
+            }
+        }
+    }
+
+    int ret = ResizeCubic(curRequest, lr);
+    if (ret)
+    {
+        return ret;
+    }
+    ++ m_copiedImages;
+
+    ImageInserted(channelId, frameId, roiId);
 
     return 0;
 }
 
 int InferenceSISR::InsertImage(const cv::Mat &image, uint32_t channelId, uint32_t frameId, uint32_t roiId)
 {
-    if (m_freeRequest.size() == 0)
-    {
-        Wait();
-        GetOutputInternal(m_internalDatas, m_internalChannels, m_internalFrames);
-    }
-    InferRequest::Ptr curRequest = m_freeRequest.front();
-
-    int channelNum = 3;
-    void *dst = nullptr;
+    InferRequest::Ptr curRequest = CurrentRequest();
 
     Blob::Ptr lrInputBlob = curRequest->GetBlob("0");
-    matU8ToBlob<float_t>(image, lrInputBlob, 0);
+    matU8ToBlob<float_t>(image, lrInputBlob, m_batchIndex);
+
+    MemoryBlob::Ptr lrBlob = as<MemoryBlob>(lrInputBlob);
+    if (!lrBlob)
+    {
+        return -1;
+    }
+    auto lrHolder = lrBlob->wmap();
+    int ret = ResizeCubic(curRequest, lrHolder.as<float *>() + m_batchIndex * m_channelNum * m_inputWidth * m_inputHeight);
+    if (ret)
+    {
+        return ret;
+    }
 
-    cv::Mat resizedImg;
-    cv::resize(image, resizedImg, image.size()*4, 0, 0, cv::INTER_CUBIC);
-    Blob::Ptr cubInputBlob = curRequest->GetBlob("1");
-    matU8ToBlob<float_t>(resizedImg, cubInputBlob, 0);
+    ImageInserted(channelId, frameId, roiId);
 
-    m_channels.push(channelId);
-    m_frames.push(frameId);
-    m_rois.push(roiId);
+    return 0;
+}
 
-    ++ m_batchIndex;
-    if (m_batchIndex >= m_batchNum)
+int InferenceSISR::ResizeCubic(InferRequest::Ptr &request, const float *lr)
+{
+    MemoryBlob::Ptr cubicBlob = as<MemoryBlob>(request->GetBlob("1"));
+    if (!cubicBlob)
     {
-        m_batchIndex = 0;
-        curRequest->StartAsync();
-        m_busyRequest.push(curRequest);
-        m_freeRequest.pop();
+        printf("Cannot cast inputBlob to MemoryBlob\n");
+        return -1;
     }
+    auto cubicHolder = cubicBlob->wmap();
+    size_t lrPlaneSize = (size_t)m_inputWidth * m_inputHeight;
+    size_t cubicPlaneSize = (size_t)m_inputWidth2 * m_inputHeight2;
+    float *cubic = cubicHolder.as<float *>() + m_batchIndex * m_channelNum2 * cubicPlaneSize;
 
+    // resized plane by plane from the first input straight into the second one
+    for (uint32_t c = 0; c < m_channelNum2 && c < m_channelNum; c++)
+    {
+        cv::Mat src(m_inputHeight, m_inputWidth, CV_32FC1, (void *)(lr + c * lrPlaneSize));
+        cv::Mat dst(m_inputHeight2, m_inputWidth2, CV_32FC1, cubic + c * cubicPlaneSize);
+        cv::resize(src, dst, dst.size(), 0, 0, cv::INTER_CUBIC);
+    }
     return 0;
 }
 
@@ -213,95 +279,57 @@ void InferenceSISR::CopyImage(const uint8_t *img, void *dst, uint32_t w, uint32_
                 data[z*w*h + y*w + x] = img[z*w*h + y*w + x];
 }
 
+void InferenceSISR::DropResults(uint32_t count, uint32_t *channelIds, uint32_t *frameIds, uint32_t *roiIds)
+{
+    if (!Tiled())
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        m_tiles.DropTile(channelIds[i], frameIds[i], TileGrid::RoiOf(roiIds[i]), TileGrid::TileOf(roiIds[i]));
+    }
+}
+
 int InferenceSISR::Translate(std::vector<VAData *> &datas, uint32_t count, void *result, uint32_t *channelIds, uint32_t *frameIds, uint32_t *roiIds)
 {
     std::map<std::string, const float*>* curResults = (std::map<std::string, const float*>*) result;
-    float* curResult = (float*)curResults->find(m_outputsNames[0])->second;
-    bool outputNV12 = true;
-    uint32_t alignedHeight = 0;
-    uint32_t planeSize = m_outputHeight * m_outputWidth;;
-    uint32_t imgSize = 0;
-    uint32_t fourcc;
+    const float* curResult = curResults->find(m_outputsNames[0])->second;
+    const bool outputNV12 = true;
 
     for (int i = 0; i < count; i ++) 
     {
-        if (outputNV12) 
-        { 
-            fourcc = 0x3231564e; // MFX_FOURCC_NV12
-            alignedHeight = ((m_outputHeight + 15) / 16)*16;
-            uint32_t planeSizeNV12 = alignedHeight * m_outputWidth;
-            imgSize = 3 * planeSizeNV12 / 2;
-            if (m_outImg == nullptr) 
-            {
-                m_outImg = new uint8_t[imgSize];
-            }
-            memset(m_outImg, 0, imgSize);
-            for (size_t h = 0; h < m_outputHeight; h++) 
-            {
-                for (size_t w = 0; w < m_outputWidth; w++) 
-                {
-                    float r = clip(curResult[0 * planeSize + h * m_outputWidth + w] * 255);
-                    float g = clip(curResult[1 * planeSize + h * m_outputWidth + w] * 255);
-                    float b = clip(curResult[2 * planeSize + h * m_outputWidth + w] * 255);
-                    uint8_t y = clip( 0.257 * r + 0.504 * g + 0.098 * b +  16);
-                    m_outImg[h * m_outputWidth + w] = y;
-                    if (h%2 == 0 && w%2 == 0) 
-                    {
-                        uint8_t u = clip(-0.148 * r - 0.291 * g + 0.439 * b + 128);
-                        uint8_t v = clip( 0.439 * r - 0.368 * g - 0.071 * b + 128);
-                        m_outImg[planeSizeNV12 + (h/2) * m_outputWidth + w + 0] = u;
-                        m_outImg[planeSizeNV12 + (h/2) * m_outputWidth + w + 1] = v;
-                    }
-                }
-            }
-            // debug dump
-            if (0) 
-            {
-                FILE* fp = fopen("sr_4x_.nv12", "wb+");
-                fwrite(m_outImg, 1, imgSize, fp);
-                fclose(fp);
-            }
-            
-        } 
-        else 
+        const float *output = curResult;
+        curResult += m_outputChannelNum * m_outputHeight * m_outputWidth;
+
+        VAData *data = nullptr;
+        uint32_t roiId = roiIds[i];
+        if (!Tiled())
         {
-            fourcc = 0x50424752; // MFX_FOURCC_RGBP
-            alignedHeight = m_outputHeight;
-            imgSize = m_outputChannelNum * planeSize;
-            m_outImg = new uint8_t[imgSize];
-            for (size_t c = 0; c < m_outputChannelNum; c++) 
-            {
-                for (size_t h = 0; h < m_outputHeight; h++) 
-                {
-                    for (size_t w = 0; w < m_outputWidth; w++) 
-                    {
-                        float val = curResult[c * planeSize + h * m_outputWidth + w] * 255;
-                        m_outImg[c * planeSize + h * m_outputWidth + w] = (val < 0) ? 0 : ((val>255)? 255: (uint8_t)val);
-                    }
-                }
-            }
-            // debug dump
-            if (0) 
+            data = m_output.Convert(output, m_outputWidth, m_outputHeight, m_outputChannelNum, outputNV12);
+        }
+        else
+        {
+            // the frame goes on with its last tile
+            roiId = TileGrid::RoiOf(roiIds[i]);
+            float *image = m_tiles.AddTile(channelIds[i], frameIds[i], roiId, TileGrid::TileOf(roiIds[i]), output);
+            if (!image)
             {
-                std::vector<cv::Mat> imgPlanes = {
-                    cv::Mat(m_outputHeight, m_outputWidth, CV_8UC1, &(m_outImg[planeSize * 0])),
-                    cv::Mat(m_outputHeight, m_outputWidth, CV_8UC1, &(m_outImg[planeSize * 1])),
-                    cv::Mat(m_outputHeight, m_outputWidth, CV_8UC1, &(m_outImg[planeSize * 2]))
-                };
-                cv::Mat resultImg;
-                cv::merge(imgPlanes, resultImg);
-                std::string outImgName = std::string("sr_4x_" + std::to_string(i + 1) + ".png");
-                cv::imwrite(outImgName, resultImg);
+                continue;
             }
+            data = m_output.Convert(image, m_tiles.OutputWidth(), m_tiles.OutputHeight(), m_outputChannelNum, outputNV12);
+            m_tiles.Release(image);
+        }
+        if (!data)
+        {
+            // Convert() logged it, the frame goes on without its output and the rest of the batch is kept
+            continue;
         }
-
-        VAData *data = VAData::Create(m_outImg, m_outputWidth, alignedHeight, m_outputChannelNum, fourcc);
         data->SetID(channelIds[i], frameIds[i]);
         // one roi creates one output, just copy the roiIds
-        data->SetRoiIndex(roiIds[i]);
+        data->SetRoiIndex(roiId);
         datas.push_back(data);
-        curResult += imgSize;
     }
 
     return 0;
-}
\ No newline at end of file
+}
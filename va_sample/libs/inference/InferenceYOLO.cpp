@@ -25,6 +25,7 @@
 #include <inference_engine.hpp>
 #include <logs.h>
 #include "DataPacket.h"
+#include "YOLODecode.h"
 
 using namespace std;
 using namespace InferenceEngine::details;
@@ -42,10 +43,6 @@ const std::vector<int64_t> defaultMasks[] = {
     {0, 1, 2, 3, 4, 5, 6, 7, 8 }
 };
 
-static inline float sigmoid(float x) {
-    return 1.f / (1.f + exp(-x));
-}
-
 const float defaultYOLOv4BoxIOUThreshold = 0.5;
 const bool defaultUseAdvancedPostProcessing = true;
 
@@ -168,14 +165,21 @@ int InferenceYOLO::Load(const char *device, const char *model, const char *weigh
             shape[YOLO_OUT_CELLWIDTH], shape[YOLO_OUT_CELLHEIGHT]));
         i++;
     }
+
+    ret = ConfigureTiles("YOLO");
+    if (ret)
+    {
+        return ret;
+    }
+    m_tiles.Configure(m_grid);
     return 0;
 }
 
 void InferenceYOLO::GetRequirements(uint32_t *width, uint32_t *height, uint32_t *fourcc)
 {
     TRACE("");
-    *width = m_inputWidth;
-    *height = m_inputHeight;
+    *width = Tiled() ? m_frameWidth : m_inputWidth;
+    *height = Tiled() ? m_frameHeight : m_inputHeight;
     *fourcc = m_shareSurfaceWithVA?0x3231564e:0x50424752; //MFX_FOURCC_RGBP
 }
 
@@ -187,145 +191,84 @@ void InferenceYOLO::CopyImage(const uint8_t *img, void *dst, uint32_t batchIndex
     TRACE("");
 }
 
-int InferenceYOLO::CalculateEntryIndex(int totalCells, int lcoords, int lclasses, int location, int entry)
+void InferenceYOLO::ProcessYOLOOutput(const float* result, const Region& region,
+    const uint32_t scaledW, const uint32_t scaledH, VADetections &boxes)
 {
-    int n = location / totalCells;
-    int loc = location % totalCells;
-    return (n * (lcoords + lclasses + 1) + entry) * totalCells + loc;
-}
-
+    YOLORegionLayout layout;
+    layout.num = region.num;
+    layout.classes = region.classes;
+    layout.coords = region.coords;
+    layout.sideW = region.outputWidth;
+    layout.sideH = region.outputHeight;
+    layout.anchors = region.anchors.data();
 
-double InferenceYOLO::IntersectionOverUnion(VAData* vd1, VAData* vd2)
-{
-    float l1, r1, t1, b1;
-    float l2, r2, t2, b2;
-    vd1->GetRoiRegion(&l1, &t1, &r1, &b1);
-    vd2->GetRoiRegion(&l2, &t2, &r2, &b2);
-    double overlappingWidth = fmin(r1, r2) - fmax(l1, l2);
-    double overlappingHeight = fmin(b1, b2) - fmax(t1, t2);
-    double intersectionArea = (overlappingWidth < 0 || overlappingHeight < 0) ? 0 : overlappingHeight * overlappingWidth;
-    double unionArea = (r1 - l1) * (b1 - t1) + (r2 - l2) * (b2 - t2) - intersectionArea;
-    return intersectionArea / unionArea;
+    // --------------------------- Parsing YOLO Region output -------------------------------------
+    YOLODecodeRegion(result, layout, scaledW, scaledH, m_confidenceThreshold, boxes, m_cells);
 }
 
 
-void InferenceYOLO::ProcessYOLOOutput(const void* result, const Region& region,
-    const int sideW, const int sideH, const uint32_t scaledW,
-    const uint32_t scaledH, const uint32_t frameId,
-    const uint32_t channelId,
-    std::vector<VAData*>& yolodatas)
+void InferenceYOLO::DropResults(uint32_t count, uint32_t *channelIds, uint32_t *frameIds, uint32_t *roiIds)
 {
-    auto entriesNum = sideW * sideH;
-    float* curResult = (float*)result;
-
-    auto postprocessRawData = sigmoid;
-
-    // --------------------------- Parsing YOLO Region output -------------------------------------
-    for (int i = 0; i < entriesNum; ++i) {
-        int row = i / sideW;
-        int col = i % sideW;
-        for (int n = 0; n < region.num; ++n) {
-            //--- Getting region data from blob
-            int obj_index = CalculateEntryIndex(entriesNum, region.coords, region.classes, n * entriesNum + i, region.coords);
-            int box_index = CalculateEntryIndex(entriesNum, region.coords, region.classes, n * entriesNum + i, 0);
-            float scale = postprocessRawData(curResult[obj_index]);
-
-            //--- Preliminary check for confidence threshold conformance
-            if (scale >= m_confidenceThreshold) {
-                //--- Calculating scaled region's coordinates
-                double x = (col + postprocessRawData(curResult[box_index + 0 * entriesNum])) / sideW;
-                double y = (row + postprocessRawData(curResult[box_index + 1 * entriesNum])) / sideH;
-                double height = std::exp(curResult[box_index + 3 * entriesNum]) * region.anchors[2 * n + 1] / scaledH;
-                double width = std::exp(curResult[box_index + 2 * entriesNum]) * region.anchors[2 * n] / scaledW;
-
-                float l = (float)(x - width / 2);
-                float t = (float)(y - height / 2);
-                float r = (float)(x + width / 2);
-                float b = (float)(y + height / 2);
-                if (l < 0.0) l = 0.0;
-                if (t < 0.0) t = 0.0;
-                if (r > 1.0) r = 1.0;
-                if (b > 1.0) b = 1.0;
-
-                for (int j = 0; j < region.classes; ++j) {
-                    int class_index = CalculateEntryIndex(entriesNum, region.coords, region.classes, n * entriesNum + i, region.coords + 1 + j);
-                    float prob = scale * postprocessRawData(curResult[class_index]);
-
-                    //--- Checking confidence threshold conformance and adding region to the list
-                    if (prob >= m_confidenceThreshold) {
-                        //use j+1 instead of j: to make the class label starts from 1 instead of 0.
-                        VAData* data = VAData::Create(l, t, r, b, j+1, prob);
-                        data->SetID(channelId, frameId);
-                        data->SetRoiIndex(yolodatas.size());
-                        yolodatas.push_back(data);
-                    }
-                }
-            }
-        }
+    if (!Tiled())
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        m_tiles.DropTile(channelIds[i], frameIds[i], TileGrid::RoiOf(roiIds[i]), TileGrid::TileOf(roiIds[i]));
     }
 }
 
-
 int InferenceYOLO::Translate(std::vector<VAData *> &datas, uint32_t count, void *result, uint32_t *channelIds, uint32_t *frameIds, uint32_t *roiIds)
 {
     TRACE("");
     std::map<std::string, const float*> * curResults = (std::map<std::string, const float*>*) result;
+    VADetections &boxes = m_candidates;
+    m_nms.SetIoUThreshold(m_nmsIoUThreshold > 0 ? m_nmsIoUThreshold : m_boxIOUThreshold);
+    m_nms.SetCrossClass(m_nmsCrossClass || !m_useAdvancedPostProcessing);
+    m_nms.SetGreedy(!m_useAdvancedPostProcessing);
 
     for (int b = 0; b < count; b++)
     {
-        std::vector<VAData*> vadatas;
+        boxes.Clear();
+        VADetections *frameBoxes = &boxes;
 
         for (const auto& name : m_outputsNames) 
         {
-            float* curResult = (float*)curResults->find(name)->second;
-            Region region = m_regions.find(name)->second;
-            int sideW = m_regions.find(name)->second.outputWidth;
-            int sideH = m_regions.find(name)->second.outputHeight;
-            curResult += b * sideW * sideH * region.num * (region.coords + region.classes + 1);
-            this->ProcessYOLOOutput(curResult, region, sideW, sideH, 
-                m_modelInputReshapeWidth, m_modelInputReshapeHeight, frameIds[b],
-                channelIds[b],
-                vadatas);
+            const float* curResult = curResults->find(name)->second;
+            const Region &region = m_regions.find(name)->second;
+            curResult += b * region.outputWidth * region.outputHeight * region.num * (region.coords + region.classes + 1);
+            this->ProcessYOLOOutput(curResult, region, m_modelInputReshapeWidth, m_modelInputReshapeHeight, boxes);
         }
 
-        uint32_t roiIndex = 0;
-        if (m_useAdvancedPostProcessing) {
-            // Advanced postprocessing
-            // Checking IOU threshold conformance
-            // For every i-th object we're finding all objectss it intersects with, and comparing confidence
-            // If i-th object has greater confidence than all others, we include it into result
-            for (const auto& vd1 : vadatas) {
-                bool isGoodResult = true;
-                for (const auto& vd2 : vadatas) {
-                    if (vd1->Class() == vd2->Class() && vd1->Confidence() < vd2->Confidence() && IntersectionOverUnion(vd1, vd2) >= m_boxIOUThreshold) {
-                        // if vd1 is the same as vd2, condition expression will evaluate to false anyway
-                        isGoodResult = false;
-                        break;
-                    }
-                }
-                if (isGoodResult) {
-                    vd1->SetRoiIndex(roiIndex++);
-                    datas.push_back(vd1);
-                }
-            }
-        }
-        else {
-            // Classic postprocessing
-            std::sort(vadatas.begin(), vadatas.end(), [](VAData* vd1, VAData* vd2) { return vd1->Confidence() > vd2->Confidence(); });
-            for (size_t i = 0; i < vadatas.size(); ++i) {
-                if (vadatas[i]->Confidence() == 0)
-                    continue;
-                for (size_t j = i + 1; j < vadatas.size(); ++j)
-                    if (IntersectionOverUnion(vadatas[i], vadatas[j]) >= m_boxIOUThreshold)
-                        vadatas[j]->SetConfidence(0.0);
-                vadatas[i]->SetRoiIndex(roiIndex++);
-                datas.push_back(vadatas[i]);
+        if (Tiled())
+        {
+            // the frame goes on with its last tile, the suppression also merges the objects found in several tiles
+            frameBoxes = m_tiles.AddTile(channelIds[b], frameIds[b], TileGrid::RoiOf(roiIds[b]), TileGrid::TileOf(roiIds[b]), boxes);
+            if (!frameBoxes)
+            {
+                continue;
             }
         }
 
+        // Advanced postprocessing drops every object overlapping an object of the same class and a
+        // greater confidence, classic postprocessing keeps the objects by decreasing confidence,
+        // dropping the ones overlapping a kept object of any class
+        uint32_t keepNum = m_nms.Run(*frameBoxes, m_keep);
+        for (uint32_t k = 0; k < keepNum; k++) {
+            uint32_t i = m_keep[k];
+            VAData *data = VAData::Create(frameBoxes->left[i], frameBoxes->top[i], frameBoxes->right[i], frameBoxes->bottom[i],
+                                          frameBoxes->classId[i], frameBoxes->confidence[i]);
+            data->SetID(channelIds[b], frameIds[b]);
+            data->SetRoiIndex(k);
+            datas.push_back(data);
+        }
+        if (frameBoxes != &boxes)
+        {
+            m_tiles.Release(frameBoxes);
+        }
     }
 
 
     return 0;
 }
-
@@ -24,6 +24,9 @@
 #define __INFERRENCE_YOLO_H__
 
 #include "InferenceOV.h"
+#include "Detections.h"
+#include "NonMaxSuppression.h"
+#include "DetectionTiles.h"
 
 class InferenceYOLO : public InferenceOV
 {
@@ -71,6 +74,7 @@ protected:
 
     // derived classes need to fill VAData by the result, based on their own different output demension
     int Translate(std::vector<VAData *> &datas, uint32_t count, void *result, uint32_t *channels, uint32_t *frames, uint32_t *roiIds);
+    void DropResults(uint32_t count, uint32_t *channels, uint32_t *frames, uint32_t *roiIds);
 
     void SetDataPorts();
 
@@ -78,11 +82,9 @@ protected:
     uint32_t GetInputHeight() {return m_inputHeight; }
 
     // model related
-    static int CalculateEntryIndex(int entriesNum, int lcoords, int lclasses, int location, int entry);
-    static double IntersectionOverUnion(VAData* vd1, VAData* vd2);
-    void ProcessYOLOOutput(const void* result, const Region& region,
-        const int sideW, const int sideH, const uint32_t scaledW, const uint32_t scaledH,
-        const uint32_t frameId, const uint32_t channelId, std::vector<VAData*>& yolodatas);
+    // appends the candidate boxes of one output of one image to boxes
+    void ProcessYOLOOutput(const float* result, const Region& region,
+        const uint32_t scaledW, const uint32_t scaledH, VADetections &boxes);
 
     uint32_t m_inputWidth;
     uint32_t m_inputHeight;
@@ -93,6 +95,14 @@ protected:
     YoloVersion m_yoloVersion;
     const std::vector<float> m_presetAnchors;
     const std::vector<int64_t> m_presetMasks;
+
+    // candidates of the image being translated, VAData is only created for the boxes kept
+    VADetections m_candidates;
+    std::vector<uint32_t> m_cells;
+    NonMaxSuppression m_nms;
+    std::vector<uint32_t> m_keep;
+    // boxes of the tiles of the frames larger than the input
+    DetectionTiles m_tiles;
 };
 
 #endif //__INFERRENCE_YOLO_H__
@@ -0,0 +1,215 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "NonMaxSuppression.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NMS_X86
+#endif
+
+// The boxes a candidate is compared with. IoU >= threshold is tested as
+// intersection * (1 + threshold) >= (area1 + area2) * threshold, without a division.
+struct BoxList
+{
+    const float *left;
+    const float *top;
+    const float *right;
+    const float *bottom;
+    const float *area;
+    const float *confidence;
+};
+
+struct Candidate
+{
+    float left;
+    float top;
+    float right;
+    float bottom;
+    float area;
+    // only the boxes of a higher confidence suppress the candidate
+    float minConfidence;
+};
+
+// true if one of the count boxes suppresses the candidate
+typedef bool (*OverlapFunc)(const BoxList &list, uint32_t start, uint32_t count, const Candidate &box, float threshold);
+
+static bool OverlapScalar(const BoxList &list, uint32_t start, uint32_t count, const Candidate &box, float threshold)
+{
+    const float factor = 1.f + threshold;
+    for (uint32_t i = start; i < count; i++)
+    {
+        float w = std::max(0.f, std::min(list.right[i], box.right) - std::max(list.left[i], box.left));
+        float h = std::max(0.f, std::min(list.bottom[i], box.bottom) - std::max(list.top[i], box.top));
+        float intersection = w * h;
+        if (intersection > 0 && intersection * factor >= (list.area[i] + box.area) * threshold &&
+            list.confidence[i] > box.minConfidence)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef NMS_X86
+__attribute__((target("avx2")))
+static bool OverlapAVX2(const BoxList &list, uint32_t start, uint32_t count, const Candidate &box, float threshold)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 factor = _mm256_set1_ps(1.f + threshold);
+    const __m256 vthreshold = _mm256_set1_ps(threshold);
+    const __m256 l = _mm256_set1_ps(box.left);
+    const __m256 t = _mm256_set1_ps(box.top);
+    const __m256 r = _mm256_set1_ps(box.right);
+    const __m256 b = _mm256_set1_ps(box.bottom);
+    const __m256 area = _mm256_set1_ps(box.area);
+    const __m256 minConfidence = _mm256_set1_ps(box.minConfidence);
+    uint32_t i = start;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 w = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(_mm256_loadu_ps(list.right + i), r),
+                                                     _mm256_max_ps(_mm256_loadu_ps(list.left + i), l)));
+        __m256 h = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(_mm256_loadu_ps(list.bottom + i), b),
+                                                     _mm256_max_ps(_mm256_loadu_ps(list.top + i), t)));
+        __m256 intersection = _mm256_mul_ps(w, h);
+        __m256 unionArea = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(list.area + i), area), vthreshold);
+        __m256 suppress = _mm256_and_ps(_mm256_cmp_ps(intersection, zero, _CMP_GT_OQ),
+                                        _mm256_cmp_ps(_mm256_mul_ps(intersection, factor), unionArea, _CMP_GE_OQ));
+        suppress = _mm256_and_ps(suppress, _mm256_cmp_ps(_mm256_loadu_ps(list.confidence + i), minConfidence, _CMP_GT_OQ));
+        if (!_mm256_testz_ps(suppress, suppress))
+        {
+            return true;
+        }
+    }
+    // the scalar code is not VEX encoded, the upper halves must be cleared before it
+    _mm256_zeroupper();
+    return OverlapScalar(list, i, count, box, threshold);
+}
+#endif
+
+static OverlapFunc SelectOverlap()
+{
+#ifdef NMS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return OverlapAVX2;
+    }
+#endif
+    return OverlapScalar;
+}
+
+static OverlapFunc Overlap()
+{
+    static const OverlapFunc overlap = SelectOverlap();
+    return overlap;
+}
+
+const char *NonMaxSuppression::Isa()
+{
+    return Overlap() == OverlapScalar ? "scalar" : "avx2";
+}
+
+NonMaxSuppression::NonMaxSuppression():
+    m_iouThreshold(0.5),
+    m_crossClass(false),
+    m_greedy(true)
+{
+}
+
+uint32_t NonMaxSuppression::Run(const VADetections &boxes, std::vector<uint32_t> &keep)
+{
+    const uint32_t count = boxes.Size();
+    keep.clear();
+    m_order.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_order[i] = i;
+    }
+    const bool crossClass = m_crossClass;
+    std::sort(m_order.begin(), m_order.end(), [&boxes, crossClass](uint32_t i, uint32_t j) {
+        if (!crossClass && boxes.classId[i] != boxes.classId[j])
+            return boxes.classId[i] < boxes.classId[j];
+        if (boxes.confidence[i] != boxes.confidence[j])
+            return boxes.confidence[i] > boxes.confidence[j];
+        return i < j;
+    });
+
+    if (m_left.size() < count)
+    {
+        m_left.resize(count);
+        m_top.resize(count);
+        m_right.resize(count);
+        m_bottom.resize(count);
+        m_area.resize(count);
+        m_confidence.resize(count);
+    }
+    BoxList list = {m_left.data(), m_top.data(), m_right.data(), m_bottom.data(), m_area.data(), m_confidence.data()};
+    OverlapFunc overlap = Overlap();
+
+    uint32_t listNum = 0;
+    for (uint32_t k = 0; k < count; k++)
+    {
+        const uint32_t i = m_order[k];
+        if (!crossClass && k > 0 && boxes.classId[i] != boxes.classId[m_order[k - 1]])
+        {
+            // next class bucket
+            listNum = 0;
+        }
+
+        Candidate box;
+        box.left = boxes.left[i];
+        box.top = boxes.top[i];
+        box.right = boxes.right[i];
+        box.bottom = boxes.bottom[i];
+        box.area = (box.right - box.left) * (box.bottom - box.top);
+        // boxes of the same confidence don't suppress each other when not greedy
+        box.minConfidence = m_greedy ? -INFINITY : boxes.confidence[i];
+
+        bool suppressed = overlap(list, 0, listNum, box, m_iouThreshold);
+        if (!suppressed)
+        {
+            keep.push_back(i);
+        }
+        if (!suppressed || !m_greedy)
+        {
+            m_left[listNum] = box.left;
+            m_top[listNum] = box.top;
+            m_right[listNum] = box.right;
+            m_bottom[listNum] = box.bottom;
+            m_area[listNum] = box.area;
+            m_confidence[listNum] = boxes.confidence[i];
+            listNum++;
+        }
+    }
+
+    if (!crossClass)
+    {
+        std::sort(keep.begin(), keep.end(), [&boxes](uint32_t i, uint32_t j) {
+            if (boxes.confidence[i] != boxes.confidence[j])
+                return boxes.confidence[i] > boxes.confidence[j];
+            return i < j;
+        });
+    }
+    return keep.size();
+}
@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __NON_MAX_SUPPRESSION_H__
+#define __NON_MAX_SUPPRESSION_H__
+
+#include "Detections.h"
+
+// Non maximum suppression of the candidate boxes of one image. The boxes are bucketed by class
+// and sorted by decreasing confidence, then each box is compared with the boxes before it in its
+// bucket, several at a time, and the comparison stops at the first overlap.
+class NonMaxSuppression
+{
+public:
+    NonMaxSuppression();
+
+    // boxes overlapping with an intersection over union >= threshold suppress each other
+    void SetIoUThreshold(float threshold) { m_iouThreshold = threshold; }
+
+    // boxes of different classes suppress each other too
+    void SetCrossClass(bool enable) { m_crossClass = enable; }
+
+    // only the kept boxes suppress the boxes of lower confidence. When disabled, a box is dropped
+    // when any box of higher confidence overlaps it, even a dropped one
+    void SetGreedy(bool enable) { m_greedy = enable; }
+
+    // fills keep with the indexes of the kept boxes, by decreasing confidence, returns their number
+    uint32_t Run(const VADetections &boxes, std::vector<uint32_t> &keep);
+
+    // instruction set used for the overlap tests
+    static const char *Isa();
+
+protected:
+    float m_iouThreshold;
+    bool m_crossClass;
+    bool m_greedy;
+
+    // box indexes by class unless cross class, then by decreasing confidence
+    std::vector<uint32_t> m_order;
+    // the boxes of the current bucket that can suppress the next ones, contiguous for the vector loads
+    std::vector<float> m_left;
+    std::vector<float> m_top;
+    std::vector<float> m_right;
+    std::vector<float> m_bottom;
+    std::vector<float> m_area;
+    std::vector<float> m_confidence;
+};
+
+#endif //__NON_MAX_SUPPRESSION_H__
@@ -0,0 +1,257 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "PlanarKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PLANAR_X86
+#endif
+
+// BT.601 limited range, the coefficients are scaled by 256
+static const int Y_R = 66, Y_G = 129, Y_B = 25;
+static const int U_R = -38, U_G = -74, U_B = 112;
+static const int V_R = 112, V_G = -94, V_B = -18;
+
+static inline int ToU8(float value, float scale)
+{
+    value *= scale;
+    // a NaN becomes 0 like with the max instruction of the vector code
+    value = value > 0 ? value : 0;
+    value = value < 255 ? value : 255;
+    return (int)value;
+}
+
+static inline void NV12Row(const float *r, const float *g, const float *b, float scale,
+                           uint8_t *y, uint8_t *uv, uint32_t start, uint32_t width)
+{
+    for (uint32_t x = start; x < width; x++)
+    {
+        int R = ToU8(r[x], scale), G = ToU8(g[x], scale), B = ToU8(b[x], scale);
+        y[x] = ((Y_R * R + Y_G * G + Y_B * B + 128) >> 8) + 16;
+        if (uv && (x % 2) == 0 && x + 1 < width)
+        {
+            uv[x] = ((U_R * R + U_G * G + U_B * B + 128) >> 8) + 128;
+            uv[x + 1] = ((V_R * R + V_G * G + V_B * B + 128) >> 8) + 128;
+        }
+    }
+}
+
+static inline void PlaneRow(const float *src, float scale, uint8_t *dst, uint32_t start, uint32_t width)
+{
+    for (uint32_t x = start; x < width; x++)
+    {
+        dst[x] = ToU8(src[x], scale);
+    }
+}
+
+static inline void ToFloatRange(const uint8_t *src, float *dst, size_t start, size_t count)
+{
+    for (size_t i = start; i < count; i++)
+    {
+        dst[i] = src[i];
+    }
+}
+
+typedef void (*NV12Func)(const float *r, const float *g, const float *b, float scale, uint8_t *y, uint8_t *uv, uint32_t width);
+typedef void (*PlaneFunc)(const float *src, float scale, uint8_t *dst, uint32_t width);
+typedef void (*ToFloatFunc)(const uint8_t *src, float *dst, size_t count);
+
+static void NV12RowScalar(const float *r, const float *g, const float *b, float scale, uint8_t *y, uint8_t *uv, uint32_t width)
+{
+    NV12Row(r, g, b, scale, y, uv, 0, width);
+}
+
+static void PlaneRowScalar(const float *src, float scale, uint8_t *dst, uint32_t width)
+{
+    PlaneRow(src, scale, dst, 0, width);
+}
+
+static void ToFloatScalar(const uint8_t *src, float *dst, size_t count)
+{
+    ToFloatRange(src, dst, 0, count);
+}
+
+#ifdef PLANAR_X86
+__attribute__((target("avx2")))
+static inline __m256i LoadU8(const float *p, __m256 scale)
+{
+    __m256 v = _mm256_mul_ps(_mm256_loadu_ps(p), scale);
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.f));
+    return _mm256_cvttps_epi32(v);
+}
+
+// the pair of 16 bit coefficients multiplying the low and the high halves of the 32 bit lanes
+__attribute__((target("avx2")))
+static inline __m256i Coefficients(int low, int high)
+{
+    return _mm256_set1_epi32((int)((uint32_t)(uint16_t)low | ((uint32_t)(uint16_t)high << 16)));
+}
+
+// (cr * r + cg * g + cb * b + 128) >> 8, with r | g << 16 and b | 1 << 16 in the lanes
+__attribute__((target("avx2")))
+static inline __m256i Weigh(__m256i rg, __m256i b1, int cr, int cg, int cb)
+{
+    __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(rg, Coefficients(cr, cg)), _mm256_madd_epi16(b1, Coefficients(cb, 128)));
+    return _mm256_srai_epi32(sum, 8);
+}
+
+__attribute__((target("avx2")))
+static void NV12RowAVX2(const float *r, const float *g, const float *b, float scale, uint8_t *y, uint8_t *uv, uint32_t width)
+{
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256i one = _mm256_set1_epi32(1 << 16);
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i r0 = LoadU8(r + x, vscale), r1 = LoadU8(r + x + 8, vscale);
+        __m256i g0 = LoadU8(g + x, vscale), g1 = LoadU8(g + x + 8, vscale);
+        __m256i b0 = LoadU8(b + x, vscale), b1 = LoadU8(b + x + 8, vscale);
+
+        __m256i y0 = Weigh(_mm256_or_si256(r0, _mm256_slli_epi32(g0, 16)), _mm256_or_si256(b0, one), Y_R, Y_G, Y_B);
+        __m256i y1 = Weigh(_mm256_or_si256(r1, _mm256_slli_epi32(g1, 16)), _mm256_or_si256(b1, one), Y_R, Y_G, Y_B);
+        __m256i y16 = _mm256_add_epi16(_mm256_permute4x64_epi64(_mm256_packs_epi32(y0, y1), 0xD8), _mm256_set1_epi16(16));
+        __m256i y8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(y16, y16), 0x08);
+        _mm_storeu_si128((__m128i *)(y + x), _mm256_castsi256_si128(y8));
+
+        if (uv)
+        {
+            // the even pixels, 0, 2, ... 14
+            __m256i re = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(r0), _mm256_castsi256_ps(r1), 0x88)), 0xD8);
+            __m256i ge = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(g0), _mm256_castsi256_ps(g1), 0x88)), 0xD8);
+            __m256i be = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(b0), _mm256_castsi256_ps(b1), 0x88)), 0xD8);
+            __m256i rg = _mm256_or_si256(re, _mm256_slli_epi32(ge, 16));
+            __m256i b1e = _mm256_or_si256(be, one);
+            __m256i u = _mm256_add_epi32(Weigh(rg, b1e, U_R, U_G, U_B), _mm256_set1_epi32(128));
+            __m256i v = _mm256_add_epi32(Weigh(rg, b1e, V_R, V_G, V_B), _mm256_set1_epi32(128));
+            // U in the low byte and V in the high byte of each 16 bit lane
+            __m256i uv16 = _mm256_or_si256(u, _mm256_slli_epi32(v, 8));
+            uv16 = _mm256_permute4x64_epi64(_mm256_packus_epi32(uv16, uv16), 0x08);
+            _mm_storeu_si128((__m128i *)(uv + x), _mm256_castsi256_si128(uv16));
+        }
+    }
+    // the scalar code is not VEX encoded, the upper halves must be cleared before it
+    _mm256_zeroupper();
+    NV12Row(r, g, b, scale, y, uv, x, width);
+}
+
+__attribute__((target("avx2")))
+static void PlaneRowAVX2(const float *src, float scale, uint8_t *dst, uint32_t width)
+{
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i p01 = _mm256_packs_epi32(LoadU8(src + x, vscale), LoadU8(src + x + 8, vscale));
+        __m256i p23 = _mm256_packs_epi32(LoadU8(src + x + 16, vscale), LoadU8(src + x + 24, vscale));
+        __m256i p = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(p01, p23), order);
+        _mm256_storeu_si256((__m256i *)(dst + x), p);
+    }
+    _mm256_zeroupper();
+    PlaneRow(src, scale, dst, x, width);
+}
+
+__attribute__((target("avx2")))
+static void ToFloatAVX2(const uint8_t *src, float *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m128i lo = _mm256_castsi256_si128(v);
+        __m128i hi = _mm256_extracti128_si256(v, 1);
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(lo)));
+        _mm256_storeu_ps(dst + i + 8, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8))));
+        _mm256_storeu_ps(dst + i + 16, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(hi)));
+        _mm256_storeu_ps(dst + i + 24, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8))));
+    }
+    _mm256_zeroupper();
+    ToFloatRange(src, dst, i, count);
+}
+#endif
+
+struct PlanarFuncs
+{
+    NV12Func nv12Row;
+    PlaneFunc planeRow;
+    ToFloatFunc toFloat;
+
+    PlanarFuncs():
+        nv12Row(NV12RowScalar),
+        planeRow(PlaneRowScalar),
+        toFloat(ToFloatScalar)
+    {
+#ifdef PLANAR_X86
+        if (__builtin_cpu_supports("avx2"))
+        {
+            nv12Row = NV12RowAVX2;
+            planeRow = PlaneRowAVX2;
+            toFloat = ToFloatAVX2;
+        }
+#endif
+    }
+};
+
+static const PlanarFuncs &Funcs()
+{
+    static const PlanarFuncs funcs;
+    return funcs;
+}
+
+void FloatRGBToNV12(const float *rgb, uint32_t width, uint32_t height, float scale,
+                     uint8_t *y, uint8_t *uv, uint32_t begin, uint32_t end)
+{
+    const PlanarFuncs &funcs = Funcs();
+    size_t planeSize = (size_t)width * height;
+    for (uint32_t row = begin; row < end; row++)
+    {
+        size_t offset = (size_t)row * width;
+        uint8_t *uvRow = (row % 2) ? nullptr : uv + (size_t)(row / 2) * width;
+        funcs.nv12Row(rgb + offset, rgb + planeSize + offset, rgb + 2 * planeSize + offset, scale, y + offset, uvRow, width);
+    }
+}
+
+void FloatToRGBP(const float *rgb, uint32_t width, uint32_t height, uint32_t channels, float scale,
+                 uint8_t *dst, uint32_t begin, uint32_t end)
+{
+    const PlanarFuncs &funcs = Funcs();
+    size_t planeSize = (size_t)width * height;
+    for (uint32_t c = 0; c < channels; c++)
+    {
+        for (uint32_t row = begin; row < end; row++)
+        {
+            size_t offset = c * planeSize + (size_t)row * width;
+            funcs.planeRow(rgb + offset, scale, dst + offset, width);
+        }
+    }
+}
+
+void U8ToFloat(const uint8_t *src, float *dst, size_t count)
+{
+    Funcs().toFloat(src, dst, count);
+}
+
+const char *PlanarKernelsIsa()
+{
+    return Funcs().nv12Row == NV12RowScalar ? "scalar" : "avx2";
+}
@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __PLANAR_KERNELS_H__
+#define __PLANAR_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Conversions between the planar FP32 tensors of the models and 8 bit images. The values of
+// the model outputs are multiplied by a scale and clipped to [0, 255], NV12 uses the BT.601
+// limited range coefficients in 8 bit fixed point and takes the chroma from the even pixels
+// of the even rows.
+
+// converts the rows [begin, end) of the width x height RGB image, begin is even,
+// the UV plane starts at uv and has the same pitch as the Y plane, width
+void FloatRGBToNV12(const float *rgb, uint32_t width, uint32_t height, float scale,
+                     uint8_t *y, uint8_t *uv, uint32_t begin, uint32_t end);
+
+// converts the rows [begin, end) of each of the planes
+void FloatToRGBP(const float *rgb, uint32_t width, uint32_t height, uint32_t channels, float scale,
+                 uint8_t *dst, uint32_t begin, uint32_t end);
+
+// converts count 8 bit values to FP32, e.g. the planes of an RGBP image to the input of a model
+void U8ToFloat(const uint8_t *src, float *dst, size_t count);
+
+// instruction set used by the conversions
+const char *PlanarKernelsIsa();
+
+#endif //__PLANAR_KERNELS_H__
@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "RowBandPool.h"
+#include <algorithm>
+
+RowBandPool::RowBandPool(uint32_t threadNum):
+    m_stop(false),
+    m_generation(0),
+    m_busyWorkers(0),
+    m_func(nullptr),
+    m_rows(0),
+    m_bandRows(0),
+    m_bandNum(0),
+    m_nextBand(0)
+{
+    if (threadNum == 0)
+    {
+        threadNum = std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (uint32_t i = 1; i < threadNum; i++)
+    {
+        m_workers.emplace_back(&RowBandPool::WorkerLoop, this);
+    }
+}
+
+RowBandPool::~RowBandPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_startCond.notify_all();
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void RowBandPool::RunBands()
+{
+    uint32_t band;
+    while ((band = m_nextBand.fetch_add(1, std::memory_order_acquire)) < m_bandNum)
+    {
+        uint32_t begin = band * m_bandRows;
+        uint32_t end = std::min(begin + m_bandRows, m_rows);
+        (*m_func)(begin, end);
+    }
+}
+
+void RowBandPool::WorkerLoop()
+{
+    uint64_t generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCond.wait(lock, [&] { return m_stop || m_generation != generation; });
+            if (m_stop)
+            {
+                return;
+            }
+            generation = m_generation;
+            ++m_busyWorkers;
+        }
+        RunBands();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_busyWorkers;
+        }
+        m_doneCond.notify_one();
+    }
+}
+
+void RowBandPool::Run(uint32_t rows, uint32_t align, const std::function<void(uint32_t, uint32_t)> &func)
+{
+    if (rows == 0)
+    {
+        return;
+    }
+    align = std::max(1u, align);
+    uint32_t bands = ThreadNum() * BANDS_PER_THREAD;
+    uint32_t bandRows = (rows + bands - 1) / bands;
+    bandRows = (bandRows + align - 1) / align * align;
+    if (m_workers.empty() || bandRows >= rows)
+    {
+        func(0, rows);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_func = &func;
+        m_rows = rows;
+        m_bandRows = bandRows;
+        m_bandNum = (rows + bandRows - 1) / bandRows;
+        // published last, a worker claiming a band sees the job
+        m_nextBand.store(0, std::memory_order_release);
+        ++m_generation;
+    }
+    m_startCond.notify_all();
+    RunBands();
+    // the workers that woke up late find no band left, but the job must outlive the ones still running
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCond.wait(lock, [this] { return m_busyWorkers == 0; });
+}
@@ -0,0 +1,78 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __ROW_BAND_POOL_H__
+#define __ROW_BAND_POOL_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Splits the rows of an image in bands processed by a few worker threads and by the caller.
+// The bands are claimed one at a time, so a worker delayed by the rest of the pipeline
+// doesn't hold up the others.
+class RowBandPool
+{
+public:
+    // threadNum counts the caller, 0 uses up to 4 threads
+    explicit RowBandPool(uint32_t threadNum = 0);
+    ~RowBandPool();
+
+    RowBandPool(const RowBandPool&) = delete;
+    RowBandPool& operator=(const RowBandPool&) = delete;
+
+    // calls func(begin, end) over [0, rows), the band limits are multiples of align,
+    // returns once all the bands are done, not reentrant
+    void Run(uint32_t rows, uint32_t align, const std::function<void(uint32_t, uint32_t)> &func);
+
+    inline uint32_t ThreadNum() {return m_workers.size() + 1; }
+
+protected:
+    void WorkerLoop();
+    // processes bands until none is left
+    void RunBands();
+
+    // bands per thread, a few more than threads evens out the load
+    static const uint32_t BANDS_PER_THREAD = 4;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_startCond;
+    std::condition_variable m_doneCond;
+    bool m_stop;
+    // incremented by every Run(), the workers wait for a new one
+    uint64_t m_generation;
+    uint32_t m_busyWorkers;
+
+    // the current job
+    const std::function<void(uint32_t, uint32_t)> *m_func;
+    uint32_t m_rows;
+    uint32_t m_bandRows;
+    uint32_t m_bandNum;
+    std::atomic<uint32_t> m_nextBand;
+};
+
+#endif //__ROW_BAND_POOL_H__
@@ -0,0 +1,103 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SROutput.h"
+#include <logs.h>
+#include <stdlib.h>
+#include <string.h>
+#include "PlanarKernels.h"
+
+SROutput::SROutput():
+    m_scale(1.0)
+{
+}
+
+SROutput::~SROutput()
+{
+    for (auto buffer : m_buffers)
+    {
+        free(buffer->data);
+        delete buffer;
+    }
+}
+
+SROutput::Buffer *SROutput::FreeBuffer(size_t size)
+{
+    for (auto buffer : m_buffers)
+    {
+        if (buffer->size >= size && buffer->ref.load(std::memory_order_acquire) <= 0)
+        {
+            return buffer;
+        }
+    }
+
+    void *data = nullptr;
+    if (posix_memalign(&data, VA_SURFACE_ALIGNMENT, size))
+    {
+        return nullptr;
+    }
+    // the rows below the image in the aligned height are never written
+    memset(data, 0, size);
+    Buffer *buffer = new Buffer;
+    buffer->data = (uint8_t *)data;
+    buffer->size = size;
+    buffer->ref = 0;
+    m_buffers.push_back(buffer);
+    return buffer;
+}
+
+VAData *SROutput::Convert(const float *rgb, uint32_t width, uint32_t height, uint32_t channels, bool nv12)
+{
+    uint32_t alignedHeight = nv12 ? (height + 15) / 16 * 16 : height;
+    size_t size = nv12 ? (size_t)width * alignedHeight * 3 / 2 : (size_t)width * height * channels;
+    Buffer *buffer = FreeBuffer(size);
+    if (!buffer)
+    {
+        ERRLOG("no memory for the %dx%d super resolution output", width, height);
+        return nullptr;
+    }
+    uint8_t *data = buffer->data;
+    float scale = m_scale;
+
+    auto convert = [&](uint32_t begin, uint32_t end) {
+        if (nv12)
+            FloatRGBToNV12(rgb, width, height, scale, data, data + (size_t)width * alignedHeight, begin, end);
+        else
+            FloatToRGBP(rgb, width, height, channels, scale, data, begin, end);
+    };
+    if ((size_t)width * height < MIN_PARALLEL_PIXELS)
+    {
+        convert(0, height);
+    }
+    else
+    {
+        // the NV12 bands start on even rows, which hold the chroma
+        m_bands.Run(height, nv12 ? 2 : 1, convert);
+    }
+
+    uint32_t fourcc = nv12 ? 0x3231564e : 0x50424752; // MFX_FOURCC_NV12 : MFX_FOURCC_RGBP
+    VAData *out = VAData::Create(data, width, alignedHeight, width, fourcc);
+    out->SetExternalRef(&buffer->ref);
+    // held until the caller sets the references, so the next images of the batch take other buffers
+    out->SetRef(1);
+    return out;
+}
@@ -0,0 +1,69 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __SR_OUTPUT_H__
+#define __SR_OUTPUT_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "DataPacket.h"
+#include "RowBandPool.h"
+
+// Creates the NV12 or RGBP surfaces passed down the pipeline from the planar FP32 RGB
+// images of the super resolution models, in buffers reused once the pipeline releases them.
+// The large images are converted by row bands on a few threads.
+class SROutput
+{
+public:
+    SROutput();
+    ~SROutput();
+
+    SROutput(const SROutput&) = delete;
+    SROutput& operator=(const SROutput&) = delete;
+
+    // the model outputs are multiplied by scale to get 8 bit values
+    inline void SetScale(float scale) {m_scale = scale; }
+
+    // creates the surface of one model output, NV12 with the height aligned to 16 or RGBP,
+    // its buffer is reused once the last reference of the data is released
+    VAData *Convert(const float *rgb, uint32_t width, uint32_t height, uint32_t channels, bool nv12);
+
+protected:
+    struct Buffer
+    {
+        uint8_t *data;
+        size_t size;
+        VARefCount ref;
+    };
+    // a released buffer of at least size bytes, a new one if all are in use
+    Buffer *FreeBuffer(size_t size);
+
+    // smaller images are converted by the calling thread alone
+    static const uint32_t MIN_PARALLEL_PIXELS = 256 * 256;
+
+    std::vector<Buffer *> m_buffers;
+    RowBandPool m_bands;
+    float m_scale;
+};
+
+#endif //__SR_OUTPUT_H__
@@ -0,0 +1,124 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SRTiles.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+SRTiles::SRTiles():
+    m_scale(1),
+    m_channels(0)
+{
+}
+
+void SRTiles::Ramps(const std::vector<uint32_t> &origins, uint32_t tileSize, std::vector<std::vector<float>> &ramps)
+{
+    uint32_t outSize = tileSize * m_scale;
+    uint32_t overlap = m_grid.Overlap();
+    float rampSize = (float)(overlap * m_scale);
+    ramps.assign(origins.size(), std::vector<float>(outSize, 1.f));
+    for (uint32_t i = 0; i < origins.size(); i++)
+    {
+        for (uint32_t x = 0; x < outSize; x++)
+        {
+            // no ramp on the edges of the frame, the weight stays above 0 so every pixel has one
+            float weight = 1.f;
+            if (i > 0 && overlap > 0)
+                weight = std::min(weight, (x + 0.5f) / rampSize);
+            if (i + 1 < origins.size() && overlap > 0)
+                weight = std::min(weight, (outSize - x - 0.5f) / rampSize);
+            ramps[i][x] = weight;
+        }
+    }
+    // the tile grid is the product of the columns and the rows, so the sum of the weights of a
+    // pixel is the product of the sums along both axes, dividing the ramps by them blends the
+    // tiles without normalizing the frame afterwards
+    std::vector<float> sums(origins.back() * m_scale + outSize, 0.f);
+    for (uint32_t i = 0; i < origins.size(); i++)
+    {
+        for (uint32_t x = 0; x < outSize; x++)
+        {
+            sums[origins[i] * m_scale + x] += ramps[i][x];
+        }
+    }
+    for (uint32_t i = 0; i < origins.size(); i++)
+    {
+        for (uint32_t x = 0; x < outSize; x++)
+        {
+            ramps[i][x] /= sums[origins[i] * m_scale + x];
+        }
+    }
+}
+
+int SRTiles::Configure(const TileGrid &grid, uint32_t scale, uint32_t channels)
+{
+    if (scale == 0 || grid.TileNum() == 0)
+    {
+        printf("ERROR: no tiles to upscale %d times\n", scale);
+        return -1;
+    }
+    m_grid = grid;
+    m_scale = scale;
+    m_channels = channels;
+
+    Ramps(m_grid.Columns(), m_grid.TileWidth(), m_columnRamps);
+    Ramps(m_grid.Rows(), m_grid.TileHeight(), m_rowRamps);
+
+    size_t imageSize = (size_t)m_channels * OutputWidth() * OutputHeight();
+    m_gather.Configure(m_grid.TileNum(), [imageSize]() { return new float[imageSize]; });
+    return 0;
+}
+
+float *SRTiles::AddTile(uint32_t channel, uint32_t frame, uint32_t roi, uint32_t tile, const float *output)
+{
+    return m_gather.AddTile(channel, frame, roi, tile, [&](float *image, bool first) {
+        size_t planeSize = (size_t)OutputWidth() * OutputHeight();
+        if (first)
+        {
+            memset(image, 0, m_channels * planeSize * sizeof(float));
+        }
+        uint32_t column = tile % m_grid.Columns().size();
+        uint32_t row = tile / m_grid.Columns().size();
+        uint32_t tileWidth = m_grid.TileWidth() * m_scale;
+        uint32_t tileHeight = m_grid.TileHeight() * m_scale;
+        uint32_t width = OutputWidth();
+        uint32_t tileX, tileY;
+        m_grid.TileOrigin(tile, &tileX, &tileY);
+        size_t origin = (size_t)tileY * m_scale * width + tileX * m_scale;
+        const float *columnRamp = m_columnRamps[column].data();
+        const float *rowRamp = m_rowRamps[row].data();
+        for (uint32_t c = 0; c < m_channels; c++)
+        {
+            for (uint32_t y = 0; y < tileHeight; y++)
+            {
+                const float *src = output + ((size_t)c * tileHeight + y) * tileWidth;
+                float *dst = image + c * planeSize + origin + (size_t)y * width;
+                float weight = rowRamp[y];
+                for (uint32_t x = 0; x < tileWidth; x++)
+                {
+                    dst[x] += src[x] * weight * columnRamp[x];
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __SR_TILES_H__
+#define __SR_TILES_H__
+
+#include <stdint.h>
+#include <vector>
+#include "TileGather.h"
+#include "TileGrid.h"
+
+// Blends the upscaled tiles of a super resolution model back into the frame. The weight of a
+// tile ramps up from its inner edges across the overlap, so the seams fade from one tile to the
+// next. The tiles of a frame can come back in any order and from several inference requests.
+class SRTiles
+{
+public:
+    SRTiles();
+
+    SRTiles(const SRTiles&) = delete;
+    SRTiles& operator=(const SRTiles&) = delete;
+
+    // tiles of the grid upscaled scale times, with channels planes
+    int Configure(const TileGrid &grid, uint32_t scale, uint32_t channels);
+
+    inline uint32_t OutputWidth() {return m_grid.FrameWidth() * m_scale; }
+    inline uint32_t OutputHeight() {return m_grid.FrameHeight() * m_scale; }
+
+    // adds the planar upscaled tile of an image, returns the planar blended image once all
+    // its tiles are in, nullptr before, the image must be given back with Release()
+    float *AddTile(uint32_t channel, uint32_t frame, uint32_t roi, uint32_t tile, const float *output);
+    // a tile whose inference failed, the image isn't blended, its other tiles are only counted
+    void DropTile(uint32_t channel, uint32_t frame, uint32_t roi, uint32_t tile)
+    {
+        m_gather.DropTile(channel, frame, roi, tile);
+    }
+    void Release(float *image) { m_gather.Release(image); }
+
+protected:
+    // weights of the upscaled tiles along one axis, they add up to 1 on every pixel
+    void Ramps(const std::vector<uint32_t> &origins, uint32_t tileSize, std::vector<std::vector<float>> &ramps);
+
+    TileGrid m_grid;
+    uint32_t m_scale;
+    uint32_t m_channels;
+
+    std::vector<std::vector<float>> m_columnRamps;
+    std::vector<std::vector<float>> m_rowRamps;
+
+    // the planar images being blended
+    TileGather<float[]> m_gather;
+};
+
+#endif //__SR_TILES_H__
@@ -0,0 +1,185 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef __TILE_GATHER_H__
+#define __TILE_GATHER_H__
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Gathers the results of the tiles of a frame into one image per channel, frame and roi. The tiles
+// can come back in any order and from several inference requests, the image is handed out once
+// all of them are counted. T is the type of the image, an array type like float[] for a buffer,
+// the images are recycled through a free list.
+template <typename T>
+class TileGather
+{
+public:
+    typedef typename std::remove_extent<T>::type *Image;
+
+    TileGather():
+        m_tileNum(0)
+    {
+    }
+
+    ~TileGather()
+    {
+        for (auto ite = m_pending.begin(); ite != m_pending.end(); ite ++)
+        {
+            Delete(ite->second.image);
+        }
+        FreeImages();
+    }
+
+    TileGather(const TileGather&) = delete;
+    TileGather& operator=(const TileGather&) = delete;
+
+    // tileNum tiles per image, create allocates an image when the free list is empty, the free
+    // images of the previous configuration are deleted
+    void Configure(uint32_t tileNum, const std::function<Image()> &create)
+    {
+        m_tileNum = tileNum;
+        m_create = create;
+        FreeImages();
+    }
+
+    // accumulates one tile into its image with add(image, first), first on the first tile of a
+    // new image, returns the image once all its tiles are in, nullptr before or once a tile of
+    // the image was dropped, the image must be given back with Release()
+    template <typename Add>
+    Image AddTile(uint32_t channel, uint32_t frame, uint32_t roi, uint32_t tile, const Add &add)
+    {
+        if (tile >= m_tileNum)
+        {
+            return nullptr;
+        }
+        bool first = false;
+        auto ite = Find(channel, frame, roi, &first);
+        Pending &pending = ite->second;
+        if (first)
+        {
+            if (m_freeImages.empty())
+            {
+                pending.image = m_create();
+            }
+            else
+            {
+                pending.image = m_freeImages.back();
+                m_freeImages.pop_back();
+            }
+        }
+        if (pending.image)
+        {
+            add(pending.image, first);
+        }
+        if (++ pending.tilesIn < m_tileNum)
+        {
+            return nullptr;
+        }
+        Image image = pending.image;
+        m_pending.erase(ite);
+        return image;
+    }
+
+    // a tile whose inference failed, the image is never handed out, its other tiles are only counted
+    void DropTile(uint32_t channel, uint32_t frame, uint32_t roi, uint32_t tile)
+    {
+        if (tile >= m_tileNum)
+        {
+            return;
+        }
+        auto ite = Find(channel, frame, roi, nullptr);
+        Pending &pending = ite->second;
+        Release(pending.image);
+        pending.image = nullptr;
+        if (++ pending.tilesIn == m_tileNum)
+        {
+            m_pending.erase(ite);
+        }
+    }
+
+    void Release(Image image)
+    {
+        if (image)
+        {
+            m_freeImages.push_back(image);
+        }
+    }
+
+protected:
+    // the image being gathered, nullptr once a tile of the image is dropped
+    struct Pending
+    {
+        Image image;
+        uint32_t tilesIn;
+    };
+    typedef std::map<std::tuple<uint32_t, uint32_t, uint32_t>, Pending> PendingMap;
+
+    typename PendingMap::iterator Find(uint32_t channel, uint32_t frame, uint32_t roi, bool *inserted)
+    {
+        auto key = std::make_tuple(channel, frame, roi);
+        auto ite = m_pending.find(key);
+        if (ite == m_pending.end())
+        {
+            Pending pending;
+            pending.image = nullptr;
+            pending.tilesIn = 0;
+            ite = m_pending.insert(std::make_pair(key, pending)).first;
+            if (inserted)
+            {
+                *inserted = true;
+            }
+        }
+        return ite;
+    }
+
+    static void Delete(Image image)
+    {
+        if (image)
+        {
+            std::default_delete<T>()(image);
+        }
+    }
+
+    void FreeImages()
+    {
+        for (auto image : m_freeImages)
+        {
+            Delete(image);
+        }
+        m_freeImages.clear();
+    }
+
+    uint32_t m_tileNum;
+    std::function<Image()> m_create;
+
+    PendingMap m_pending;
+    std::vector<Image> m_freeImages;
+};
+
+#endif //__TILE_GATHER_H__
@@ -0,0 +1,77 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TileGrid.h"
+#include <stdio.h>
+#include <algorithm>
+
+TileGrid::TileGrid():
+    m_frameWidth(0),
+    m_frameHeight(0),
+    m_tileWidth(0),
+    m_tileHeight(0),
+    m_overlap(0)
+{
+}
+
+void TileGrid::Split(uint32_t size, uint32_t tileSize, uint32_t overlap, std::vector<uint32_t> &origins)
+{
+    origins.clear();
+    if (size <= tileSize)
+    {
+        origins.push_back(0);
+        return;
+    }
+    // the fewest tiles overlapping by at least overlap
+    uint32_t num = (size - overlap + (tileSize - overlap) - 1) / (tileSize - overlap);
+    num = std::max(num, 2u);
+    for (uint32_t i = 0; i < num; i++)
+    {
+        origins.push_back((uint32_t)((uint64_t)i * (size - tileSize) / (num - 1)));
+    }
+}
+
+int TileGrid::Configure(uint32_t frameWidth, uint32_t frameHeight, uint32_t tileWidth, uint32_t tileHeight, uint32_t overlap)
+{
+    if (frameWidth < tileWidth || frameHeight < tileHeight || tileWidth == 0 || tileHeight == 0)
+    {
+        printf("ERROR: %dx%d frames can't be split in %dx%d tiles\n", frameWidth, frameHeight, tileWidth, tileHeight);
+        return -1;
+    }
+    // a tile must keep pixels of its own
+    uint32_t maxOverlap = std::min(tileWidth, tileHeight) / 2;
+    if (overlap > maxOverlap)
+    {
+        printf("tile overlap %d reduced to %d\n", overlap, maxOverlap);
+        overlap = maxOverlap;
+    }
+
+    m_frameWidth = frameWidth;
+    m_frameHeight = frameHeight;
+    m_tileWidth = tileWidth;
+    m_tileHeight = tileHeight;
+    m_overlap = overlap;
+
+    Split(frameWidth, tileWidth, overlap, m_columns);
+    Split(frameHeight, tileHeight, overlap, m_rows);
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __TILE_GRID_H__
+#define __TILE_GRID_H__
+
+#include <stdint.h>
+#include <vector>
+
+// Splits the frames larger than the input of a model in tiles of the input size, overlapping by at
+// least the configured number of pixels. The grid is the product of the tile origins along both
+// axes, tile t is at column t % columns and row t / columns. The tiles of an image go through the
+// inference requests as rois, with the tile index in the low bits of the roi index.
+class TileGrid
+{
+public:
+    TileGrid();
+
+    // the frame must be at least as large as a tile, the overlap is reduced to half a tile
+    int Configure(uint32_t frameWidth, uint32_t frameHeight, uint32_t tileWidth, uint32_t tileHeight, uint32_t overlap);
+
+    inline uint32_t TileNum() const {return m_columns.size() * m_rows.size(); }
+    // top left corner of the tile in the frame
+    inline void TileOrigin(uint32_t tile, uint32_t *x, uint32_t *y) const
+    {
+        *x = m_columns[tile % m_columns.size()];
+        *y = m_rows[tile / m_columns.size()];
+    }
+    inline const std::vector<uint32_t> &Columns() const {return m_columns; }
+    inline const std::vector<uint32_t> &Rows() const {return m_rows; }
+    inline uint32_t FrameWidth() const {return m_frameWidth; }
+    inline uint32_t FrameHeight() const {return m_frameHeight; }
+    inline uint32_t TileWidth() const {return m_tileWidth; }
+    inline uint32_t TileHeight() const {return m_tileHeight; }
+    inline uint32_t Overlap() const {return m_overlap; }
+
+    // the roi index of a tile through the inference requests
+    static inline uint32_t TileRoi(uint32_t roi, uint32_t tile) {return (roi << 16) | tile; }
+    static inline uint32_t RoiOf(uint32_t tileRoi) {return tileRoi >> 16; }
+    static inline uint32_t TileOf(uint32_t tileRoi) {return tileRoi & 0xffff; }
+
+protected:
+    // tile origins along one axis, evenly spread from 0 to size - tileSize
+    static void Split(uint32_t size, uint32_t tileSize, uint32_t overlap, std::vector<uint32_t> &origins);
+
+    uint32_t m_frameWidth;
+    uint32_t m_frameHeight;
+    uint32_t m_tileWidth;
+    uint32_t m_tileHeight;
+    uint32_t m_overlap;
+
+    std::vector<uint32_t> m_columns;
+    std::vector<uint32_t> m_rows;
+};
+
+#endif //__TILE_GRID_H__
@@ -0,0 +1,207 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TopK.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOP_K_X86
+#endif
+
+// keeps the sorted top scores, the new score is known to be higher than the lowest one when num == k
+static inline void Insert(int index, float score, uint32_t k, uint32_t &num, int *classes, float *topScores)
+{
+    uint32_t pos = (num < k) ? num : k - 1;
+    while (pos > 0 && score > topScores[pos - 1])
+    {
+        topScores[pos] = topScores[pos - 1];
+        classes[pos] = classes[pos - 1];
+        pos--;
+    }
+    topScores[pos] = score;
+    classes[pos] = index;
+    if (num < k)
+    {
+        num++;
+    }
+}
+
+// the lowest score a new score must exceed
+static inline float Bound(uint32_t k, uint32_t num, const float *topScores)
+{
+    return (num < k) ? -INFINITY : topScores[k - 1];
+}
+
+typedef uint32_t (*TopKFunc)(const float *scores, uint32_t count, uint32_t k, int *classes, float *topScores);
+typedef float (*SoftmaxSumFunc)(const float *scores, uint32_t count, float max);
+
+static uint32_t TopKScalar(const float *scores, uint32_t count, uint32_t k, int *classes, float *topScores)
+{
+    uint32_t num = 0;
+    float bound = -INFINITY;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (scores[i] > bound)
+        {
+            Insert(i, scores[i], k, num, classes, topScores);
+            bound = Bound(k, num, topScores);
+        }
+    }
+    return num;
+}
+
+static float SoftmaxSumScalar(const float *scores, uint32_t count, float max)
+{
+    float sum = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sum += std::exp(scores[i] - max);
+    }
+    return sum;
+}
+
+#ifdef TOP_K_X86
+__attribute__((target("avx2")))
+static uint32_t TopKAVX2(const float *scores, uint32_t count, uint32_t k, int *classes, float *topScores)
+{
+    uint32_t num = 0;
+    float bound = -INFINITY;
+    __m256 vbound = _mm256_set1_ps(bound);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(scores + i), vbound, _CMP_GT_OQ));
+        while (mask)
+        {
+            uint32_t j = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+            // the bound may have risen with the previous lanes
+            if (scores[j] > bound)
+            {
+                Insert(j, scores[j], k, num, classes, topScores);
+                bound = Bound(k, num, topScores);
+            }
+        }
+        vbound = _mm256_set1_ps(bound);
+    }
+    for (; i < count; i++)
+    {
+        if (scores[i] > bound)
+        {
+            Insert(i, scores[i], k, num, classes, topScores);
+            bound = Bound(k, num, topScores);
+        }
+    }
+    return num;
+}
+
+// exp of 8 floats, Cephes polynomial after reducing x to n * ln2 + r, |r| <= ln2 / 2
+__attribute__((target("avx2,fma")))
+static inline __m256 Exp(__m256 x)
+{
+    x = _mm256_min_ps(x, _mm256_set1_ps(88.3762626647949f));
+    x = _mm256_max_ps(x, _mm256_set1_ps(-87.3365447504f));
+    __m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(1.44269504088896341f), _mm256_set1_ps(0.5f)));
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), x);
+    __m256 y = _mm256_set1_ps(1.9875691500E-4f);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507E-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073E-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894E-2f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459E-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201E-1f));
+    y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x), _mm256_add_ps(x, _mm256_set1_ps(1.f)));
+    __m256i pow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+}
+
+__attribute__((target("avx2,fma")))
+static float SoftmaxSumAVX2(const float *scores, uint32_t count, float max)
+{
+    const __m256 vmax = _mm256_set1_ps(max);
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        sum0 = _mm256_add_ps(sum0, Exp(_mm256_sub_ps(_mm256_loadu_ps(scores + i), vmax)));
+        sum1 = _mm256_add_ps(sum1, Exp(_mm256_sub_ps(_mm256_loadu_ps(scores + i + 8), vmax)));
+    }
+    for (; i + 8 <= count; i += 8)
+    {
+        sum0 = _mm256_add_ps(sum0, Exp(_mm256_sub_ps(_mm256_loadu_ps(scores + i), vmax)));
+    }
+    __m256 sum = _mm256_add_ps(sum0, sum1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    float total = _mm_cvtss_f32(half);
+    // the scalar code is not VEX encoded, the upper halves must be cleared before it
+    _mm256_zeroupper();
+    return total + SoftmaxSumScalar(scores + i, count - i, max);
+}
+#endif
+
+struct TopKFuncs
+{
+    TopKFunc topK;
+    SoftmaxSumFunc softmaxSum;
+
+    TopKFuncs():
+        topK(TopKScalar),
+        softmaxSum(SoftmaxSumScalar)
+    {
+#ifdef TOP_K_X86
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        {
+            topK = TopKAVX2;
+            softmaxSum = SoftmaxSumAVX2;
+        }
+#endif
+    }
+};
+
+static const TopKFuncs &Funcs()
+{
+    static const TopKFuncs funcs;
+    return funcs;
+}
+
+uint32_t TopKScores(const float *scores, uint32_t count, uint32_t k, int *classes, float *topScores)
+{
+    if (k == 0)
+    {
+        return 0;
+    }
+    return Funcs().topK(scores, count, k, classes, topScores);
+}
+
+float SoftmaxSum(const float *scores, uint32_t count, float max)
+{
+    return Funcs().softmaxSum(scores, count, max);
+}
+
+const char *TopKIsa()
+{
+    return Funcs().topK == TopKScalar ? "scalar" : "avx2";
+}
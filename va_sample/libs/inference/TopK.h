@@ -0,0 +1,41 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __TOP_K_H__
+#define __TOP_K_H__
+
+#include <stdint.h>
+
+// Classifier head helpers. The scores are scanned several at a time against the lowest
+// score kept so far, so the few scores that can enter the top k are the only ones looked at.
+
+// writes the k highest scores and their indexes by decreasing score, an equal score keeps
+// the lower index first, returns the number written, less than k when count < k
+uint32_t TopKScores(const float *scores, uint32_t count, uint32_t k, int *classes, float *topScores);
+
+// sum of exp(scores[i] - max), the softmax probability of score x is exp(x - max) / sum
+float SoftmaxSum(const float *scores, uint32_t count, float max);
+
+// instruction set used by the scans
+const char *TopKIsa();
+
+#endif //__TOP_K_H__
@@ -0,0 +1,191 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "YOLODecode.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define YOLO_DECODE_X86
+#endif
+
+static inline float sigmoid(float x) {
+    return 1.f / (1.f + std::exp(-x));
+}
+
+// Lowest raw score whose sigmoid can reach p. It is lowered by a margin larger than the
+// rounding errors of the sigmoid, the boxes are then checked on the sigmoid itself, so the
+// results are the same as when computing the sigmoid of every score. Close to 1 the logit
+// gets very steep, the bound stops at the one of 0.999.
+static inline float LogitBound(float p)
+{
+    if (p <= 0.f)
+    {
+        return -INFINITY;
+    }
+    if (p > 0.999f)
+    {
+        p = 0.999f;
+    }
+    return std::log(p / (1.f - p)) - 1e-3f;
+}
+
+// writes the indexes of the scores >= bound to cells, returns their number
+typedef uint32_t (*ScanFunc)(const float *scores, uint32_t count, float bound, uint32_t *cells);
+
+static uint32_t ScanScalar(const float *scores, uint32_t count, float bound, uint32_t *cells)
+{
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (scores[i] >= bound)
+        {
+            cells[found++] = i;
+        }
+    }
+    return found;
+}
+
+#ifdef YOLO_DECODE_X86
+__attribute__((target("avx2")))
+static uint32_t ScanAVX2(const float *scores, uint32_t count, float bound, uint32_t *cells)
+{
+    const __m256 vbound = _mm256_set1_ps(bound);
+    uint32_t found = 0;
+    uint32_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256 c0 = _mm256_cmp_ps(_mm256_loadu_ps(scores + i), vbound, _CMP_GE_OQ);
+        __m256 c1 = _mm256_cmp_ps(_mm256_loadu_ps(scores + i + 8), vbound, _CMP_GE_OQ);
+        __m256 c2 = _mm256_cmp_ps(_mm256_loadu_ps(scores + i + 16), vbound, _CMP_GE_OQ);
+        __m256 c3 = _mm256_cmp_ps(_mm256_loadu_ps(scores + i + 24), vbound, _CMP_GE_OQ);
+        // almost all the cells are background, 32 of them are skipped with one test
+        __m256 any = _mm256_or_ps(_mm256_or_ps(c0, c1), _mm256_or_ps(c2, c3));
+        if (_mm256_testz_ps(any, any))
+        {
+            continue;
+        }
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(c0) | ((uint32_t)_mm256_movemask_ps(c1) << 8) |
+                        ((uint32_t)_mm256_movemask_ps(c2) << 16) | ((uint32_t)_mm256_movemask_ps(c3) << 24);
+        while (mask)
+        {
+            cells[found++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    for (; i < count; i++)
+    {
+        if (scores[i] >= bound)
+        {
+            cells[found++] = i;
+        }
+    }
+    return found;
+}
+#endif
+
+static ScanFunc SelectScan()
+{
+#ifdef YOLO_DECODE_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return ScanAVX2;
+    }
+#endif
+    return ScanScalar;
+}
+
+static ScanFunc Scan()
+{
+    static const ScanFunc scan = SelectScan();
+    return scan;
+}
+
+const char *YOLODecodeIsa()
+{
+    return Scan() == ScanScalar ? "scalar" : "avx2";
+}
+
+void YOLODecodeRegion(const float *output, const YOLORegionLayout &layout, uint32_t scaledW, uint32_t scaledH,
+                      float threshold, VADetections &boxes, std::vector<uint32_t> &cells)
+{
+    const int sideW = layout.sideW;
+    const int sideH = layout.sideH;
+    const uint32_t entriesNum = sideW * sideH;
+    const uint32_t anchorSize = (layout.coords + layout.classes + 1) * entriesNum;
+    const float objectnessBound = LogitBound(threshold);
+    if (cells.size() < entriesNum)
+    {
+        cells.resize(entriesNum);
+    }
+    ScanFunc scan = Scan();
+
+    for (int n = 0; n < layout.num; ++n)
+    {
+        const float *box = output + n * anchorSize;
+        const float *objectness = box + layout.coords * entriesNum;
+        const float *classScores = objectness + entriesNum;
+
+        uint32_t found = scan(objectness, entriesNum, objectnessBound, cells.data());
+        for (uint32_t k = 0; k < found; k++)
+        {
+            const uint32_t i = cells[k];
+            float scale = sigmoid(objectness[i]);
+            if (!(scale >= threshold))
+            {
+                continue;
+            }
+
+            int row = i / sideW;
+            int col = i % sideW;
+            double x = (col + sigmoid(box[i + 0 * entriesNum])) / sideW;
+            double y = (row + sigmoid(box[i + 1 * entriesNum])) / sideH;
+            double height = std::exp(box[i + 3 * entriesNum]) * layout.anchors[2 * n + 1] / scaledH;
+            double width = std::exp(box[i + 2 * entriesNum]) * layout.anchors[2 * n] / scaledW;
+
+            float l = (float)(x - width / 2);
+            float t = (float)(y - height / 2);
+            float r = (float)(x + width / 2);
+            float b = (float)(y + height / 2);
+            if (l < 0.0) l = 0.0;
+            if (t < 0.0) t = 0.0;
+            if (r > 1.0) r = 1.0;
+            if (b > 1.0) b = 1.0;
+
+            const float classBound = LogitBound(threshold / scale);
+            for (int j = 0; j < layout.classes; ++j)
+            {
+                float raw = classScores[j * entriesNum + i];
+                if (raw < classBound)
+                {
+                    continue;
+                }
+                float prob = scale * sigmoid(raw);
+                if (prob >= threshold)
+                {
+                    // use j+1 instead of j: to make the class label starts from 1 instead of 0.
+                    boxes.Push(l, t, r, b, j + 1, prob);
+                }
+            }
+        }
+    }
+}
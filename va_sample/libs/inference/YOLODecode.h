@@ -0,0 +1,51 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __YOLO_DECODE_H__
+#define __YOLO_DECODE_H__
+
+#include "Detections.h"
+
+// one region output of YOLO for one image: for each anchor, the box coordinates, the
+// objectness and the class scores, each a plane of sideW * sideH cells
+struct YOLORegionLayout
+{
+    int num;
+    int classes;
+    int coords;
+    int sideW;
+    int sideH;
+    // width and height of each anchor
+    const float *anchors;
+};
+
+// Appends the boxes of the region with objectness * class probability >= threshold to boxes.
+// The raw objectness logits are compared with logit(threshold) several cells at a time, so
+// the sigmoid is only computed for the few cells that can pass. cells is a scratch buffer.
+// Class ids start from 1.
+void YOLODecodeRegion(const float *output, const YOLORegionLayout &layout, uint32_t scaledW, uint32_t scaledH,
+                      float threshold, VADetections &boxes, std::vector<uint32_t> &cells);
+
+// instruction set used to scan the objectness planes
+const char *YOLODecodeIsa();
+
+#endif //__YOLO_DECODE_H__
@@ -0,0 +1,394 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ImageKernels.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VA_IMAGE_X86
+#endif
+
+typedef void (*CopyPlaneFunc)(uint8_t *dst, uint32_t dstPitch, const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height);
+typedef void (*BGRAToRGBPFunc)(uint8_t *r, uint8_t *g, uint8_t *b, uint32_t dstPitch,
+                               const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height);
+
+static void CopyPlaneScalar(uint8_t *dst, uint32_t dstPitch, const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    if (dstPitch == width && srcPitch == width)
+    {
+        memcpy(dst, src, (size_t)width * height);
+        return;
+    }
+    for (uint32_t i = 0; i < height; i++)
+    {
+        memcpy(dst + (size_t)i * dstPitch, src + (size_t)i * srcPitch, width);
+    }
+}
+
+static inline void BGRAToRGBPRow(uint8_t *r, uint8_t *g, uint8_t *b, const uint8_t *src, uint32_t start, uint32_t width)
+{
+    for (uint32_t j = start; j < width; j++)
+    {
+        b[j] = src[j * 4];
+        g[j] = src[j * 4 + 1];
+        r[j] = src[j * 4 + 2];
+    }
+}
+
+static void BGRAToRGBPScalar(uint8_t *r, uint8_t *g, uint8_t *b, uint32_t dstPitch,
+                             const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    for (uint32_t i = 0; i < height; i++)
+    {
+        size_t offset = (size_t)i * dstPitch;
+        BGRAToRGBPRow(r + offset, g + offset, b + offset, src + (size_t)i * srcPitch, 0, width);
+    }
+}
+
+#ifdef VA_IMAGE_X86
+
+// the streaming loads need aligned addresses, so every row must start aligned
+static inline bool CanStream(const uint8_t *src, uint32_t srcPitch, uint32_t alignment)
+{
+    return ((uintptr_t)src % alignment) == 0 && (srcPitch % alignment) == 0;
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i Load128(const uint8_t *p, bool stream)
+{
+    return stream ? _mm_stream_load_si128((__m128i *)p) : _mm_loadu_si128((const __m128i *)p);
+}
+
+__attribute__((target("sse4.1")))
+static void CopyPlaneSSE4(uint8_t *dst, uint32_t dstPitch, const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    bool stream = CanStream(src, srcPitch, 16);
+    for (uint32_t i = 0; i < height; i++)
+    {
+        const uint8_t *s = src + (size_t)i * srcPitch;
+        uint8_t *d = dst + (size_t)i * dstPitch;
+        uint32_t x = 0;
+        for (; x + 64 <= width; x += 64)
+        {
+            __m128i v0 = Load128(s + x, stream);
+            __m128i v1 = Load128(s + x + 16, stream);
+            __m128i v2 = Load128(s + x + 32, stream);
+            __m128i v3 = Load128(s + x + 48, stream);
+            _mm_storeu_si128((__m128i *)(d + x), v0);
+            _mm_storeu_si128((__m128i *)(d + x + 16), v1);
+            _mm_storeu_si128((__m128i *)(d + x + 32), v2);
+            _mm_storeu_si128((__m128i *)(d + x + 48), v3);
+        }
+        for (; x + 16 <= width; x += 16)
+        {
+            _mm_storeu_si128((__m128i *)(d + x), Load128(s + x, stream));
+        }
+        memcpy(d + x, s + x, width - x);
+    }
+}
+
+// 16 BGRA pixels to 16 bytes of each plane: gather the components of 4 pixels in each
+// 32 bit lane, then transpose the lanes of the 4 vectors
+__attribute__((target("sse4.1")))
+static void BGRAToRGBPSSE4(uint8_t *r, uint8_t *g, uint8_t *b, uint32_t dstPitch,
+                           const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    const __m128i mask = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    bool stream = CanStream(src, srcPitch, 16);
+    for (uint32_t i = 0; i < height; i++)
+    {
+        const uint8_t *s = src + (size_t)i * srcPitch;
+        size_t offset = (size_t)i * dstPitch;
+        uint32_t x = 0;
+        for (; x + 16 <= width; x += 16)
+        {
+            __m128i v0 = _mm_shuffle_epi8(Load128(s + x * 4, stream), mask);
+            __m128i v1 = _mm_shuffle_epi8(Load128(s + x * 4 + 16, stream), mask);
+            __m128i v2 = _mm_shuffle_epi8(Load128(s + x * 4 + 32, stream), mask);
+            __m128i v3 = _mm_shuffle_epi8(Load128(s + x * 4 + 48, stream), mask);
+            __m128i bg01 = _mm_unpacklo_epi32(v0, v1);
+            __m128i ra01 = _mm_unpackhi_epi32(v0, v1);
+            __m128i bg23 = _mm_unpacklo_epi32(v2, v3);
+            __m128i ra23 = _mm_unpackhi_epi32(v2, v3);
+            _mm_storeu_si128((__m128i *)(b + offset + x), _mm_unpacklo_epi64(bg01, bg23));
+            _mm_storeu_si128((__m128i *)(g + offset + x), _mm_unpackhi_epi64(bg01, bg23));
+            _mm_storeu_si128((__m128i *)(r + offset + x), _mm_unpacklo_epi64(ra01, ra23));
+        }
+        BGRAToRGBPRow(r + offset, g + offset, b + offset, s, x, width);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i Load256(const uint8_t *p, bool stream)
+{
+    return stream ? _mm256_stream_load_si256((const __m256i *)p) : _mm256_loadu_si256((const __m256i *)p);
+}
+
+__attribute__((target("avx2")))
+static void CopyPlaneAVX2(uint8_t *dst, uint32_t dstPitch, const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    bool stream = CanStream(src, srcPitch, 32);
+    for (uint32_t i = 0; i < height; i++)
+    {
+        const uint8_t *s = src + (size_t)i * srcPitch;
+        uint8_t *d = dst + (size_t)i * dstPitch;
+        uint32_t x = 0;
+        for (; x + 128 <= width; x += 128)
+        {
+            __m256i v0 = Load256(s + x, stream);
+            __m256i v1 = Load256(s + x + 32, stream);
+            __m256i v2 = Load256(s + x + 64, stream);
+            __m256i v3 = Load256(s + x + 96, stream);
+            _mm256_storeu_si256((__m256i *)(d + x), v0);
+            _mm256_storeu_si256((__m256i *)(d + x + 32), v1);
+            _mm256_storeu_si256((__m256i *)(d + x + 64), v2);
+            _mm256_storeu_si256((__m256i *)(d + x + 96), v3);
+        }
+        for (; x + 32 <= width; x += 32)
+        {
+            _mm256_storeu_si256((__m256i *)(d + x), Load256(s + x, stream));
+        }
+        memcpy(d + x, s + x, width - x);
+    }
+}
+
+// same as the SSE4 version in each 128 bit lane, then the 4 pixel groups are put back in order
+__attribute__((target("avx2")))
+static void BGRAToRGBPAVX2(uint8_t *r, uint8_t *g, uint8_t *b, uint32_t dstPitch,
+                           const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    const __m256i mask = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                          0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    bool stream = CanStream(src, srcPitch, 32);
+    for (uint32_t i = 0; i < height; i++)
+    {
+        const uint8_t *s = src + (size_t)i * srcPitch;
+        size_t offset = (size_t)i * dstPitch;
+        uint32_t x = 0;
+        for (; x + 32 <= width; x += 32)
+        {
+            __m256i v0 = _mm256_shuffle_epi8(Load256(s + x * 4, stream), mask);
+            __m256i v1 = _mm256_shuffle_epi8(Load256(s + x * 4 + 32, stream), mask);
+            __m256i v2 = _mm256_shuffle_epi8(Load256(s + x * 4 + 64, stream), mask);
+            __m256i v3 = _mm256_shuffle_epi8(Load256(s + x * 4 + 96, stream), mask);
+            __m256i bg01 = _mm256_unpacklo_epi32(v0, v1);
+            __m256i ra01 = _mm256_unpackhi_epi32(v0, v1);
+            __m256i bg23 = _mm256_unpacklo_epi32(v2, v3);
+            __m256i ra23 = _mm256_unpackhi_epi32(v2, v3);
+            __m256i vb = _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(bg01, bg23), order);
+            __m256i vg = _mm256_permutevar8x32_epi32(_mm256_unpackhi_epi64(bg01, bg23), order);
+            __m256i vr = _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(ra01, ra23), order);
+            _mm256_storeu_si256((__m256i *)(b + offset + x), vb);
+            _mm256_storeu_si256((__m256i *)(g + offset + x), vg);
+            _mm256_storeu_si256((__m256i *)(r + offset + x), vr);
+        }
+        BGRAToRGBPRow(r + offset, g + offset, b + offset, s, x, width);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i Load512(const uint8_t *p, bool stream)
+{
+    return stream ? _mm512_stream_load_si512((void *)p) : _mm512_loadu_si512((const void *)p);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void CopyPlaneAVX512(uint8_t *dst, uint32_t dstPitch, const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    bool stream = CanStream(src, srcPitch, 64);
+    for (uint32_t i = 0; i < height; i++)
+    {
+        const uint8_t *s = src + (size_t)i * srcPitch;
+        uint8_t *d = dst + (size_t)i * dstPitch;
+        uint32_t x = 0;
+        for (; x + 256 <= width; x += 256)
+        {
+            __m512i v0 = Load512(s + x, stream);
+            __m512i v1 = Load512(s + x + 64, stream);
+            __m512i v2 = Load512(s + x + 128, stream);
+            __m512i v3 = Load512(s + x + 192, stream);
+            _mm512_storeu_si512((void *)(d + x), v0);
+            _mm512_storeu_si512((void *)(d + x + 64), v1);
+            _mm512_storeu_si512((void *)(d + x + 128), v2);
+            _mm512_storeu_si512((void *)(d + x + 192), v3);
+        }
+        for (; x + 64 <= width; x += 64)
+        {
+            _mm512_storeu_si512((void *)(d + x), Load512(s + x, stream));
+        }
+        if (x < width)
+        {
+            // masked copy of the tail, no scalar loop
+            __mmask64 tail = _cvtu64_mask64(~0ULL >> (64 - (width - x)));
+            _mm512_mask_storeu_epi8(d + x, tail, _mm512_maskz_loadu_epi8(tail, s + x));
+        }
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void BGRAToRGBPAVX512(uint8_t *r, uint8_t *g, uint8_t *b, uint32_t dstPitch,
+                             const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    const __m512i mask = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    // 4 pixel group k is in the 32 bit lane 4 * (k % 4) + k / 4 after the transpose
+    const __m512i order = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    bool stream = CanStream(src, srcPitch, 64);
+    for (uint32_t i = 0; i < height; i++)
+    {
+        const uint8_t *s = src + (size_t)i * srcPitch;
+        size_t offset = (size_t)i * dstPitch;
+        uint32_t x = 0;
+        for (; x + 64 <= width; x += 64)
+        {
+            __m512i v0 = _mm512_shuffle_epi8(Load512(s + x * 4, stream), mask);
+            __m512i v1 = _mm512_shuffle_epi8(Load512(s + x * 4 + 64, stream), mask);
+            __m512i v2 = _mm512_shuffle_epi8(Load512(s + x * 4 + 128, stream), mask);
+            __m512i v3 = _mm512_shuffle_epi8(Load512(s + x * 4 + 192, stream), mask);
+            __m512i bg01 = _mm512_unpacklo_epi32(v0, v1);
+            __m512i ra01 = _mm512_unpackhi_epi32(v0, v1);
+            __m512i bg23 = _mm512_unpacklo_epi32(v2, v3);
+            __m512i ra23 = _mm512_unpackhi_epi32(v2, v3);
+            __m512i vb = _mm512_permutexvar_epi32(order, _mm512_unpacklo_epi64(bg01, bg23));
+            __m512i vg = _mm512_permutexvar_epi32(order, _mm512_unpackhi_epi64(bg01, bg23));
+            __m512i vr = _mm512_permutexvar_epi32(order, _mm512_unpacklo_epi64(ra01, ra23));
+            _mm512_storeu_si512((void *)(b + offset + x), vb);
+            _mm512_storeu_si512((void *)(g + offset + x), vg);
+            _mm512_storeu_si512((void *)(r + offset + x), vr);
+        }
+        BGRAToRGBPRow(r + offset, g + offset, b + offset, s, x, width);
+    }
+}
+
+#endif
+
+static bool IsaSupported(VA_IMAGE_ISA isa)
+{
+#ifdef VA_IMAGE_X86
+    switch (isa)
+    {
+        case VA_ISA_SCALAR:
+            return true;
+        case VA_ISA_SSE4:
+            return __builtin_cpu_supports("sse4.1");
+        case VA_ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case VA_ISA_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    }
+    return false;
+#else
+    return isa == VA_ISA_SCALAR;
+#endif
+}
+
+struct ImageKernels
+{
+    VA_IMAGE_ISA isa;
+    CopyPlaneFunc copyPlane;
+    BGRAToRGBPFunc bgraToRGBP;
+
+    void Select(VA_IMAGE_ISA newIsa)
+    {
+        isa = newIsa;
+        copyPlane = CopyPlaneScalar;
+        bgraToRGBP = BGRAToRGBPScalar;
+#ifdef VA_IMAGE_X86
+        switch (isa)
+        {
+            case VA_ISA_SSE4:
+                copyPlane = CopyPlaneSSE4;
+                bgraToRGBP = BGRAToRGBPSSE4;
+                break;
+            case VA_ISA_AVX2:
+                copyPlane = CopyPlaneAVX2;
+                bgraToRGBP = BGRAToRGBPAVX2;
+                break;
+            case VA_ISA_AVX512:
+                copyPlane = CopyPlaneAVX512;
+                bgraToRGBP = BGRAToRGBPAVX512;
+                break;
+            default:
+                break;
+        }
+#endif
+    }
+
+    ImageKernels()
+    {
+        int best = VA_ISA_AVX512;
+        while (!IsaSupported((VA_IMAGE_ISA)best))
+        {
+            --best;
+        }
+        Select((VA_IMAGE_ISA)best);
+    }
+};
+
+static ImageKernels &Kernels()
+{
+    static ImageKernels kernels;
+    return kernels;
+}
+
+void VACopyPlane(uint8_t *dst, uint32_t dstPitch, const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    Kernels().copyPlane(dst, dstPitch, src, srcPitch, width, height);
+}
+
+void VABGRAToRGBP(uint8_t *r, uint8_t *g, uint8_t *b, uint32_t dstPitch,
+                  const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height)
+{
+    Kernels().bgraToRGBP(r, g, b, dstPitch, src, srcPitch, width, height);
+}
+
+VA_IMAGE_ISA VAGetImageIsa()
+{
+    return Kernels().isa;
+}
+
+int VASetImageIsa(VA_IMAGE_ISA isa)
+{
+    if (!IsaSupported(isa))
+    {
+        return -1;
+    }
+    Kernels().Select(isa);
+    return 0;
+}
+
+const char *VAImageIsaName(VA_IMAGE_ISA isa)
+{
+    switch (isa)
+    {
+        case VA_ISA_SCALAR:
+            return "scalar";
+        case VA_ISA_SSE4:
+            return "sse4";
+        case VA_ISA_AVX2:
+            return "avx2";
+        case VA_ISA_AVX512:
+            return "avx512";
+    }
+    return "unknown";
+}
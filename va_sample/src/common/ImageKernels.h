@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _IMAGE_KERNELS_H_
+#define _IMAGE_KERNELS_H_
+
+#include <stdint.h>
+
+// Copies between mapped surfaces and the packed system memory buffers of the blocks.
+// The widest instruction set supported by the cpu is picked at the first call. When the
+// source rows are aligned they are read with streaming loads, which are much faster
+// from the write-combined memory of mapped video surfaces.
+
+enum VA_IMAGE_ISA
+{
+    VA_ISA_SCALAR,
+    VA_ISA_SSE4,
+    VA_ISA_AVX2,
+    VA_ISA_AVX512
+};
+
+// copies height rows of width bytes, the rows start every srcPitch/dstPitch bytes
+void VACopyPlane(uint8_t *dst, uint32_t dstPitch, const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height);
+
+// splits the BGRA pixels (MFX_FOURCC_RGB4) into R, G and B planes, alpha is dropped
+void VABGRAToRGBP(uint8_t *r, uint8_t *g, uint8_t *b, uint32_t dstPitch,
+                  const uint8_t *src, uint32_t srcPitch, uint32_t width, uint32_t height);
+
+// instruction set used by the kernels
+VA_IMAGE_ISA VAGetImageIsa();
+// forces a narrower instruction set, for benchmarks and tests, fails if the cpu doesn't support it
+int VASetImageIsa(VA_IMAGE_ISA isa);
+const char *VAImageIsaName(VA_IMAGE_ISA isa);
+
+#endif
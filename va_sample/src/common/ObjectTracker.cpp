@@ -0,0 +1,355 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ObjectTracker.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// noise of the SORT filter: measurement, initial uncertainty and process
+static const float MEASURE_NOISE[4] = {1.0f, 1.0f, 10.0f, 10.0f};
+static const float INITIAL_COVARIANCE[7] = {10.0f, 10.0f, 10.0f, 10.0f, 10000.0f, 10000.0f, 10000.0f};
+static const float PROCESS_NOISE[7] = {1.0f, 1.0f, 1.0f, 1.0f, 0.01f, 0.01f, 0.0001f};
+
+static float IoU(const float *a, const float *b)
+{
+    float w = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+    float h = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+    if (w <= 0 || h <= 0)
+    {
+        return 0;
+    }
+    float inter = w * h;
+    float areaA = (a[2] - a[0]) * (a[3] - a[1]);
+    float areaB = (b[2] - b[0]) * (b[3] - b[1]);
+    return inter / (areaA + areaB - inter);
+}
+
+// inverts the 4x4 matrix with Gauss-Jordan elimination, returns false if it is singular
+static bool Invert4(float m[4][4], float inv[4][4])
+{
+    for (int i = 0; i < 4; i ++)
+    {
+        for (int j = 0; j < 4; j ++)
+        {
+            inv[i][j] = (i == j) ? 1.0f : 0.0f;
+        }
+    }
+    for (int c = 0; c < 4; c ++)
+    {
+        int pivot = c;
+        for (int r = c + 1; r < 4; r ++)
+        {
+            if (fabsf(m[r][c]) > fabsf(m[pivot][c]))
+            {
+                pivot = r;
+            }
+        }
+        if (fabsf(m[pivot][c]) < 1e-12f)
+        {
+            return false;
+        }
+        if (pivot != c)
+        {
+            for (int j = 0; j < 4; j ++)
+            {
+                std::swap(m[c][j], m[pivot][j]);
+                std::swap(inv[c][j], inv[pivot][j]);
+            }
+        }
+        float scale = 1.0f / m[c][c];
+        for (int j = 0; j < 4; j ++)
+        {
+            m[c][j] *= scale;
+            inv[c][j] *= scale;
+        }
+        for (int r = 0; r < 4; r ++)
+        {
+            if (r == c || m[r][c] == 0)
+            {
+                continue;
+            }
+            float f = m[r][c];
+            for (int j = 0; j < 4; j ++)
+            {
+                m[r][j] -= f * m[c][j];
+                inv[r][j] -= f * inv[c][j];
+            }
+        }
+    }
+    return true;
+}
+
+VAObjectTracker::VAObjectTracker():
+    m_width(1920),
+    m_height(1080),
+    m_iouThreshold(0.3f),
+    m_maxAge(5),
+    m_ownIds(0),
+    m_ids(&m_ownIds),
+    m_started(false),
+    m_lastFrame(0)
+{
+}
+
+VAObjectTracker::~VAObjectTracker()
+{
+    for (auto track : m_tracks)
+    {
+        delete track;
+    }
+}
+
+void VAObjectTracker::Measure(const float *rect, float *z)
+{
+    float w = std::max((rect[2] - rect[0]) * m_width, 1.0f);
+    float h = std::max((rect[3] - rect[1]) * m_height, 1.0f);
+    z[0] = (rect[0] + rect[2]) * 0.5f * m_width;
+    z[1] = (rect[1] + rect[3]) * 0.5f * m_height;
+    z[2] = w * h;
+    z[3] = w / h;
+}
+
+void VAObjectTracker::PredictedRect(const Filter &filter, float *rect)
+{
+    float w = 0, h = 0;
+    if (filter.x[2] > 0 && filter.x[3] > 0)
+    {
+        w = sqrtf(filter.x[2] * filter.x[3]);
+        h = filter.x[2] / w;
+    }
+    rect[0] = (filter.x[0] - w * 0.5f) / m_width;
+    rect[1] = (filter.x[1] - h * 0.5f) / m_height;
+    rect[2] = (filter.x[0] + w * 0.5f) / m_width;
+    rect[3] = (filter.x[1] + h * 0.5f) / m_height;
+}
+
+void VAObjectTracker::Init(Filter &filter, const float *z)
+{
+    memset(&filter, 0, sizeof(filter));
+    for (uint32_t i = 0; i < MEASURE_SIZE; i ++)
+    {
+        filter.x[i] = z[i];
+    }
+    for (uint32_t i = 0; i < STATE_SIZE; i ++)
+    {
+        filter.P[i][i] = INITIAL_COVARIANCE[i];
+    }
+}
+
+void VAObjectTracker::Predict(Filter &filter)
+{
+    float *x = filter.x;
+    // the area can't shrink below 0
+    if (x[2] + x[6] <= 0)
+    {
+        x[6] = 0;
+    }
+    // the transition adds the velocity i + 4 to the state i, P = F * P * Ft + Q
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        x[i] += x[i + 4];
+        for (uint32_t j = 0; j < STATE_SIZE; j ++)
+        {
+            filter.P[i][j] += filter.P[i + 4][j];
+        }
+    }
+    for (uint32_t j = 0; j < 3; j ++)
+    {
+        for (uint32_t i = 0; i < STATE_SIZE; i ++)
+        {
+            filter.P[i][j] += filter.P[i][j + 4];
+        }
+    }
+    for (uint32_t i = 0; i < STATE_SIZE; i ++)
+    {
+        filter.P[i][i] += PROCESS_NOISE[i];
+    }
+}
+
+void VAObjectTracker::Correct(Filter &filter, const float *z)
+{
+    // the measurement is the first 4 states: S = P[0:4][0:4] + R, K = P[:][0:4] * S^-1
+    float S[4][4], Sinv[4][4];
+    for (uint32_t i = 0; i < MEASURE_SIZE; i ++)
+    {
+        for (uint32_t j = 0; j < MEASURE_SIZE; j ++)
+        {
+            S[i][j] = filter.P[i][j];
+        }
+        S[i][i] += MEASURE_NOISE[i];
+    }
+    if (!Invert4(S, Sinv))
+    {
+        return;
+    }
+
+    float K[STATE_SIZE][MEASURE_SIZE];
+    for (uint32_t i = 0; i < STATE_SIZE; i ++)
+    {
+        for (uint32_t j = 0; j < MEASURE_SIZE; j ++)
+        {
+            float sum = 0;
+            for (uint32_t k = 0; k < MEASURE_SIZE; k ++)
+            {
+                sum += filter.P[i][k] * Sinv[k][j];
+            }
+            K[i][j] = sum;
+        }
+    }
+
+    float y[MEASURE_SIZE];
+    for (uint32_t i = 0; i < MEASURE_SIZE; i ++)
+    {
+        y[i] = z[i] - filter.x[i];
+    }
+    for (uint32_t i = 0; i < STATE_SIZE; i ++)
+    {
+        for (uint32_t k = 0; k < MEASURE_SIZE; k ++)
+        {
+            filter.x[i] += K[i][k] * y[k];
+        }
+    }
+
+    // P = (I - K * H) * P, H * P is the first 4 rows of P
+    float HP[MEASURE_SIZE][STATE_SIZE];
+    memcpy(HP, filter.P, sizeof(HP));
+    for (uint32_t i = 0; i < STATE_SIZE; i ++)
+    {
+        for (uint32_t j = 0; j < STATE_SIZE; j ++)
+        {
+            float sum = 0;
+            for (uint32_t k = 0; k < MEASURE_SIZE; k ++)
+            {
+                sum += K[i][k] * HP[k][j];
+            }
+            filter.P[i][j] -= sum;
+        }
+    }
+}
+
+int VAObjectTracker::Update(uint32_t frame, const float *rects, uint32_t count, std::vector<VATrack *> &tracks)
+{
+    if (m_started && frame <= m_lastFrame)
+    {
+        return -1;
+    }
+    // after max age frames all the tracks are dropped anyway
+    uint32_t steps = m_started ? std::min(frame - m_lastFrame, m_maxAge + 1) : 1;
+    m_started = true;
+    m_lastFrame = frame;
+    m_dropped.clear();
+
+    uint32_t trackNum = m_tracks.size();
+    m_predicted.resize(trackNum * 4);
+    for (uint32_t t = 0; t < trackNum; t ++)
+    {
+        for (uint32_t s = 0; s < steps; s ++)
+        {
+            Predict(m_filters[t]);
+        }
+        m_tracks[t]->missed += steps;
+        PredictedRect(m_filters[t], &m_predicted[t * 4]);
+    }
+
+    // greedy association from the best overlap
+    m_pairs.clear();
+    for (uint32_t t = 0; t < trackNum; t ++)
+    {
+        for (uint32_t d = 0; d < count; d ++)
+        {
+            float iou = IoU(&m_predicted[t * 4], rects + d * 4);
+            if (iou >= m_iouThreshold)
+            {
+                m_pairs.push_back({iou, t, d});
+            }
+        }
+    }
+    std::sort(m_pairs.begin(), m_pairs.end(), [](const Pair &a, const Pair &b) {return a.iou > b.iou; });
+
+    tracks.assign(count, nullptr);
+    m_trackMatched.assign(trackNum, false);
+    m_detectionTrack.resize(count);
+    for (auto &pair : m_pairs)
+    {
+        if (m_trackMatched[pair.track] || tracks[pair.detection])
+        {
+            continue;
+        }
+        m_trackMatched[pair.track] = true;
+        tracks[pair.detection] = m_tracks[pair.track];
+        m_detectionTrack[pair.detection] = pair.track;
+    }
+
+    float z[MEASURE_SIZE];
+    for (uint32_t d = 0; d < count; d ++)
+    {
+        const float *rect = rects + d * 4;
+        Measure(rect, z);
+        VATrack *track = tracks[d];
+        if (track)
+        {
+            Correct(m_filters[m_detectionTrack[d]], z);
+            ++ track->hits;
+            track->missed = 0;
+        }
+        else
+        {
+            track = new VATrack();
+            do
+            {
+                track->id = m_ids->fetch_add(1, std::memory_order_relaxed) + 1;
+            } while (track->id == 0);
+            track->hits = 1;
+            track->missed = 0;
+            track->classifiedFrame = frame;
+            track->classifiedConfidence = 0;
+            m_tracks.push_back(track);
+            m_filters.emplace_back();
+            Init(m_filters.back(), z);
+            tracks[d] = track;
+        }
+        track->left = rect[0];
+        track->top = rect[1];
+        track->right = rect[2];
+        track->bottom = rect[3];
+    }
+
+    // drop the tracks lost for too long, the new ones are past trackNum
+    uint32_t kept = 0;
+    for (uint32_t t = 0; t < m_tracks.size(); t ++)
+    {
+        if (t < trackNum && !m_trackMatched[t] && m_tracks[t]->missed > m_maxAge)
+        {
+            m_dropped.push_back(m_tracks[t]->id);
+            delete m_tracks[t];
+            continue;
+        }
+        m_tracks[kept] = m_tracks[t];
+        m_filters[kept] = m_filters[t];
+        ++ kept;
+    }
+    m_tracks.resize(kept);
+    m_filters.resize(kept);
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _OBJECT_TRACKER_H_
+#define _OBJECT_TRACKER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+// SORT-like tracker of the boxes a detector finds in the frames of one channel. Each track
+// keeps a constant velocity Kalman filter of the box center, area and aspect ratio; the
+// predicted boxes are matched to the detections of the next frame by intersection over union,
+// greedily from the best overlap. A detection left unmatched starts a new track, a track
+// without detection for more than the max age is dropped.
+// The boxes are in the normalized coordinates of the frame, the filter runs in pixels.
+
+struct VATrack
+{
+    uint32_t id;
+    // last matched detection, normalized
+    float left;
+    float top;
+    float right;
+    float bottom;
+    // matched detections since the track started, 1 for a new track
+    uint32_t hits;
+    // frames since the last matched detection
+    uint32_t missed;
+    // kept by the user of the tracker, not touched by Update()
+    uint32_t classifiedFrame;
+    float classifiedConfidence;
+};
+
+class VAObjectTracker
+{
+public:
+    VAObjectTracker();
+    ~VAObjectTracker();
+
+    inline void SetFrameSize(uint32_t width, uint32_t height) {m_width = width; m_height = height; }
+    inline void SetIoUThreshold(float threshold) {m_iouThreshold = threshold; }
+    inline void SetMaxAge(uint32_t frames) {m_maxAge = frames; }
+    // the ids of the new tracks, shared by the trackers of all channels, kept by the caller
+    inline void SetIdSource(std::atomic<uint32_t> *ids) {m_ids = ids; }
+
+    // moves the tracks to the frame and matches them with its count detections, rects holds
+    // left, top, right, bottom of each detection. tracks[i] receives the track of detection i.
+    // Returns -1 and leaves the tracks alone when the frame isn't after the last one.
+    int Update(uint32_t frame, const float *rects, uint32_t count, std::vector<VATrack *> &tracks);
+
+    // a track needs its classes again when it is new, when it wasn't classified for interval
+    // frames, or when the detection confidence fell by more than drop since it was classified
+    static inline bool ClassifyDue(const VATrack *track, uint32_t frame, float confidence, uint32_t interval, float drop)
+    {
+        return track->hits == 1
+            || frame - track->classifiedFrame >= interval
+            || confidence < track->classifiedConfidence - drop;
+    }
+
+    // the ids of the tracks dropped by the last Update()
+    inline const std::vector<uint32_t> &Dropped() {return m_dropped; }
+
+    inline uint32_t TrackNum() {return m_tracks.size(); }
+
+protected:
+    static const uint32_t STATE_SIZE = 7;
+    static const uint32_t MEASURE_SIZE = 4;
+
+    // state: center x, center y, area, aspect ratio and the velocities of the first three
+    struct Filter
+    {
+        float x[STATE_SIZE];
+        float P[STATE_SIZE][STATE_SIZE];
+    };
+
+    void Init(Filter &filter, const float *z);
+    void Predict(Filter &filter);
+    void Correct(Filter &filter, const float *z);
+    // measurement of a normalized box, and predicted normalized box of a filter
+    void Measure(const float *rect, float *z);
+    void PredictedRect(const Filter &filter, float *rect);
+
+    uint32_t m_width;
+    uint32_t m_height;
+    float m_iouThreshold;
+    uint32_t m_maxAge;
+    std::atomic<uint32_t> m_ownIds;
+    std::atomic<uint32_t> *m_ids;
+
+    bool m_started;
+    uint32_t m_lastFrame;
+    std::vector<VATrack *> m_tracks;
+    std::vector<Filter> m_filters;
+    std::vector<uint32_t> m_dropped;
+
+    // scratch of Update()
+    std::vector<float> m_predicted;
+    struct Pair
+    {
+        float iou;
+        uint32_t track;
+        uint32_t detection;
+    };
+    std::vector<Pair> m_pairs;
+    std::vector<bool> m_trackMatched;
+    std::vector<uint32_t> m_detectionTrack;
+};
+
+#endif
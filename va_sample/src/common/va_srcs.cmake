@@ -23,7 +23,9 @@
 set(VA_SOURCES
     ${VA_SOURCES}
     ${CMAKE_CURRENT_LIST_DIR}/common.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/ImageKernels.cpp
     ${CMAKE_CURRENT_LIST_DIR}/logs.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/ObjectTracker.cpp
     )
 
 include_directories(${CMAKE_CURRENT_LIST_DIR})
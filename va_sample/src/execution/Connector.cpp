@@ -23,6 +23,7 @@
 #include "Connector.h"
 #include <string.h>
 #include <algorithm>
+#include <string>
 #include <vector>
 
 VAConnector::VAConnector(uint32_t maxInput, uint32_t maxOutput):
@@ -134,6 +135,51 @@ void VAConnector::DisconnectPin(VAConnectorPin* pin, bool isInput)
             Trigger();
         }
     }
+    // the pooled blocks parked on this connector need to see the disconnection
+    Notify();
+}
+
+uint32_t VAConnector::GetInputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait)
+{
+    uint32_t num = 0;
+    while (num < maxNum)
+    {
+        VADataPacket *packet = (num == 0 && wait) ? GetInput(index) : TryGetInput(index);
+        if (!packet)
+            break;
+        packets[num++] = packet;
+    }
+    return num;
+}
+
+uint32_t VAConnector::GetOutputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait,
+                                     const VAConnectorPin *calledPin)
+{
+    uint32_t num = 0;
+    while (num < maxNum)
+    {
+        VADataPacket *packet = (num == 0 && wait) ? GetOutput(index, nullptr, calledPin) : TryGetOutput(index, calledPin);
+        if (!packet)
+            break;
+        packets[num++] = packet;
+    }
+    return num;
+}
+
+void VAConnector::StoreInputBatch(int index, VADataPacket **packets, uint32_t num)
+{
+    for (uint32_t i = 0; i < num; i++)
+    {
+        StoreInput(index, packets[i]);
+    }
+}
+
+void VAConnector::StoreOutputBatch(int index, VADataPacket **packets, uint32_t num)
+{
+    for (uint32_t i = 0; i < num; i++)
+    {
+        StoreOutput(index, packets[i]);
+    }
 }
 
 void VACsvWriterPin::Store(VADataPacket *data)
@@ -146,6 +192,8 @@ void VACsvWriterPin::Store(VADataPacket *data)
     std::vector<float> tops(size, 0);
     std::vector<float> rights(size, 0);
     std::vector<float> bottoms(size, 0);
+    // the classes after the most likely one, as ", class, confidence" pairs
+    std::vector<std::string> moreClasses(size);
 
     uint32_t roiNum = 0;
     uint32_t channel = 0;
@@ -183,6 +231,12 @@ void VACsvWriterPin::Store(VADataPacket *data)
             }
             classes[index] = data->Class();
             confs[index] = data->Confidence();
+            for (uint32_t rank = 1; rank < data->ClassNum(); rank++)
+            {
+                char pair[32];
+                snprintf(pair, sizeof(pair), ", %d, %f", data->Class(rank), data->Confidence(rank));
+                moreClasses[index] += pair;
+            }
             hasDump = true;
         }
         data->SetRef(0);
@@ -192,7 +246,7 @@ void VACsvWriterPin::Store(VADataPacket *data)
     ++ roiNum;
     for (int i = 0; i < roiNum && hasDump; i++)
     {
-        fprintf(m_fp, "%d, %d, %d, %f, %f, %f, %f, %d, %f\n", channel,
+        fprintf(m_fp, "%d, %d, %d, %f, %f, %f, %f, %d, %f%s\n", channel,
                                                               frame,
                                                               i,
                                                               lefts[i],
@@ -200,7 +254,8 @@ void VACsvWriterPin::Store(VADataPacket *data)
                                                               rights[i],
                                                               bottoms[i],
                                                               classes[i],
-                                                              confs[i]);
+                                                              confs[i],
+                                                              moreClasses[i].c_str());
     }
     fflush(m_fp);
 }
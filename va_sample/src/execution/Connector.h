@@ -29,12 +29,79 @@
 #include <list>
 #include <mutex>
 #include <stdexcept>
+#include <vector>
 #include "logs.h"
 #include "DataPacket.h"
 
 class VAConnectorPin;
 class VAThreadBlock;
 
+// Bounded FIFO of packet pointers used by the connectors
+// A connector never holds more packets than it owns, so the ring is sized
+// once and push/pop don't allocate like std::list does.
+class VAPacketQueue
+{
+public:
+    explicit VAPacketQueue(uint32_t capacity = 0):
+        m_ring(capacity),
+        m_head(0),
+        m_size(0)
+    {
+    }
+
+    void Reserve(uint32_t capacity)
+    {
+        std::vector<VADataPacket *> ring(capacity);
+        for (uint32_t i = 0; i < m_size; i++)
+        {
+            ring[i] = m_ring[(m_head + i) % m_ring.size()];
+        }
+        m_ring.swap(ring);
+        m_head = 0;
+    }
+
+    inline uint32_t size() const {return m_size; }
+    inline VADataPacket *front() {return m_ring[m_head]; }
+
+    inline void pop_front()
+    {
+        m_head = (m_head + 1 == m_ring.size()) ? 0 : m_head + 1;
+        -- m_size;
+    }
+
+    inline void push_back(VADataPacket *packet)
+    {
+        uint32_t tail = m_head + m_size;
+        if (tail >= m_ring.size())
+        {
+            tail -= m_ring.size();
+        }
+        m_ring[tail] = packet;
+        ++ m_size;
+    }
+
+    inline void push_front(VADataPacket *packet)
+    {
+        m_head = (m_head == 0) ? m_ring.size() - 1 : m_head - 1;
+        m_ring[m_head] = packet;
+        ++ m_size;
+    }
+
+protected:
+    std::vector<VADataPacket *> m_ring;
+    uint32_t m_head;
+    uint32_t m_size;
+};
+
+// Notified after a packet is stored on any pin of the connector,
+// used to wake up the blocks scheduled by VATaskScheduler
+class VAConnectorListener
+{
+public:
+    virtual ~VAConnectorListener() {}
+    virtual void OnConnectorEvent() = 0;
+};
+
 class VAConnector
 {
 friend class VAConnectorPin;
@@ -49,7 +116,18 @@ public:
     VAConnectorPin *NewOutputPin();
 
     void DisconnectPin(VAConnectorPin* pin, bool isInput);
-    
+
+    // listeners must be added before the pipeline starts
+    inline void AddListener(VAConnectorListener *listener) {m_listeners.push_back(listener); }
+
+    inline void Notify()
+    {
+        for (auto ite = m_listeners.begin(); ite != m_listeners.end(); ite ++)
+        {
+            (*ite)->OnConnectorEvent();
+        }
+    }
+
 protected:
     virtual VADataPacket *GetInput(int index) = 0;
     virtual void StoreInput(int index, VADataPacket *data) = 0;
@@ -57,6 +135,27 @@ protected:
         const VAConnectorPin *calledPin = nullptr) = 0;
     virtual void StoreOutput(int index, VADataPacket *data) = 0;
     virtual void Trigger() = 0;
+
+    // non blocking versions of GetInput/GetOutput, return nullptr if no packet is available
+    // GetInput of the connectors may wait, so they override TryGetInput
+    virtual VADataPacket *TryGetInput(int index) {return GetInput(index); }
+    virtual VADataPacket *TryGetOutput(int index, const VAConnectorPin *calledPin)
+    {
+        timespec now = {0, 0};
+        return GetOutput(index, &now, calledPin);
+    }
+
+    // move up to maxNum packets with one synchronization of the connector, the
+    // default versions go through the single packet functions
+    // the first packet is waited for like GetInput/GetOutput when wait is set
+    virtual uint32_t GetInputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait);
+    virtual uint32_t GetOutputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait,
+        const VAConnectorPin *calledPin);
+    virtual void StoreInputBatch(int index, VADataPacket **packets, uint32_t num);
+    virtual void StoreOutputBatch(int index, VADataPacket **packets, uint32_t num);
+
+    std::vector<VAConnectorListener *> m_listeners;
+
     std::list<VAConnectorPin *> m_inputPins;
     std::list<VAConnectorPin *> m_outputPins;
     std::list<VAConnectorPin *> m_inputDisconnectedPins;
@@ -96,14 +195,72 @@ public:
             return m_connector->GetOutput(m_index, nullptr, this);
     }
     
+    // pins without connector never wait
+    virtual VADataPacket *TryGet()
+    {
+        if (!m_connector)
+            return Get();
+        if (m_isInput)
+            return m_connector->TryGetInput(m_index);
+        else
+            return m_connector->TryGetOutput(m_index, this);
+    }
+
     virtual void Store(VADataPacket *data)
     {
         if (m_isInput)
             m_connector->StoreInput(m_index, data);
         else
             m_connector->StoreOutput(m_index, data);
+        m_connector->Notify();
+    }
+
+    // appends up to maxNum packets, returns how many were appended
+    // pins without connector hand out a single packet
+    virtual uint32_t GetBatch(std::vector<VADataPacket *> &packets, uint32_t maxNum, bool wait = true)
+    {
+        if (maxNum == 0)
+            return 0;
+        if (!m_connector)
+        {
+            VADataPacket *packet = wait ? Get() : TryGet();
+            if (!packet)
+                return 0;
+            packets.push_back(packet);
+            return 1;
+        }
+
+        size_t base = packets.size();
+        packets.resize(base + maxNum);
+        uint32_t num = m_isInput ?
+            m_connector->GetInputBatch(m_index, &packets[base], maxNum, wait) :
+            m_connector->GetOutputBatch(m_index, &packets[base], maxNum, wait, this);
+        packets.resize(base + num);
+        return num;
+    }
+
+    virtual void StoreBatch(std::vector<VADataPacket *> &packets)
+    {
+        if (packets.empty())
+            return;
+        if (!m_connector)
+        {
+            for (auto ite = packets.begin(); ite != packets.end(); ite ++)
+            {
+                Store(*ite);
+            }
+            return;
+        }
+
+        if (m_isInput)
+            m_connector->StoreInputBatch(m_index, packets.data(), packets.size());
+        else
+            m_connector->StoreOutputBatch(m_index, packets.data(), packets.size());
+        m_connector->Notify();
     }
 
+    inline VAConnector *Connector() {return m_connector; }
+
     void Disconnect()
     {
         if (m_connector != nullptr)
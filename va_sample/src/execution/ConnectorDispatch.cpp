@@ -27,10 +27,15 @@
 using namespace std::chrono;
 
 VAConnectorDispatch::VAConnectorDispatch(uint32_t maxInput, uint32_t maxOutput, uint32_t bufferNum):
-    VAConnector(maxInput, maxOutput)
+    VAConnector(maxInput, maxOutput),
+    m_policy(VA_DISPATCH_CHANNEL),
+    m_spillDepth(DEFAULT_SPILL_DEPTH),
+    m_depths(new std::atomic<uint32_t>[maxOutput]),
+    m_scanStart(0)
 {
     uint32_t totalBufferNum = maxOutput * bufferNum;
     m_packets.resize(totalBufferNum);
+    m_inPipe.Reserve(totalBufferNum);
     for (int i = 0; i < totalBufferNum; i++)
     {
         m_inPipe.push_back(&m_packets[i]);
@@ -42,7 +47,18 @@ VAConnectorDispatch::VAConnectorDispatch(uint32_t maxInput, uint32_t maxOutput,
     m_outMutex.swap(mlist);
     m_conds.swap(clist);
 
-    m_outPipes.resize(maxOutput);
+    // any output may end up holding all the packets
+    m_outPipes.resize(maxOutput, VAPacketQueue(totalBufferNum));
+    for (uint32_t i = 0; i < maxOutput; i++)
+    {
+        m_depths[i].store(0);
+    }
+}
+
+void VAConnectorDispatch::SetPolicy(VA_DISPATCH_POLICY policy, uint32_t spillDepth)
+{
+    m_policy = policy;
+    m_spillDepth = spillDepth;
 }
 
 VAConnectorDispatch::~VAConnectorDispatch()
@@ -51,31 +67,102 @@ VAConnectorDispatch::~VAConnectorDispatch()
 
 VADataPacket *VAConnectorDispatch::GetInput(int index)
 {
-    VADataPacket *buffer = NULL;
-    do
+    VADataPacket *buffer = nullptr;
+    GetInputBatch(index, &buffer, 1, true);
+    return buffer;
+}
+
+VADataPacket *VAConnectorDispatch::TryGetInput(int index)
+{
+    VADataPacket *buffer = nullptr;
+    GetInputBatch(index, &buffer, 1, false);
+    return buffer;
+}
+
+uint32_t VAConnectorDispatch::GetInputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait)
+{
+    uint32_t num = 0;
+    while (1)
     {
-        std::unique_lock<std::mutex> lock(m_inMutex);
-        if (m_inPipe.size() > 0)
         {
-            buffer = m_inPipe.front();
-            m_inPipe.pop_front();
+            std::lock_guard<std::mutex> lock(m_inMutex);
+            while (num < maxNum && m_inPipe.size() > 0)
+            {
+                packets[num++] = m_inPipe.front();
+                m_inPipe.pop_front();
+            }
         }
-        else
+        if (num > 0 || !wait)
+            break;
+        usleep(500);
+    }
+    return num;
+}
+
+uint32_t VAConnectorDispatch::LeastDepthOutput()
+{
+    uint32_t start = m_scanStart.fetch_add(1, std::memory_order_relaxed);
+    uint32_t best = start % m_maxOut;
+    uint32_t bestDepth = Depth(best);
+    for (uint32_t i = 1; i < m_maxOut && bestDepth > 0; i++)
+    {
+        uint32_t out = (start + i) % m_maxOut;
+        uint32_t depth = Depth(out);
+        if (depth < bestDepth)
         {
-            lock.unlock();
-            usleep(500);
+            best = out;
+            bestDepth = depth;
         }
-    } while (buffer == NULL);
-    return buffer;
+    }
+    return best;
+}
+
+uint32_t VAConnectorDispatch::SelectOutput(uint32_t channel)
+{
+    if (m_maxOut == 1)
+        return 0;
+
+    switch (m_policy)
+    {
+    case VA_DISPATCH_LEAST_DEPTH:
+        return LeastDepthOutput();
+
+    case VA_DISPATCH_TWO_CHOICES:
+    {
+        // xorshift, every producer thread has its own sequence
+        static thread_local uint32_t seed = 0x9e3779b9u ^ (uint32_t)(uintptr_t)&seed;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        uint32_t first = seed % m_maxOut;
+        uint32_t second = (first + 1 + (seed >> 16) % (m_maxOut - 1)) % m_maxOut;
+        return (Depth(second) < Depth(first)) ? second : first;
+    }
+
+    case VA_DISPATCH_STICKY:
+    {
+        // the frames of a channel stay on one output (and its tracker state) unless it falls behind
+        uint32_t preferred = channel % m_maxOut;
+        if (Depth(preferred) <= m_spillDepth)
+            return preferred;
+        uint32_t other = LeastDepthOutput();
+        return (Depth(other) < Depth(preferred)) ? other : preferred;
+    }
+
+    case VA_DISPATCH_CHANNEL:
+    default:
+        return channel % m_maxOut;
+    }
 }
 
 void VAConnectorDispatch::StoreInput(int index, VADataPacket *data)
 {
     uint32_t channel = data->front()->ChannelIndex();
-    uint32_t outIndex = channel%m_maxOut;
+    uint32_t outIndex = SelectOutput(channel);
     {
         std::lock_guard<std::mutex> lock(m_outMutex[outIndex]);
         m_outPipes[outIndex].push_back(data);
+        m_depths[outIndex].fetch_add(1, std::memory_order_relaxed);
     }
     m_conds[outIndex].notify_one();
 }
@@ -86,16 +173,33 @@ void VAConnectorDispatch::Trigger()
 
 VADataPacket *VAConnectorDispatch::GetOutput(int index, const timespec *abstime, const VAConnectorPin*) 
 {
-    bool timeout = false;
     VADataPacket *buffer = nullptr;
+    PopOutputs(index, &buffer, 1, abstime);
+    return buffer;
+}
+
+uint32_t VAConnectorDispatch::GetOutputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait,
+                                             const VAConnectorPin *)
+{
+    timespec now = {0, 0};
+    return PopOutputs(index, packets, maxNum, wait ? nullptr : &now);
+}
+
+uint32_t VAConnectorDispatch::PopOutputs(int index, VADataPacket **packets, uint32_t maxNum, const timespec *abstime)
+{
+    bool timeout = false;
+    uint32_t num = 0;
     std::unique_lock<std::mutex> lock(m_outMutex[index]);
     do
     {
         if (m_outPipes[index].size() > 0)
         {
-            buffer = m_outPipes[index].front();
-            
-            m_outPipes[index].pop_front();
+            while (num < maxNum && m_outPipes[index].size() > 0)
+            {
+                packets[num++] = m_outPipes[index].front();
+                m_outPipes[index].pop_front();
+            }
+            m_depths[index].fetch_sub(num, std::memory_order_relaxed);
         }
         else if (abstime == nullptr)
         {
@@ -110,8 +214,8 @@ VADataPacket *VAConnectorDispatch::GetOutput(int index, const timespec *abstime,
         {
             break;
         }
-    } while(buffer == NULL);
-    return buffer;
+    } while(num == 0);
+    return num;
 }
 
 void VAConnectorDispatch::StoreOutput(int index, VADataPacket *data)
@@ -120,3 +224,12 @@ void VAConnectorDispatch::StoreOutput(int index, VADataPacket *data)
     m_inPipe.push_front(data);
 }
 
+void VAConnectorDispatch::StoreOutputBatch(int index, VADataPacket **packets, uint32_t num)
+{
+    std::lock_guard<std::mutex> lock(m_inMutex);
+    for (uint32_t i = 0; i < num; i++)
+    {
+        m_inPipe.push_front(packets[i]);
+    }
+}
+
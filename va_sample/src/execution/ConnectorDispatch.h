@@ -24,16 +24,35 @@
 #define __CONNECTOR_DISPATCH_H__
 
 #include "Connector.h"
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <vector>
 
+// how a packet stored in the connector picks its output
+enum VA_DISPATCH_POLICY
+{
+    VA_DISPATCH_CHANNEL = 0,    // channel % output number
+    VA_DISPATCH_LEAST_DEPTH,    // output with the fewest queued packets
+    VA_DISPATCH_TWO_CHOICES,    // less loaded of two random outputs
+    VA_DISPATCH_STICKY,         // channel % output number, spills to the least loaded
+                                // output when the preferred one holds more than the threshold
+};
+
 class VAConnectorDispatch : public VAConnector
 {
 public:
     VAConnectorDispatch(uint32_t maxInput, uint32_t maxOutput, uint32_t bufferNum);
     ~VAConnectorDispatch();
-    
+
+    // set before the pipeline runs
+    void SetPolicy(VA_DISPATCH_POLICY policy, uint32_t spillDepth = DEFAULT_SPILL_DEPTH);
+
+    inline uint32_t Depth(uint32_t output) {return m_depths[output].load(std::memory_order_relaxed); }
+
+    static const uint32_t DEFAULT_SPILL_DEPTH = 4;
+
 protected:
     virtual VADataPacket *GetInput(int index) override;
     virtual void StoreInput(int index, VADataPacket *data) override;
@@ -41,16 +60,32 @@ protected:
         const VAConnectorPin *calledPin) override;
     virtual void StoreOutput(int index, VADataPacket *data) override;
     virtual void Trigger();
+    virtual VADataPacket *TryGetInput(int index) override;
+    virtual uint32_t GetInputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait) override;
+    virtual uint32_t GetOutputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait,
+        const VAConnectorPin *calledPin) override;
+    virtual void StoreOutputBatch(int index, VADataPacket **packets, uint32_t num) override;
+
+    uint32_t PopOutputs(int index, VADataPacket **packets, uint32_t maxNum, const timespec *abstime);
+
+    uint32_t SelectOutput(uint32_t channel);
+    uint32_t LeastDepthOutput();
 
     std::vector<VADataPacket> m_packets;
 
-    typedef std::list<VADataPacket *> PacketList;
-    PacketList m_inPipe;
-    std::vector<PacketList> m_outPipes;
+    VAPacketQueue m_inPipe;
+    std::vector<VAPacketQueue> m_outPipes;
 
     std::mutex m_inMutex;
     std::vector<std::mutex> m_outMutex;
     std::vector<std::condition_variable> m_conds;
+
+    VA_DISPATCH_POLICY m_policy;
+    uint32_t m_spillDepth;
+    // packets queued on each output, read by the policies without the output mutexes
+    std::unique_ptr<std::atomic<uint32_t>[]> m_depths;
+    // start of the least depth scan, rotated so that ties don't always go to output 0
+    std::atomic<uint32_t> m_scanStart;
 };
 
 #endif
@@ -0,0 +1,187 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ConnectorLockFree.h"
+#include <algorithm>
+
+VAConnectorLockFree::VAConnectorLockFree(uint32_t maxInput, uint32_t maxOutput, uint32_t bufferNum):
+    VAConnector(maxInput, maxOutput),
+    m_inPipe(maxInput * bufferNum),
+    m_outPipe(maxInput * bufferNum),
+    m_pinDisconnected(false)
+{
+    uint32_t totalBufferNum = maxInput * bufferNum;
+    m_packets = new VADataPacket[totalBufferNum];
+    for (int i = 0; i < totalBufferNum; i++)
+    {
+        m_inPipe.Push(&m_packets[i]);
+    }
+}
+
+VAConnectorLockFree::~VAConnectorLockFree()
+{
+    if (m_packets)
+    {
+        delete[] m_packets;
+    }
+}
+
+VADataPacket *VAConnectorLockFree::GetInput(int index)
+{
+    VADataPacket *buffer = nullptr;
+    while (1)
+    {
+        if (m_noInput || m_noOutput)
+        {
+            Trigger();
+            break;
+        }
+
+        if (m_inPipe.Pop(buffer))
+            break;
+
+        uint32_t key = m_inEvent.PrepareWait();
+        if (m_inPipe.Pop(buffer))
+        {
+            m_inEvent.CancelWait();
+            break;
+        }
+        if (m_noInput || m_noOutput)
+        {
+            m_inEvent.CancelWait();
+            continue;
+        }
+        m_inEvent.Wait(key);
+    }
+    return buffer;
+}
+
+VADataPacket *VAConnectorLockFree::TryGetInput(int index)
+{
+    VADataPacket *buffer = nullptr;
+    if (m_noInput || m_noOutput)
+    {
+        Trigger();
+        return nullptr;
+    }
+    m_inPipe.Pop(buffer);
+    return buffer;
+}
+
+void VAConnectorLockFree::StoreInput(int index, VADataPacket *data)
+{
+    // the ring can hold all the packets of the connector, so it never overflows
+    m_outPipe.Push(data);
+    m_outEvent.Notify();
+}
+
+void VAConnectorLockFree::Trigger()
+{
+    // Trigger is called by DisconnectPin after the pin lists are updated
+    m_pinDisconnected.store(true, std::memory_order_release);
+    m_inEvent.Notify(true);
+    m_outEvent.Notify(true);
+}
+
+bool VAConnectorLockFree::IsDisconnected(const VAConnectorPin *calledPin)
+{
+    if (!calledPin || !m_pinDisconnected.load(std::memory_order_acquire))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_OutputMutex);
+    return std::find(m_outputDisconnectedPins.begin(),
+                     m_outputDisconnectedPins.end(), calledPin) != m_outputDisconnectedPins.end();
+}
+
+VADataPacket *VAConnectorLockFree::GetOutput(int index, const timespec *abstime,
+                                             const VAConnectorPin *calledPin)
+{
+    VADataPacket *buffer = nullptr;
+    bool timeout = false;
+    while (1)
+    {
+        if (m_noInput || m_noOutput)
+        {
+            Trigger();
+            break;
+        }
+
+        if (IsDisconnected(calledPin))
+            break;
+
+        if (m_outPipe.Pop(buffer) || timeout)
+            break;
+
+        uint32_t key = m_outEvent.PrepareWait();
+        if (m_outPipe.Pop(buffer))
+        {
+            m_outEvent.CancelWait();
+            break;
+        }
+        if (m_noInput || m_noOutput)
+        {
+            m_outEvent.CancelWait();
+            continue;
+        }
+        timeout = !m_outEvent.Wait(key, abstime);
+    }
+    return buffer;
+}
+
+VADataPacket *VAConnectorLockFree::TryGetOutput(int index, const VAConnectorPin *calledPin)
+{
+    VADataPacket *buffer = nullptr;
+    if (m_noInput || m_noOutput)
+    {
+        Trigger();
+        return nullptr;
+    }
+    if (IsDisconnected(calledPin))
+        return nullptr;
+
+    m_outPipe.Pop(buffer);
+    return buffer;
+}
+
+void VAConnectorLockFree::StoreOutput(int index, VADataPacket *data)
+{
+    m_inPipe.Push(data);
+    m_inEvent.Notify();
+}
+
+void VAConnectorLockFree::StoreInputBatch(int index, VADataPacket **packets, uint32_t num)
+{
+    for (uint32_t i = 0; i < num; i++)
+    {
+        m_outPipe.Push(packets[i]);
+    }
+    m_outEvent.Notify(num > 1);
+}
+
+void VAConnectorLockFree::StoreOutputBatch(int index, VADataPacket **packets, uint32_t num)
+{
+    for (uint32_t i = 0; i < num; i++)
+    {
+        m_inPipe.Push(packets[i]);
+    }
+    m_inEvent.Notify(num > 1);
+}
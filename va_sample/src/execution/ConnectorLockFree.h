@@ -0,0 +1,67 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __CONNECTOR_LOCK_FREE_H__
+#define __CONNECTOR_LOCK_FREE_H__
+
+#include "Connector.h"
+#include "LockFree.h"
+
+// Drop-in replacement of VAConnectorRR
+// The free and filled packets are kept in preallocated lock free rings
+// and the blocking waits are done with futex based eventcounts instead of sleeping
+class VAConnectorLockFree : public VAConnector
+{
+public:
+    VAConnectorLockFree(uint32_t maxInput, uint32_t maxOutput, uint32_t bufferNum);
+    ~VAConnectorLockFree();
+
+    VAConnectorLockFree(const VAConnectorLockFree&) = delete;
+    VAConnectorLockFree& operator=(const VAConnectorLockFree&) = delete;
+
+protected:
+    virtual VADataPacket *GetInput(int index) override;
+    virtual void StoreInput(int index, VADataPacket *data) override;
+    virtual VADataPacket *GetOutput(int index, const timespec *abstime,
+        const VAConnectorPin *calledPin) override;
+    virtual void StoreOutput(int index, VADataPacket *data) override;
+    virtual void Trigger() override;
+    virtual VADataPacket *TryGetInput(int index) override;
+    virtual VADataPacket *TryGetOutput(int index, const VAConnectorPin *calledPin) override;
+    // the rings have no lock to save, but the waiters are woken once per batch
+    virtual void StoreInputBatch(int index, VADataPacket **packets, uint32_t num) override;
+    virtual void StoreOutputBatch(int index, VADataPacket **packets, uint32_t num) override;
+
+    bool IsDisconnected(const VAConnectorPin *calledPin);
+
+    VADataPacket *m_packets;
+    VALockFreeRing<VADataPacket *> m_inPipe;
+    VALockFreeRing<VADataPacket *> m_outPipe;
+
+    VAEventCount m_inEvent;
+    VAEventCount m_outEvent;
+
+    // set once any pin gets disconnected, saves the pin list lookup in the common case
+    std::atomic<bool> m_pinDisconnected;
+};
+
+#endif
@@ -25,7 +25,9 @@
 #include <algorithm>
 
 VAConnectorRR::VAConnectorRR(uint32_t maxInput, uint32_t maxOutput, uint32_t bufferNum):
-    VAConnector(maxInput, maxOutput)
+    VAConnector(maxInput, maxOutput),
+    m_inPipe(maxInput * bufferNum),
+    m_outPipe(maxInput * bufferNum)
 {
     uint32_t totalBufferNum = maxInput * bufferNum;
     m_packets = new VADataPacket[totalBufferNum];
@@ -45,8 +47,22 @@ VAConnectorRR::~VAConnectorRR()
 
 VADataPacket *VAConnectorRR::GetInput(int index)
 {
-    VADataPacket *buffer = NULL;
-    do
+    VADataPacket *buffer = nullptr;
+    GetInputBatch(index, &buffer, 1, true);
+    return buffer;
+}
+
+VADataPacket *VAConnectorRR::TryGetInput(int index)
+{
+    VADataPacket *buffer = nullptr;
+    GetInputBatch(index, &buffer, 1, false);
+    return buffer;
+}
+
+uint32_t VAConnectorRR::GetInputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait)
+{
+    uint32_t num = 0;
+    while (1)
     {
         if (m_noInput || m_noOutput)
         {
@@ -54,28 +70,39 @@ VADataPacket *VAConnectorRR::GetInput(int index)
             break;
         }
 
-        std::unique_lock<std::mutex> lock(m_mutex);
-        if (m_inPipe.size() > 0)
         {
-            buffer = m_inPipe.front();
-            m_inPipe.pop_front();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (num < maxNum && m_inPipe.size() > 0)
+            {
+                packets[num++] = m_inPipe.front();
+                m_inPipe.pop_front();
+            }
         }
-        else
-        {
-            lock.unlock();
-            usleep(500);
-        }
-    } while (buffer == NULL);
-    return buffer;
+        if (num > 0 || !wait)
+            break;
+        usleep(500);
+    }
+    return num;
 }
 
 void VAConnectorRR::StoreInput(int index, VADataPacket *data)
+{
+    StoreInputBatch(index, &data, 1);
+}
+
+void VAConnectorRR::StoreInputBatch(int index, VADataPacket **packets, uint32_t num)
 {
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_outPipe.push_back(data);
+        for (uint32_t i = 0; i < num; i++)
+        {
+            m_outPipe.push_back(packets[i]);
+        }
     }
-    m_cond.notify_one();
+    if (num == 1)
+        m_cond.notify_one();
+    else
+        m_cond.notify_all();
 }
 
 void VAConnectorRR::Trigger()
@@ -86,8 +113,23 @@ void VAConnectorRR::Trigger()
 VADataPacket *VAConnectorRR::GetOutput(int index, const timespec *abstime,
                                        const VAConnectorPin *calledPin) 
 {
-    bool timeout = false;
     VADataPacket *buffer = nullptr;
+    PopOutputs(&buffer, 1, abstime, calledPin);
+    return buffer;
+}
+
+uint32_t VAConnectorRR::GetOutputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait,
+                                       const VAConnectorPin *calledPin)
+{
+    timespec now = {0, 0};
+    return PopOutputs(packets, maxNum, wait ? nullptr : &now, calledPin);
+}
+
+uint32_t VAConnectorRR::PopOutputs(VADataPacket **packets, uint32_t maxNum, const timespec *abstime,
+                                   const VAConnectorPin *calledPin)
+{
+    bool timeout = false;
+    uint32_t num = 0;
 
     std::unique_lock<std::mutex> lock(m_mutex);
     do
@@ -109,8 +151,11 @@ VADataPacket *VAConnectorRR::GetOutput(int index, const timespec *abstime,
 
         if (m_outPipe.size() > 0)
         {
-            buffer = m_outPipe.front();
-            m_outPipe.pop_front();
+            while (num < maxNum && m_outPipe.size() > 0)
+            {
+                packets[num++] = m_outPipe.front();
+                m_outPipe.pop_front();
+            }
         }
         else if (abstime == nullptr)
         {
@@ -125,8 +170,8 @@ VADataPacket *VAConnectorRR::GetOutput(int index, const timespec *abstime,
         {
             break;
         }
-    } while(buffer == NULL);
-    return buffer;
+    } while(num == 0);
+    return num;
 }
 
 void VAConnectorRR::StoreOutput(int index, VADataPacket *data)
@@ -135,3 +180,11 @@ void VAConnectorRR::StoreOutput(int index, VADataPacket *data)
     m_inPipe.push_front(data);
 }
 
+void VAConnectorRR::StoreOutputBatch(int index, VADataPacket **packets, uint32_t num)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < num; i++)
+    {
+        m_inPipe.push_front(packets[i]);
+    }
+}
@@ -43,10 +43,19 @@ protected:
         const VAConnectorPin *calledPin) override;
     virtual void StoreOutput(int index, VADataPacket *data) override;
     virtual void Trigger();
+    virtual VADataPacket *TryGetInput(int index) override;
+    virtual uint32_t GetInputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait) override;
+    virtual uint32_t GetOutputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait,
+        const VAConnectorPin *calledPin) override;
+    virtual void StoreInputBatch(int index, VADataPacket **packets, uint32_t num) override;
+    virtual void StoreOutputBatch(int index, VADataPacket **packets, uint32_t num) override;
+
+    uint32_t PopOutputs(VADataPacket **packets, uint32_t maxNum, const timespec *abstime,
+        const VAConnectorPin *calledPin);
 
     VADataPacket *m_packets;
-    std::list<VADataPacket *> m_inPipe;
-    std::list<VADataPacket *> m_outPipe;
+    VAPacketQueue m_inPipe;
+    VAPacketQueue m_outPipe;
 
     std::mutex m_mutex;
     std::condition_variable m_cond;
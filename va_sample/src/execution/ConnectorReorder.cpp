@@ -0,0 +1,321 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ConnectorReorder.h"
+#include <unistd.h>
+#include <algorithm>
+
+using namespace std::chrono;
+
+VAConnectorReorder::VAConnectorReorder(uint32_t maxInput, uint32_t maxOutput, uint32_t bufferNum,
+                                       uint32_t window, uint32_t timeoutMs):
+    VAConnector(maxInput, maxOutput),
+    m_inPipe(maxInput * bufferNum),
+    m_outPipe(maxInput * bufferNum),
+    m_pendingNum(0),
+    m_window(window),
+    m_timeout(timeoutMs),
+    m_skipped(0)
+{
+    uint32_t totalBufferNum = maxInput * bufferNum;
+    m_packets = new VADataPacket[totalBufferNum];
+    for (int i = 0; i < totalBufferNum; i++)
+    {
+        m_inPipe.push_back(&m_packets[i]);
+    }
+}
+
+VAConnectorReorder::~VAConnectorReorder()
+{
+    if (m_skipped)
+    {
+        INFO("VAConnectorReorder: skipped %lu missing packets", m_skipped);
+    }
+    if (m_packets)
+    {
+        delete[] m_packets;
+    }
+}
+
+VADataPacket *VAConnectorReorder::GetInput(int index)
+{
+    VADataPacket *buffer = NULL;
+    do
+    {
+        if (m_noInput || m_noOutput)
+        {
+            Trigger();
+            break;
+        }
+
+        buffer = TryGetInput(index);
+        if (!buffer)
+        {
+            usleep(500);
+        }
+    } while (buffer == NULL);
+    return buffer;
+}
+
+VADataPacket *VAConnectorReorder::TryGetInput(int index)
+{
+    VADataPacket *buffer = nullptr;
+    if (m_noInput || m_noOutput)
+    {
+        Trigger();
+        return buffer;
+    }
+
+    bool released = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_inPipe.size() == 0 && m_outPipe.size() == 0)
+        {
+            // every free packet waits for a missing frame, the frame may be
+            // stuck upstream waiting for a packet, so give it up
+            released = SkipOldest();
+        }
+        if (m_inPipe.size() > 0)
+        {
+            buffer = m_inPipe.front();
+            m_inPipe.pop_front();
+        }
+    }
+    if (released)
+    {
+        m_cond.notify_all();
+    }
+    return buffer;
+}
+
+void VAConnectorReorder::ReleaseInOrder(Channel &channel)
+{
+    auto ite = channel.pending.begin();
+    while (ite != channel.pending.end() && ite->first == channel.next)
+    {
+        m_outPipe.push_back(ite->second.packet);
+        ite = channel.pending.erase(ite);
+        -- m_pendingNum;
+        ++ channel.next;
+    }
+}
+
+void VAConnectorReorder::SkipTo(Channel &channel, uint32_t sequence)
+{
+    m_skipped += sequence - channel.next;
+    channel.next = sequence;
+    ReleaseInOrder(channel);
+}
+
+uint32_t VAConnectorReorder::PacketSequence(VADataPacket *packet)
+{
+    for (auto ite = packet->begin(); ite != packet->end(); ite ++)
+    {
+        uint32_t sequence = (*ite)->Sequence();
+        if (sequence)
+            return sequence;
+    }
+    return 0;
+}
+
+bool VAConnectorReorder::SkipOldest()
+{
+    Channel *oldest = nullptr;
+    for (auto ite = m_channels.begin(); ite != m_channels.end(); ite ++)
+    {
+        Channel &channel = ite->second;
+        if (!channel.pending.empty() && (!oldest ||
+            channel.pending.begin()->second.deadline < oldest->pending.begin()->second.deadline))
+        {
+            oldest = &channel;
+        }
+    }
+    if (!oldest)
+        return false;
+    SkipTo(*oldest, oldest->pending.begin()->first);
+    return true;
+}
+
+VAConnectorReorder::TimePoint VAConnectorReorder::SkipExpired(TimePoint now)
+{
+    TimePoint next = TimePoint::max();
+    for (auto ite = m_channels.begin(); ite != m_channels.end(); ite ++)
+    {
+        Channel &channel = ite->second;
+        while (!channel.pending.empty() && channel.pending.begin()->second.deadline <= now)
+        {
+            SkipTo(channel, channel.pending.begin()->first);
+        }
+        if (!channel.pending.empty())
+        {
+            next = std::min(next, channel.pending.begin()->second.deadline);
+        }
+    }
+    return next;
+}
+
+void VAConnectorReorder::ReleaseAll()
+{
+    for (auto ite = m_channels.begin(); ite != m_channels.end(); ite ++)
+    {
+        Channel &channel = ite->second;
+        while (!channel.pending.empty())
+        {
+            SkipTo(channel, channel.pending.begin()->first);
+        }
+    }
+}
+
+void VAConnectorReorder::StoreInput(int index, VADataPacket *data)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint32_t sequence = PacketSequence(data);
+        if (sequence == 0)
+        {
+            // nothing to order by
+            m_outPipe.push_back(data);
+        }
+        else
+        {
+            Channel &channel = m_channels[data->front()->ChannelIndex()];
+            if (sequence < channel.next || channel.pending.count(sequence))
+            {
+                // too late, the channel already moved on
+                m_outPipe.push_back(data);
+            }
+            else
+            {
+                channel.pending[sequence] = {data, system_clock::now() + m_timeout};
+                ++ m_pendingNum;
+                ReleaseInOrder(channel);
+                if (channel.pending.size() > m_window)
+                {
+                    SkipTo(channel, channel.pending.begin()->first);
+                }
+            }
+        }
+    }
+    m_cond.notify_all();
+}
+
+void VAConnectorReorder::Trigger()
+{
+    m_cond.notify_all();
+}
+
+VADataPacket *VAConnectorReorder::GetOutput(int index, const timespec *abstime,
+                                            const VAConnectorPin *calledPin)
+{
+    VADataPacket *buffer = nullptr;
+    PopOutputs(&buffer, 1, abstime, calledPin);
+    return buffer;
+}
+
+uint32_t VAConnectorReorder::GetOutputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait,
+                                            const VAConnectorPin *calledPin)
+{
+    timespec now = {0, 0};
+    return PopOutputs(packets, maxNum, wait ? nullptr : &now, calledPin);
+}
+
+uint32_t VAConnectorReorder::PopOutputs(VADataPacket **packets, uint32_t maxNum, const timespec *abstime,
+                                        const VAConnectorPin *calledPin)
+{
+    bool timeout = false;
+    uint32_t num = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    do
+    {
+        if (m_noInput)
+        {
+            // no more input, the missing frames won't come
+            ReleaseAll();
+        }
+        if (m_noOutput || (m_noInput && m_outPipe.size() == 0))
+        {
+            Trigger();
+            break;
+        }
+
+        if (calledPin)
+        {
+            std::list<VAConnectorPin *>::iterator iter =
+                std::find(m_outputDisconnectedPins.begin(),
+                          m_outputDisconnectedPins.end(), calledPin);
+            if (iter != m_outputDisconnectedPins.end()) // pin has been disconnected
+                break;
+        }
+
+        TimePoint deadline = TimePoint::max();
+        if (m_pendingNum > 0)
+        {
+            deadline = SkipExpired(system_clock::now());
+        }
+
+        if (m_outPipe.size() > 0)
+        {
+            while (num < maxNum && m_outPipe.size() > 0)
+            {
+                packets[num++] = m_outPipe.front();
+                m_outPipe.pop_front();
+            }
+        }
+        else if (timeout)
+        {
+            break;
+        }
+        else
+        {
+            if (abstime)
+            {
+                TimePoint until = time_point_cast<system_clock::duration>(timespec2tp(*abstime));
+                if (until <= deadline)
+                {
+                    deadline = until;
+                    timeout = true;
+                }
+            }
+            if (deadline == TimePoint::max())
+                m_cond.wait(lock);
+            else
+                m_cond.wait_until(lock, deadline);
+        }
+    } while(num == 0);
+    return num;
+}
+
+void VAConnectorReorder::StoreOutput(int index, VADataPacket *data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_inPipe.push_front(data);
+}
+
+void VAConnectorReorder::StoreOutputBatch(int index, VADataPacket **packets, uint32_t num)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < num; i++)
+    {
+        m_inPipe.push_front(packets[i]);
+    }
+}
@@ -0,0 +1,113 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __CONNECTOR_REORDER_H__
+#define __CONNECTOR_REORDER_H__
+
+#include "Connector.h"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+// Like VAConnectorRR, but the packets of every channel leave in decoding order
+// whatever the order the parallel blocks before it finish them.
+// The packets are ordered by the sequence the decoder stamps on the VAData of
+// its non empty packets, not by the frame index, which skips the frames
+// without vp output. A packet waits until the previous one of its channel went
+// out. If that one is lost, the channel moves on when the oldest waiting packet
+// has waited longer than the timeout, when more than 'window' packets of the
+// channel wait, or when the producers run out of free packets.
+// Packets arriving after their channel moved on, and packets without
+// sequence, are released at once.
+class VAConnectorReorder : public VAConnector
+{
+public:
+    VAConnectorReorder(uint32_t maxInput, uint32_t maxOutput, uint32_t bufferNum,
+        uint32_t window = DEFAULT_WINDOW, uint32_t timeoutMs = DEFAULT_TIMEOUT_MS);
+    ~VAConnectorReorder();
+
+    VAConnectorReorder(const VAConnectorReorder&) = delete;
+    VAConnectorReorder& operator=(const VAConnectorReorder&) = delete;
+
+    // number of packets given up after a timeout, a full window or a full connector
+    inline uint64_t SkippedFrames() {return m_skipped; }
+
+    static const uint32_t DEFAULT_WINDOW = 16;
+    static const uint32_t DEFAULT_TIMEOUT_MS = 200;
+
+protected:
+    typedef std::chrono::system_clock::time_point TimePoint;
+
+    struct Pending
+    {
+        VADataPacket *packet;
+        TimePoint deadline;
+    };
+
+    struct Channel
+    {
+        // the decoder numbers the packets from 1
+        uint32_t next = 1;
+        std::map<uint32_t, Pending> pending;
+    };
+
+    virtual VADataPacket *GetInput(int index) override;
+    virtual void StoreInput(int index, VADataPacket *data) override;
+    virtual VADataPacket *GetOutput(int index, const timespec *abstime,
+        const VAConnectorPin *calledPin) override;
+    virtual void StoreOutput(int index, VADataPacket *data) override;
+    virtual void Trigger();
+    virtual VADataPacket *TryGetInput(int index) override;
+    virtual uint32_t GetOutputBatch(int index, VADataPacket **packets, uint32_t maxNum, bool wait,
+        const VAConnectorPin *calledPin) override;
+    virtual void StoreOutputBatch(int index, VADataPacket **packets, uint32_t num) override;
+
+    uint32_t PopOutputs(VADataPacket **packets, uint32_t maxNum, const timespec *abstime,
+        const VAConnectorPin *calledPin);
+
+    // called with m_mutex held
+    void ReleaseInOrder(Channel &channel);
+    void SkipTo(Channel &channel, uint32_t sequence);
+    // the sequence of the first VAData of the packet that has one, 0 if none
+    static uint32_t PacketSequence(VADataPacket *packet);
+    // gives up the oldest missing frame, returns false if nothing is pending
+    bool SkipOldest();
+    // gives up the frames whose deadline passed, returns the next deadline
+    TimePoint SkipExpired(TimePoint now);
+    void ReleaseAll();
+
+    VADataPacket *m_packets;
+    VAPacketQueue m_inPipe;
+    VAPacketQueue m_outPipe;
+
+    std::map<uint32_t, Channel> m_channels;
+    uint32_t m_pendingNum;
+    uint32_t m_window;
+    std::chrono::milliseconds m_timeout;
+    uint64_t m_skipped;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+};
+
+#endif
@@ -22,85 +22,214 @@
 
 #include "DataPacket.h"
 #include <unistd.h>
+#include <new>
+#include <stddef.h>
+#include <algorithm>
 
 static int initialized = VADataCleaner::getInstance().Initialize(false);
 
-static void *VaDataCleanerFunc(void *arg)
-{
-    VADataCleaner *cleaner = static_cast<VADataCleaner *>(arg);
-    while (cleaner->Continue())
-    {
-        cleaner->Destroy();
-        usleep(100000);
-    }
-    return (void *)0;
-}
-
 VADataCleaner::VADataCleaner():
-    m_continue(false),
     m_debug(false)
 {
 }
 
 VADataCleaner::~VADataCleaner()
 {
-    Destroy();
-    m_continue = false;
-    pthread_join(m_threadId, nullptr);
 }
 
 int VADataCleaner::Initialize(bool debug)
 {
-    m_continue = true;
     m_debug = debug;
-    pthread_create(&m_threadId, nullptr, VaDataCleanerFunc, (void *)this);
     return 0;
 }
 
-void VADataCleaner::Destroy()
+void VADataCleaner::Add(VAData *data)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    while (!m_destroyList.empty())
+    data->Destroy();
+    if (m_debug)
+    {
+        printf("VADataCleaner: delete data %p, channel %d, frame %d\n", data, data->ChannelIndex(), data->FrameIndex());
+    }
+    delete data;
+}
+
+// per-thread cache of free VAData objects, returned to the global pool when the thread exits
+struct VADataThreadCache
+{
+    VADataThreadCache():
+        hits(0),
+        misses(0)
+    {
+        objects.reserve(VADataPool::CACHE_SIZE + VADataPool::BATCH_SIZE);
+        VADataPool::getInstance().Register(this);
+    }
+
+    ~VADataThreadCache()
     {
-        VAData *data = m_destroyList.front();
-        if (m_debug)
+        VADataPool &pool = VADataPool::getInstance();
+        pool.Flush(objects, objects.size());
+        pool.Unregister(this);
+    }
+
+    // only the owner thread writes the counters, the pool reads them at any time
+    static inline void Increment(std::atomic<uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::vector<void *> objects;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+};
+
+static VADataThreadCache &GetThreadCache()
+{
+    static thread_local VADataThreadCache cache;
+    return cache;
+}
+
+VADataPool::VADataPool():
+    m_objectSize((sizeof(VAData) + alignof(VAData) - 1) / alignof(VAData) * alignof(VAData)),
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+VADataPool::~VADataPool()
+{
+    for (auto ite = m_slabs.begin(); ite != m_slabs.end(); ite ++)
+    {
+        ::operator delete(*ite);
+    }
+}
+
+void *VADataPool::Allocate(size_t size)
+{
+    if (size > m_objectSize)
+    {
+        // only VAData is expected here
+        throw std::bad_alloc();
+    }
+
+    VADataThreadCache &cache = GetThreadCache();
+    if (cache.objects.empty())
+    {
+        Refill(cache.objects);
+        if (cache.objects.empty())
         {
-            printf("VADataCleaner Thread: delete data %p, channel %d, frame %d\n", data, data->ChannelIndex(), data->FrameIndex());
+            VADataThreadCache::Increment(cache.misses);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            uint8_t *slab = (uint8_t *)::operator new(m_objectSize * SLAB_SIZE);
+            m_slabs.push_back(slab);
+            for (uint32_t i = 1; i < SLAB_SIZE; i++)
+            {
+                cache.objects.push_back(slab + i * m_objectSize);
+            }
+            return slab;
         }
-        delete data;
-        m_destroyList.pop_front();
     }
+
+    VADataThreadCache::Increment(cache.hits);
+    void *p = cache.objects.back();
+    cache.objects.pop_back();
+    return p;
 }
 
-void VADataCleaner::Add(VAData *data)
+void VADataPool::Free(void *p)
+{
+    if (!p)
+        return;
+
+    VADataThreadCache &cache = GetThreadCache();
+    cache.objects.push_back(p);
+    if (cache.objects.size() > CACHE_SIZE)
+    {
+        // objects created in one thread are mostly released in another thread,
+        // so give the surplus back to the producers
+        Flush(cache.objects, BATCH_SIZE);
+    }
+}
+
+void VADataPool::Refill(std::vector<void *> &cache)
 {
-    data->Destroy();
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_destroyList.push_back(data);
+    uint32_t count = (m_freeList.size() > BATCH_SIZE) ? BATCH_SIZE : m_freeList.size();
+    cache.insert(cache.end(), m_freeList.end() - count, m_freeList.end());
+    m_freeList.resize(m_freeList.size() - count);
+}
+
+void VADataPool::Flush(std::vector<void *> &cache, uint32_t count)
+{
+    if (count > cache.size())
+    {
+        count = cache.size();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeList.insert(m_freeList.end(), cache.end() - count, cache.end());
+    cache.resize(cache.size() - count);
+}
+
+void VADataPool::Register(VADataThreadCache *cache)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_caches.push_back(cache);
+}
+
+void VADataPool::Unregister(VADataThreadCache *cache)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hits += cache->hits.load(std::memory_order_relaxed);
+    m_misses += cache->misses.load(std::memory_order_relaxed);
+    m_caches.erase(std::find(m_caches.begin(), m_caches.end(), cache));
+}
+
+void VADataPool::Count(uint64_t *hits, uint64_t *misses)
+{
+    *hits = m_hits;
+    *misses = m_misses;
+    for (auto cache : m_caches)
+    {
+        *hits += cache->hits.load(std::memory_order_relaxed);
+        *misses += cache->misses.load(std::memory_order_relaxed);
+    }
+}
+
+uint64_t VADataPool::Hits()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t hits, misses;
+    Count(&hits, &misses);
+    return hits;
+}
+
+uint64_t VADataPool::Misses()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t hits, misses;
+    Count(&hits, &misses);
+    return misses;
+}
+
+void VADataPool::Report()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t hits, misses;
+    Count(&hits, &misses);
+    printf("VADataPool: %lu hits, %lu misses, %lu slabs (%lu objects each), %lu objects in global free list\n",
+        hits, misses, m_slabs.size(), (uint64_t)SLAB_SIZE, m_freeList.size());
 }
 
 VAData::VAData():
-    m_mfxSurface(nullptr),
-#ifndef MSDK_2_0_API
-    m_mfxAllocator(nullptr),
-#endif
-    m_data(nullptr),
-    m_width(0),
-    m_height(0),
-    m_pitch(0),
-    m_fourcc(0),
-    m_left(0.0),
-    m_right(0.0),
-    m_top(0.0),
-    m_bottom(0.0),
-    m_class(-1),
-    m_confidence(1.0),
-    m_vaSurf(VA_INVALID_ID),
     m_internalRef(1),
     m_channelIndex(0),
     m_frameIndex(0),
-    m_roiIndex(0)
+    m_roiIndex(0),
+    m_type(USER_SURFACE),
+    m_sequence(0)
 {
+    // the ROI entries are the most numerous, keep each one in a single cache line
+    static_assert(offsetof(VAData, m_roi) + sizeof(RoiData) <= 64, "ROI VAData exceeds one cache line");
+    static_assert(sizeof(ClassData) <= sizeof(SurfaceData), "the classes make VAData larger");
     m_ref = &m_internalRef;
 }
 
@@ -110,12 +239,13 @@ VAData::VAData(mfxFrameSurface1 *surface, mfxFrameAllocator *allocator):
 {
     m_type = MFX_SURFACE;
 
-    m_mfxSurface = surface;
-    m_mfxAllocator = allocator;
-    m_width = surface->Info.Width;
-    m_height = surface->Info.Height;
-    m_pitch = m_width;
-    m_fourcc = surface->Info.FourCC;
+    m_surface.data = nullptr;
+    m_surface.mfx.surface = surface;
+    m_surface.mfx.allocator = allocator;
+    m_surface.width = surface->Info.Width;
+    m_surface.height = surface->Info.Height;
+    m_surface.pitch = surface->Info.Width;
+    m_surface.fourcc = surface->Info.FourCC;
 }
 #else
 VAData::VAData(mfxFrameSurface1 *surface):
@@ -123,11 +253,12 @@ VAData::VAData(mfxFrameSurface1 *surface):
 {
     m_type = MFX_SURFACE;
 
-    m_mfxSurface = surface;
-    m_width = surface->Info.Width;
-    m_height = surface->Info.Height;
-    m_pitch = m_width;
-    m_fourcc = surface->Info.FourCC;
+    m_surface.data = nullptr;
+    m_surface.mfx.surface = surface;
+    m_surface.width = surface->Info.Width;
+    m_surface.height = surface->Info.Height;
+    m_surface.pitch = surface->Info.Width;
+    m_surface.fourcc = surface->Info.FourCC;
 }
 
 #endif
@@ -137,11 +268,12 @@ VAData::VAData(VASurfaceID surface, uint32_t w, uint32_t h, uint32_t p, uint32_t
 {
     m_type = VA_SURFACE;
 
-    m_vaSurf = surface;
-    m_width = w;
-    m_height = h;
-    m_pitch = p;
-    m_fourcc = fourcc;
+    m_surface.data = nullptr;
+    m_surface.vaSurf = surface;
+    m_surface.width = w;
+    m_surface.height = h;
+    m_surface.pitch = p;
+    m_surface.fourcc = fourcc;
 }
 
 
@@ -150,11 +282,12 @@ VAData::VAData(uint8_t *data, uint32_t w, uint32_t h, uint32_t p, uint32_t fourc
 {
     m_type = USER_SURFACE;
 
-    m_data = data;
-    m_width = w;
-    m_height = h;
-    m_pitch = p;
-    m_fourcc = fourcc;
+    m_surface.data = data;
+    m_surface.vaSurf = VA_INVALID_ID;
+    m_surface.width = w;
+    m_surface.height = h;
+    m_surface.pitch = p;
+    m_surface.fourcc = fourcc;
 }
 
 VAData::VAData(float left, float top, float right, float bottom, int c, float conf):
@@ -162,13 +295,15 @@ VAData::VAData(float left, float top, float right, float bottom, int c, float co
 {
     m_type = ROI_REGION;
 
-    m_left = left;
-    m_top = top;
-    m_right = right;
-    m_bottom = bottom;
+    m_roi.left = left;
+    m_roi.top = top;
+    m_roi.right = right;
+    m_roi.bottom = bottom;
 
-    m_class = c;
-    m_confidence = conf;
+    m_roi.c = c;
+    m_roi.confidence = conf;
+    m_roi.track = 0;
+    m_roi.classify = true;
 }
 
 VAData::VAData(uint8_t *data, uint32_t offset, uint32_t length):
@@ -176,9 +311,9 @@ VAData::VAData(uint8_t *data, uint32_t offset, uint32_t length):
 {
     m_type = USER_BUFFER;
 
-    m_data = data;
-    m_offset = offset;
-    m_length = length;
+    m_buffer.data = data;
+    m_buffer.offset = offset;
+    m_buffer.length = length;
 }
 
 VAData::VAData(int c, float conf):
@@ -186,8 +321,26 @@ VAData::VAData(int c, float conf):
 {
     m_type = IMAGENET_CLASS;
 
-    m_class = c;
-    m_confidence = conf;
+    m_class.c[0] = c;
+    m_class.confidence[0] = conf;
+    m_class.num = 1;
+}
+
+VAData::VAData(const int *classes, const float *confs, uint32_t num):
+    VAData()
+{
+    m_type = IMAGENET_CLASS;
+
+    if (num > VA_MAX_TOP_CLASSES)
+    {
+        num = VA_MAX_TOP_CLASSES;
+    }
+    for (uint32_t i = 0; i < num; i++)
+    {
+        m_class.c[i] = classes[i];
+        m_class.confidence[i] = confs[i];
+    }
+    m_class.num = num;
 }
 
 VAData::~VAData()
@@ -202,7 +355,7 @@ mfxFrameSurface1 *VAData::GetMfxSurface()
     }
     else
     {
-        return m_mfxSurface;
+        return m_surface.mfx.surface;
     }
 }
 
@@ -215,7 +368,7 @@ mfxFrameAllocator *VAData::GetMfxAllocator()
     }
     else
     {
-        return m_mfxAllocator;
+        return m_surface.mfx.allocator;
     }
 
 }
@@ -223,22 +376,28 @@ mfxFrameAllocator *VAData::GetMfxAllocator()
 
 uint8_t *VAData::GetSurfacePointer()
 {
-    if (m_type == USER_SURFACE || m_type == USER_BUFFER)
+    if (m_type == USER_SURFACE)
+    {
+        return m_surface.data;
+    }
+    else if (m_type == USER_BUFFER)
     {
-        return m_data;
+        return m_buffer.data;
     }
     else if (m_type == MFX_SURFACE)
     {
-        if (m_data == nullptr)
+        mfxFrameSurface1 *surface = m_surface.mfx.surface;
+        if (m_surface.data == nullptr)
         {
 #ifndef MSDK_2_0_API
-            m_mfxAllocator->Lock(m_mfxAllocator->pthis, m_mfxSurface->Data.MemId, &(m_mfxSurface->Data));
+            mfxFrameAllocator *allocator = m_surface.mfx.allocator;
+            allocator->Lock(allocator->pthis, surface->Data.MemId, &(surface->Data));
 #else
-            m_mfxSurface->FrameInterface->Map(m_mfxSurface, MFX_MAP_READ_WRITE);
+            surface->FrameInterface->Map(surface, MFX_MAP_READ_WRITE);
 #endif
-            m_data = m_mfxSurface->Data.Y;
+            m_surface.data = surface->Data.Y;
         }
-        return m_data;
+        return m_surface.data;
     }
     else
     {
@@ -250,19 +409,21 @@ VASurfaceID VAData::GetVASurface()
 {
     if (m_type == MFX_SURFACE)
     {
+        mfxFrameSurface1 *surface = m_surface.mfx.surface;
         mfxHDL handle;
 #ifndef MSDK_2_0_API
-        m_mfxAllocator->GetHDL(m_mfxAllocator->pthis, m_mfxSurface->Data.MemId, &(handle));
+        mfxFrameAllocator *allocator = m_surface.mfx.allocator;
+        allocator->GetHDL(allocator->pthis, surface->Data.MemId, &(handle));
         return *(VASurfaceID *)handle;
 #else
         mfxResourceType type;
-        m_mfxSurface->FrameInterface->GetNativeHandle(m_mfxSurface, &handle, &type);
+        surface->FrameInterface->GetNativeHandle(surface, &handle, &type);
         return (VASurfaceID)(uint64_t)handle;
 #endif
     }
     else if (m_type == VA_SURFACE)
     {
-        return m_vaSurf;
+        return m_surface.vaSurf;
     }
     else
     {
@@ -272,15 +433,15 @@ VASurfaceID VAData::GetVASurface()
 
 void VAData::SetRef(uint32_t count)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    *m_ref = count;
+    m_ref->store(count, std::memory_order_release);
 }
 
 void VAData::DeRef(VADataPacket *packet, uint32_t count)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    *m_ref = *m_ref - count;
-    if (*m_ref <= 0)
+    // release: the accesses of this holder happen before the buffer reuse
+    // acquire: the last holder sees the accesses of all the others before releasing
+    int ref = m_ref->fetch_sub(count, std::memory_order_acq_rel) - count;
+    if (ref <= 0)
     {
         VADataCleaner::getInstance().Add(this);
     }
@@ -292,42 +453,59 @@ void VAData::DeRef(VADataPacket *packet, uint32_t count)
 
 void VAData::Destroy()
 {
-    if (m_type == MFX_SURFACE && m_data != nullptr)
+    if (m_type != MFX_SURFACE)
+    {
+        return;
+    }
+
+    mfxFrameSurface1 *surface = m_surface.mfx.surface;
+    if (m_surface.data != nullptr)
     {
 #ifndef MSDK_2_0_API
-        m_mfxAllocator->Unlock(m_mfxAllocator->pthis, m_mfxSurface->Data.MemId, &(m_mfxSurface->Data));
+        mfxFrameAllocator *allocator = m_surface.mfx.allocator;
+        allocator->Unlock(allocator->pthis, surface->Data.MemId, &(surface->Data));
 #else
-        m_mfxSurface->FrameInterface->Unmap(m_mfxSurface);
+        surface->FrameInterface->Unmap(surface);
 #endif
     }
 #ifdef MSDK_2_0_API
-    if (m_type == MFX_SURFACE)
-    {
-        m_mfxSurface->FrameInterface->Release(m_mfxSurface);
-    }
+    surface->FrameInterface->Release(surface);
 #endif
-
 }
 
-
 void VAData::GetSurfaceInfo(uint32_t *w, uint32_t *h, uint32_t *p, uint32_t *fourcc)
 {
-    *w = m_width;
-    *h = m_height;
-    *p = m_pitch;
-    *fourcc = m_fourcc;
+    if (!IsSurface())
+    {
+        *w = *h = *p = *fourcc = 0;
+        return;
+    }
+    *w = m_surface.width;
+    *h = m_surface.height;
+    *p = m_surface.pitch;
+    *fourcc = m_surface.fourcc;
 }
 
 void VAData::GetRoiRegion(float *left, float *top, float *right, float *bottom)
 {
-    *left = m_left;
-    *right = m_right;
-    *top = m_top;
-    *bottom = m_bottom;
+    if (m_type != ROI_REGION)
+    {
+        *left = *top = *right = *bottom = 0.0;
+        return;
+    }
+    *left = m_roi.left;
+    *right = m_roi.right;
+    *top = m_roi.top;
+    *bottom = m_roi.bottom;
 }
 
 void VAData::GetBufferInfo(uint32_t *offset, uint32_t *length)
 {
-    *offset = m_offset;
-    *length = m_length;
+    if (m_type != USER_BUFFER)
+    {
+        *offset = *length = 0;
+        return;
+    }
+    *offset = m_buffer.offset;
+    *length = m_buffer.length;
 }
@@ -26,14 +26,22 @@
 #include <pthread.h>
 #include <stdio.h>
 
+#include <atomic>
 #include <list>
 #include <mutex>
+#include <vector>
+#include "SmallVector.h"
 #include "mfxstructures.h"
 #include <mfxvideo++.h>
 #include <va/va.h>
 
 class VAData;
-typedef std::list<VAData *> VADataPacket;
+// most packets carry a surface and a few ROIs, larger ones spill to the heap once
+// and keep that buffer since the packets are recycled by the connectors
+typedef VASmallVector<VAData *, 16> VADataPacket;
+
+// reference count of VAData, also used by the blocks to track the reuse of their output buffers
+typedef std::atomic<int> VARefCount;
 
 enum VA_DATA_TYPE
 {
@@ -45,11 +53,19 @@ enum VA_DATA_TYPE
     VA_SURFACE
 };
 
+// classes of one IMAGENET_CLASS data, the most likely first
+const uint32_t VA_MAX_TOP_CLASSES = 5;
+
+// alignment of the USER_SURFACE buffers allocated by the blocks, the inference wraps such buffers instead of copying them
+const uint32_t VA_SURFACE_ALIGNMENT = 64;
+
 inline uint64_t ID(uint32_t c, uint32_t f)
 {
     return f | ((uint64_t)c << 32);
 }
 
+// VAData are released as soon as the last reference is gone,
+// the objects are recycled by VADataPool
 class VADataCleaner
 {
 public:
@@ -61,20 +77,63 @@ public:
     ~VADataCleaner();
 
     void Add(VAData *data);
-    void Destroy();
 
     int Initialize(bool debug = false);
 
-    inline bool Continue() {return m_continue; }
 private:
     VADataCleaner();
 
+    bool m_debug; //print logs
+};
+
+struct VADataThreadCache;
+
+// Slab allocator for VAData
+// Each thread keeps a small cache of free objects, so Create/Destroy normally
+// don't touch any lock. The caches are refilled from/flushed to a global free
+// list in batches, and new slabs are only allocated when that list is empty.
+class VADataPool
+{
+public:
+    static VADataPool& getInstance()
+    {
+        static VADataPool instance;
+        return instance;
+    }
+    ~VADataPool();
+
+    void *Allocate(size_t size);
+    void Free(void *p);
+
+    // objects reused from the pool / objects carved from a new slab, summed over all the threads
+    uint64_t Hits();
+    uint64_t Misses();
+    void Report();
+
+    static const uint32_t SLAB_SIZE = 256;   // objects per slab
+    static const uint32_t BATCH_SIZE = 64;   // objects moved between thread cache and global list
+    static const uint32_t CACHE_SIZE = 256;  // max objects kept in one thread cache
+
+private:
+    friend struct VADataThreadCache;
+    VADataPool();
+
+    void Refill(std::vector<void *> &cache);
+    void Flush(std::vector<void *> &cache, uint32_t count);
+    void Register(VADataThreadCache *cache);
+    void Unregister(VADataThreadCache *cache);
+    // m_mutex must be held
+    void Count(uint64_t *hits, uint64_t *misses);
+
+    size_t m_objectSize;
     std::mutex m_mutex;
-    std::list<VAData *>m_destroyList;
+    std::vector<void *> m_freeList;
+    std::vector<uint8_t *> m_slabs;
 
-    pthread_t m_threadId;
-    bool m_continue;
-    bool m_debug; //print logs
+    // the caches of the running threads, the counters of the exited ones
+    std::vector<VADataThreadCache *> m_caches;
+    uint64_t m_hits;
+    uint64_t m_misses;
 };
 
 class VAData
@@ -82,7 +141,7 @@ class VAData
 friend class VADataCleaner;
 public:
     // No need to destory these created VAData explictly
-    // there is cleaner for this
+    // they are released and recycled when the reference count drops to 0
 #ifndef MSDK_2_0_API
     static VAData *Create(mfxFrameSurface1 *surface, mfxFrameAllocator *allocator)
     {
@@ -120,6 +179,12 @@ public:
         return new VAData(c, conf);
     }
 
+    // the num most likely classes of an image by decreasing confidence, num <= VA_MAX_TOP_CLASSES
+    static VAData *Create(const int *classes, const float *confs, uint32_t num)
+    {
+        return new VAData(classes, confs, num);
+    }
+
     mfxFrameSurface1 *GetMfxSurface();
 #ifndef MSDK_2_0_API
     mfxFrameAllocator *GetMfxAllocator();
@@ -129,11 +194,14 @@ public:
 
     // use external reference count to maintain the lifecycle
     // so external user can also track whether the VA data used or not.
-    inline void SetExternalRef(int *ref) {m_ref = ref; }
+    // the owner should read it with acquire order (see Ref()) before reusing the buffer
+    inline void SetExternalRef(VARefCount *ref) {m_ref = ref; }
 
-    inline VA_DATA_TYPE Type() {return m_type; }
+    inline VA_DATA_TYPE Type() {return (VA_DATA_TYPE)m_type; }
 
     void SetRef(uint32_t count = 1);
+    // an extra holder of data already referenced, released with DeRef()
+    inline void AddRef(uint32_t count = 1) {m_ref->fetch_add(count, std::memory_order_relaxed); }
     void DeRef(VADataPacket *packet = nullptr, uint32_t count = 1);
 
     void Destroy();
@@ -144,15 +212,48 @@ public:
 
     inline void SetID(uint32_t channel, uint32_t frame) {m_channelIndex = channel; m_frameIndex = frame; }
     inline void SetRoiIndex(uint32_t index) {m_roiIndex = index; }
-    inline void SetConfidence(double confidence) { m_confidence = confidence; };
+    inline void SetConfidence(double confidence)
+    {
+        if (m_type == ROI_REGION)
+            m_roi.confidence = confidence;
+        else if (m_type == IMAGENET_CLASS)
+            m_class.confidence[0] = confidence;
+    }
+    // the track of a ROI_REGION, classify tells whether the region still goes to the classification
+    inline void SetTrack(uint32_t track, bool classify)
+    {
+        if (m_type == ROI_REGION)
+        {
+            m_roi.track = track;
+            m_roi.classify = classify;
+        }
+    }
+    inline uint32_t TrackID() {return m_type == ROI_REGION ? m_roi.track : 0; }
+    inline bool NeedsClassification() {return m_type != ROI_REGION || m_roi.classify; }
+    // position of the packet among the non empty packets the decoder of the channel sent, from 1,
+    // 0 if not stamped. Unlike the frame index it has no gap when only some frames carry data.
+    inline void SetSequence(uint32_t sequence) {m_sequence = sequence; }
+    inline uint32_t Sequence() {return m_sequence; }
     inline uint32_t FrameIndex() {return m_frameIndex; }
     inline uint32_t ChannelIndex() {return m_channelIndex; }
     inline uint32_t RoiIndex() {return m_roiIndex; }
 
-    inline int Ref() {return *m_ref;}
+    inline int Ref() {return m_ref->load(std::memory_order_acquire); }
 
-    inline double Confidence() {return m_confidence; }
-    inline int Class() {return m_class; }
+    // rank 0 is the most likely class, IMAGENET_CLASS can have up to ClassNum() classes
+    inline uint32_t ClassNum() {return m_type == IMAGENET_CLASS ? m_class.num : (m_type == ROI_REGION ? 1 : 0); }
+    inline double Confidence(uint32_t rank = 0)
+    {
+        if (m_type == IMAGENET_CLASS)
+            return rank < m_class.num ? m_class.confidence[rank] : 0.0;
+        return (m_type == ROI_REGION && rank == 0) ? m_roi.confidence : 1.0;
+    }
+    inline int Class(uint32_t rank = 0)
+    {
+        if (m_type == IMAGENET_CLASS)
+            return rank < m_class.num ? m_class.c[rank] : -1;
+        return (m_type == ROI_REGION && rank == 0) ? m_roi.c : -1;
+    }
 
 protected:
     VAData();
@@ -166,48 +267,89 @@ protected:
     VAData(float left, float top, float right, float bottom, int c, float conf);
     VAData(uint8_t *data, uint32_t offset, uint32_t length);
     VAData(int c, float conf);
+    VAData(const int *classes, const float *confs, uint32_t num);
 
     ~VAData();
-    
-    // type
-    VA_DATA_TYPE m_type;
 
-    // data fields for surfaces
-    mfxFrameSurface1 *m_mfxSurface;
+    // VAData objects are allocated from VADataPool
+    static void *operator new(size_t size) {return VADataPool::getInstance().Allocate(size); }
+    static void operator delete(void *p) {VADataPool::getInstance().Free(p); }
+
+    inline bool IsSurface() {return m_type == MFX_SURFACE || m_type == VA_SURFACE || m_type == USER_SURFACE; }
+
+    // payload of MFX_SURFACE, VA_SURFACE and USER_SURFACE
+    struct SurfaceData
+    {
+        uint8_t *data; // user memory, or the mapped mfx surface
+        union
+        {
+            struct
+            {
+                mfxFrameSurface1 *surface;
 #ifndef MSDK_2_0_API
-    mfxFrameAllocator *m_mfxAllocator;
+                mfxFrameAllocator *allocator;
 #endif
-    uint8_t *m_data;
-    uint32_t m_width;
-    uint32_t m_height;
-    uint32_t m_pitch;
-    uint32_t m_fourcc;
-
-    // data fields for Roi Region
-    float m_left;
-    float m_right;
-    float m_top;
-    float m_bottom;
-    int m_class;
-    float m_confidence;
-
-    // data fields for buffer
-    uint32_t m_offset;
-    uint32_t m_length;
-
-    // data fields for VASurface
-    VASurfaceID m_vaSurf;
+            } mfx;
+            VASurfaceID vaSurf;
+        };
+        uint32_t width;
+        uint32_t height;
+        uint32_t pitch;
+        uint32_t fourcc;
+    };
+
+    // payload of ROI_REGION
+    struct RoiData
+    {
+        float left;
+        float top;
+        float right;
+        float bottom;
+        int c;
+        float confidence;
+        // given by the tracker, 0 when the region isn't tracked
+        uint32_t track;
+        // false when the tracker already has the classes of the track
+        bool classify;
+    };
+
+    // payload of IMAGENET_CLASS, no larger than SurfaceData, so the class ids are 16 bits
+    struct ClassData
+    {
+        float confidence[VA_MAX_TOP_CLASSES];
+        int16_t c[VA_MAX_TOP_CLASSES];
+        uint8_t num;
+    };
+
+    // payload of USER_BUFFER
+    struct BufferData
+    {
+        uint8_t *data;
+        uint32_t offset;
+        uint32_t length;
+    };
 
     // reference control
-    int m_internalRef;
-    int *m_ref;
-    std::mutex m_mutex;
+    VARefCount *m_ref;
+    VARefCount m_internalRef;
 
     // ID of the packet
     uint32_t m_channelIndex;
     uint32_t m_frameIndex;
     uint32_t m_roiIndex;
 
+    // VA_DATA_TYPE, selects the member of the payload
+    uint8_t m_type;
+    uint32_t m_sequence;
+
+    union
+    {
+        SurfaceData m_surface;
+        RoiData m_roi;
+        ClassData m_class;
+        BufferData m_buffer;
+    };
+
 private:
     VAData(const VAData &other);
     VAData &operator=(const VAData &other);
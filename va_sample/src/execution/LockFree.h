@@ -0,0 +1,220 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __LOCK_FREE_H__
+#define __LOCK_FREE_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include <atomic>
+#include <vector>
+
+// Bounded multi-producer/multi-consumer ring (D. Vyukov's sequence based queue)
+// Every cell carries a sequence number, so producers and consumers only
+// contend on one CAS of the head or tail and never take a lock.
+template <typename T>
+class VALockFreeRing
+{
+public:
+    explicit VALockFreeRing(uint32_t capacity):
+        m_head(0),
+        m_tail(0)
+    {
+        uint32_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        m_mask = size - 1;
+        m_cells = std::vector<Cell>(size);
+        for (uint32_t i = 0; i < size; i++)
+        {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    VALockFreeRing(const VALockFreeRing&) = delete;
+    VALockFreeRing& operator=(const VALockFreeRing&) = delete;
+
+    bool Push(const T &data)
+    {
+        Cell *cell;
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        while (1)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = data;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T &data)
+    {
+        Cell *cell;
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        while (1)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+        data = cell->data;
+        cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate, only for statistics and load balancing decisions
+    inline uint32_t Size() const
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_relaxed);
+        return (tail > head) ? (uint32_t)(tail - head) : 0;
+    }
+
+    inline uint32_t Capacity() const {return m_mask + 1; }
+
+protected:
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        T data;
+
+        Cell(): seq(0), data() {}
+        Cell(const Cell &other): seq(other.seq.load()), data(other.data) {}
+        Cell &operator=(const Cell &other)
+        {
+            seq.store(other.seq.load());
+            data = other.data;
+            return *this;
+        }
+    };
+
+    // keep head and tail on different cache lines to avoid false sharing
+    char m_pad0[64];
+    std::atomic<size_t> m_head;
+    char m_pad1[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_tail;
+    char m_pad2[64 - sizeof(std::atomic<size_t>)];
+    uint32_t m_mask;
+    std::vector<Cell> m_cells;
+};
+
+// Futex based eventcount, used to block on a lock free structure without polling
+//   waiter:   key = PrepareWait(); if (condition) CancelWait(); else Wait(key);
+//   notifier: make condition true; Notify();
+class VAEventCount
+{
+public:
+    VAEventCount():
+        m_epoch(0),
+        m_waiters(0)
+    {
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(int), "futex word must be 32-bit");
+    }
+
+    VAEventCount(const VAEventCount&) = delete;
+    VAEventCount& operator=(const VAEventCount&) = delete;
+
+    inline uint32_t PrepareWait()
+    {
+        m_waiters.fetch_add(1, std::memory_order_seq_cst);
+        return m_epoch.load(std::memory_order_seq_cst);
+    }
+
+    inline void CancelWait()
+    {
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // abstime is CLOCK_REALTIME based as in pthread_cond_timedwait
+    // return false if timeout
+    bool Wait(uint32_t key, const timespec *abstime = nullptr)
+    {
+        bool timeout = false;
+        if (m_epoch.load(std::memory_order_seq_cst) == key)
+        {
+            long ret;
+            if (abstime)
+            {
+                ret = syscall(SYS_futex, (int *)&m_epoch, FUTEX_WAIT_BITSET_PRIVATE | FUTEX_CLOCK_REALTIME,
+                              (int)key, abstime, nullptr, FUTEX_BITSET_MATCH_ANY);
+            }
+            else
+            {
+                ret = syscall(SYS_futex, (int *)&m_epoch, FUTEX_WAIT_PRIVATE, (int)key, nullptr, nullptr, 0);
+            }
+            timeout = (ret == -1 && errno == ETIMEDOUT);
+        }
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        return !timeout;
+    }
+
+    inline void Notify(bool all = false)
+    {
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_seq_cst) > 0)
+        {
+            syscall(SYS_futex, (int *)&m_epoch, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr, nullptr, 0);
+        }
+    }
+
+protected:
+    std::atomic<uint32_t> m_epoch;
+    std::atomic<uint32_t> m_waiters;
+};
+
+#endif
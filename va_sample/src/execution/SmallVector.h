@@ -0,0 +1,209 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __SMALL_VECTOR_H__
+#define __SMALL_VECTOR_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// Vector of trivially copyable elements with N elements stored inline.
+// It only goes to the heap when more than N elements are pushed, and clear()
+// keeps that buffer, so a container that is reused (like the packets owned
+// by the connectors) stops allocating once it has seen its largest frame.
+template <typename T, uint32_t N>
+class VASmallVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "VASmallVector only holds trivially copyable types");
+
+public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    VASmallVector():
+        m_data(m_inline),
+        m_size(0),
+        m_capacity(N)
+    {
+    }
+
+    VASmallVector(const VASmallVector &other):
+        VASmallVector()
+    {
+        insert(end(), other.begin(), other.end());
+    }
+
+    VASmallVector(VASmallVector &&other):
+        VASmallVector()
+    {
+        swap(other);
+    }
+
+    VASmallVector &operator=(const VASmallVector &other)
+    {
+        if (this != &other)
+        {
+            clear();
+            insert(end(), other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    VASmallVector &operator=(VASmallVector &&other)
+    {
+        if (this != &other)
+        {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~VASmallVector()
+    {
+        if (m_data != m_inline)
+        {
+            ::operator delete(m_data);
+        }
+    }
+
+    inline iterator begin() {return m_data; }
+    inline iterator end() {return m_data + m_size; }
+    inline const_iterator begin() const {return m_data; }
+    inline const_iterator end() const {return m_data + m_size; }
+
+    inline size_t size() const {return m_size; }
+    inline size_t capacity() const {return m_capacity; }
+    inline bool empty() const {return m_size == 0; }
+
+    inline T &front() {return m_data[0]; }
+    inline T &back() {return m_data[m_size - 1]; }
+    inline T &operator[](size_t i) {return m_data[i]; }
+    inline const T &operator[](size_t i) const {return m_data[i]; }
+
+    // keeps the capacity
+    inline void clear() {m_size = 0; }
+
+    inline void push_back(const T &value)
+    {
+        if (m_size == m_capacity)
+        {
+            Grow(m_size + 1);
+        }
+        m_data[m_size++] = value;
+    }
+
+    inline void pop_back() {--m_size; }
+
+    template <typename InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last)
+    {
+        size_t index = pos - m_data;
+        size_t count = 0;
+        for (InputIt ite = first; ite != last; ite++)
+        {
+            count++;
+        }
+        if (m_size + count > m_capacity)
+        {
+            Grow(m_size + count);
+        }
+        T *dst = m_data + index;
+        memmove(dst + count, dst, (m_size - index) * sizeof(T));
+        for (InputIt ite = first; ite != last; ite++)
+        {
+            *dst++ = *ite;
+        }
+        m_size += count;
+        return m_data + index;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        size_t index = pos - m_data;
+        memmove(m_data + index, m_data + index + 1, (m_size - index - 1) * sizeof(T));
+        --m_size;
+        return m_data + index;
+    }
+
+    void swap(VASmallVector &other)
+    {
+        if (m_data != m_inline && other.m_data != other.m_inline)
+        {
+            std::swap(m_data, other.m_data);
+            std::swap(m_capacity, other.m_capacity);
+            std::swap(m_size, other.m_size);
+            return;
+        }
+        // at least one side is inline, go through a temporary
+        VASmallVector *small = (m_data == m_inline) ? this : &other;
+        VASmallVector *large = (small == this) ? &other : this;
+        T temp[N];
+        size_t size = small->m_size;
+        memcpy(temp, small->m_inline, size * sizeof(T));
+        if (large->m_data != large->m_inline)
+        {
+            small->m_data = large->m_data;
+            small->m_capacity = large->m_capacity;
+            small->m_size = large->m_size;
+            large->m_data = large->m_inline;
+            large->m_capacity = N;
+        }
+        else
+        {
+            memcpy(small->m_inline, large->m_inline, large->m_size * sizeof(T));
+            small->m_size = large->m_size;
+        }
+        memcpy(large->m_inline, temp, size * sizeof(T));
+        large->m_size = size;
+    }
+
+protected:
+    void Grow(size_t required)
+    {
+        size_t capacity = m_capacity * 2;
+        while (capacity < required)
+        {
+            capacity *= 2;
+        }
+        T *data = (T *)::operator new(capacity * sizeof(T));
+        memcpy(data, m_data, m_size * sizeof(T));
+        if (m_data != m_inline)
+        {
+            ::operator delete(m_data);
+        }
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+    T *m_data;
+    size_t m_size;
+    size_t m_capacity;
+    T m_inline[N];
+};
+
+#endif
@@ -0,0 +1,306 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TaskScheduler.h"
+#include "ThreadBlock.h"
+#include <unistd.h>
+#include <chrono>
+
+// index of the worker running on this thread, -1 for the other threads
+static thread_local int currentWorker = -1;
+
+static int64_t NowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+VATaskScheduler::VATaskScheduler():
+    m_nextWorker(0),
+    m_queued(0),
+    m_running(false),
+    m_retryDueUs(0)
+{
+}
+
+VATaskScheduler::~VATaskScheduler()
+{
+    Shutdown();
+}
+
+int VATaskScheduler::Start(uint32_t workerNum)
+{
+    if (m_running)
+        return 0;
+
+    if (workerNum == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workerNum = (cpus > 0) ? cpus : 1;
+    }
+
+    m_running = true;
+    for (uint32_t i = 0; i < workerNum; i++)
+    {
+        Worker *worker = new Worker;
+        worker->index = i;
+        m_workers.push_back(worker);
+    }
+    for (uint32_t i = 0; i < workerNum; i++)
+    {
+        int ret = pthread_create(&m_workers[i]->threadId, nullptr, WorkerFunc, (void *)(uintptr_t)i);
+        if (ret)
+        {
+            printf("VATaskScheduler: failed to create worker %d\n", i);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+void VATaskScheduler::Shutdown()
+{
+    if (!m_running)
+        return;
+
+    m_running = false;
+    m_event.Notify(true);
+    for (auto ite = m_workers.begin(); ite != m_workers.end(); ite ++)
+    {
+        pthread_join((*ite)->threadId, nullptr);
+        delete *ite;
+    }
+    m_workers.clear();
+}
+
+void VATaskScheduler::Add(VAThreadBlock *block)
+{
+    block->m_stepState.store(VAThreadBlock::STEP_QUEUED);
+    Push(block, false);
+}
+
+void VATaskScheduler::Wake(VAThreadBlock *block)
+{
+    int state = block->m_stepState.load();
+    while (1)
+    {
+        if (state == VAThreadBlock::STEP_PARKED)
+        {
+            if (block->m_stepState.compare_exchange_weak(state, VAThreadBlock::STEP_QUEUED))
+            {
+                Push(block, false);
+                return;
+            }
+        }
+        else if (state == VAThreadBlock::STEP_RUNNING)
+        {
+            // the worker will run it again instead of parking it
+            if (block->m_stepState.compare_exchange_weak(state, VAThreadBlock::STEP_NOTIFIED))
+                return;
+        }
+        else
+        {
+            // already queued or finished
+            return;
+        }
+    }
+}
+
+void VATaskScheduler::Join(VAThreadBlock *block)
+{
+    std::unique_lock<std::mutex> lock(m_doneMutex);
+    while (block->m_stepState.load() != VAThreadBlock::STEP_DONE)
+    {
+        m_doneCond.wait(lock);
+    }
+}
+
+void VATaskScheduler::Push(VAThreadBlock *block, bool front)
+{
+    if (m_workers.empty())
+        return;
+
+    // a block woken by a worker stays on that worker, its data is still hot in the cache
+    uint32_t index = (currentWorker >= 0) ? currentWorker : (m_nextWorker++ % m_workers.size());
+    Worker *worker = m_workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (front)
+            worker->tasks.push_front(block);
+        else
+            worker->tasks.push_back(block);
+    }
+    m_queued.fetch_add(1);
+    m_event.Notify();
+}
+
+VAThreadBlock *VATaskScheduler::Pop(uint32_t index)
+{
+    VAThreadBlock *block = nullptr;
+    {
+        Worker *worker = m_workers[index];
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (!worker->tasks.empty())
+        {
+            block = worker->tasks.back();
+            worker->tasks.pop_back();
+        }
+    }
+
+    // steal the oldest task of the other workers
+    for (uint32_t i = 1; !block && i < m_workers.size(); i++)
+    {
+        Worker *victim = m_workers[(index + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if (!victim->tasks.empty())
+        {
+            block = victim->tasks.front();
+            victim->tasks.pop_front();
+        }
+    }
+
+    if (block)
+    {
+        m_queued.fetch_sub(1);
+    }
+    return block;
+}
+
+void VATaskScheduler::RunStep(VAThreadBlock *block)
+{
+    block->m_stepState.store(VAThreadBlock::STEP_RUNNING);
+
+    int ret = block->m_stop ? VA_STEP_DONE : block->Step();
+    // any other value is an error of the block, it stops like Loop() would
+    if (block->m_stop || (ret != VA_STEP_PROGRESS && ret != VA_STEP_IDLE && ret != VA_STEP_RETRY))
+    {
+        block->Finish();
+        {
+            std::lock_guard<std::mutex> lock(m_doneMutex);
+            block->m_stepState.store(VAThreadBlock::STEP_DONE);
+        }
+        m_doneCond.notify_all();
+        return;
+    }
+
+    if (ret == VA_STEP_PROGRESS)
+    {
+        // let the other queued blocks go first
+        block->m_stepState.store(VAThreadBlock::STEP_QUEUED);
+        Push(block, true);
+        return;
+    }
+
+    int state = VAThreadBlock::STEP_RUNNING;
+    if (!block->m_stepState.compare_exchange_strong(state, VAThreadBlock::STEP_PARKED))
+    {
+        // woken up while running the step, there may be new data
+        block->m_stepState.store(VAThreadBlock::STEP_QUEUED);
+        Push(block, true);
+        return;
+    }
+
+    if (ret == VA_STEP_RETRY)
+    {
+        std::lock_guard<std::mutex> lock(m_retryMutex);
+        if (m_retries.empty())
+            m_retryDueUs.store(NowUs() + RETRY_PERIOD_US);
+        m_retries.push_back(block);
+    }
+}
+
+bool VATaskScheduler::RetriesDue()
+{
+    int64_t due = m_retryDueUs.load(std::memory_order_relaxed);
+    return due != 0 && NowUs() >= due;
+}
+
+void VATaskScheduler::WakeRetries()
+{
+    std::vector<VAThreadBlock *> retries;
+    {
+        std::lock_guard<std::mutex> lock(m_retryMutex);
+        retries.swap(m_retries);
+        m_retryDueUs.store(0);
+    }
+    for (auto ite = retries.begin(); ite != retries.end(); ite ++)
+    {
+        Wake(*ite);
+    }
+}
+
+void *VATaskScheduler::WorkerFunc(void *arg)
+{
+    VATaskScheduler::getInstance().WorkerLoop((uint32_t)(uintptr_t)arg);
+    return (void *)0;
+}
+
+void VATaskScheduler::WorkerLoop(uint32_t index)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "va-worker%d", index);
+    pthread_setname_np(pthread_self(), name);
+
+    currentWorker = index;
+    while (m_running)
+    {
+        VAThreadBlock *block = Pop(index);
+        if (block)
+        {
+            RunStep(block);
+            if (RetriesDue())
+                WakeRetries();
+            continue;
+        }
+
+        uint32_t key = m_event.PrepareWait();
+        if (m_queued.load() > 0 || !m_running)
+        {
+            m_event.CancelWait();
+            continue;
+        }
+
+        bool hasRetries;
+        {
+            std::lock_guard<std::mutex> lock(m_retryMutex);
+            hasRetries = !m_retries.empty();
+        }
+        if (!hasRetries)
+        {
+            m_event.Wait(key);
+            continue;
+        }
+
+        timespec abstime;
+        clock_gettime(CLOCK_REALTIME, &abstime);
+        abstime.tv_nsec += RETRY_PERIOD_US * 1000;
+        if (abstime.tv_nsec >= 1000000000)
+        {
+            abstime.tv_sec += 1;
+            abstime.tv_nsec -= 1000000000;
+        }
+        if (!m_event.Wait(key, &abstime))
+        {
+            WakeRetries();
+        }
+    }
+    currentWorker = -1;
+}
@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef __TASK_SCHEDULER_H__
+#define __TASK_SCHEDULER_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "LockFree.h"
+
+class VAThreadBlock;
+
+// Work stealing pool running the Step() of the blocks
+// Every worker owns a deque of runnable blocks, it pops from the back of its
+// own deque and steals from the front of the others when it runs dry.
+// A block whose step finds no input (or no free output) is parked, and the
+// connectors wake it up through VAThreadBlock::OnConnectorEvent.
+class VATaskScheduler
+{
+public:
+    static VATaskScheduler& getInstance()
+    {
+        static VATaskScheduler instance;
+        return instance;
+    }
+    ~VATaskScheduler();
+
+    VATaskScheduler(const VATaskScheduler&) = delete;
+    VATaskScheduler& operator=(const VATaskScheduler&) = delete;
+
+    // workerNum 0 means one worker per online cpu
+    int Start(uint32_t workerNum = 0);
+    void Shutdown();
+
+    void Add(VAThreadBlock *block);
+    void Wake(VAThreadBlock *block);
+    // wait until the block has run its last step
+    void Join(VAThreadBlock *block);
+
+    inline uint32_t WorkerNum() {return m_workers.size(); }
+
+    // parked blocks that wait for a resource that is not a connector are polled with this period
+    static const uint32_t RETRY_PERIOD_US = 1000;
+
+private:
+    VATaskScheduler();
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<VAThreadBlock *> tasks;
+        pthread_t threadId;
+        uint32_t index;
+    };
+
+    static void *WorkerFunc(void *arg);
+    void WorkerLoop(uint32_t index);
+    VAThreadBlock *Pop(uint32_t index);
+    void Push(VAThreadBlock *block, bool front);
+    void RunStep(VAThreadBlock *block);
+    void WakeRetries();
+    // true once the oldest parked retry waited RETRY_PERIOD_US, checked between the steps so the
+    // retries also run when the workers are never idle
+    bool RetriesDue();
+
+    std::vector<Worker *> m_workers;
+    std::atomic<uint32_t> m_nextWorker;
+    std::atomic<uint32_t> m_queued;
+    std::atomic<bool> m_running;
+    VAEventCount m_event;
+
+    std::mutex m_retryMutex;
+    std::vector<VAThreadBlock *> m_retries;
+    // steady clock time in us the retries are due, 0 without retries
+    std::atomic<int64_t> m_retryDueUs;
+
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneCond;
+};
+
+#endif
@@ -21,13 +21,22 @@
 */
 
 #include "ThreadBlock.h"
+#include "TaskScheduler.h"
 #include <unistd.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
 
 std::vector<VAThreadBlock *> VAThreadBlock::m_allThreads;
+VA_EXEC_MODE VAThreadBlock::m_execMode = VA_EXEC_THREAD;
+uint32_t VAThreadBlock::m_workerNum = 0;
 
-static void *VAThreadFunc(void *arg)
+void *VAThreadFunc(void *arg)
 {
     VAThreadBlock *block = static_cast<VAThreadBlock *>(arg);
+    block->ApplyPlacement();
     block->Loop();
     block->Finish();
     return (void *)0;
@@ -36,8 +45,14 @@ static void *VAThreadFunc(void *arg)
 VAThreadBlock::VAThreadBlock():
     m_inputPin(nullptr),
     m_outputPin(nullptr),
+    m_threadStarted(false),
     m_stop(false),
-    m_finish(false)
+    m_finish(false),
+    m_pooled(false),
+    m_stepState(STEP_PARKED),
+    m_numaNode(-1),
+    m_schedPolicy(-1),
+    m_schedPriority(-1)
 {    
 }
 
@@ -48,32 +63,253 @@ VAThreadBlock::~VAThreadBlock()
 int VAThreadBlock::Prepare()
 {
     m_allThreads.push_back(this);
-    return PrepareInternal();
+    if (m_numaNode >= 0 && m_cpus.empty())
+    {
+        GetNodeCpus(m_numaNode, m_cpus);
+    }
+
+    // the buffers allocated and touched by PrepareInternal come from the node of the block
+    if (m_numaNode >= 0)
+        SetMemPolicy(m_numaNode);
+    int ret = PrepareInternal();
+    if (m_numaNode >= 0)
+        SetMemPolicy(-1);
+    return ret;
 }
 
 int VAThreadBlock::Run()
 {
-    return pthread_create(&m_threadId, nullptr, VAThreadFunc, (void *)this);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+
+    if (!m_cpus.empty())
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (auto ite = m_cpus.begin(); ite != m_cpus.end(); ite ++)
+        {
+            CPU_SET(*ite, &cpuset);
+        }
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+
+    if (m_schedPolicy >= 0)
+    {
+        sched_param param = {};
+        // the real time policies have no priority 0
+        param.sched_priority = (m_schedPriority >= 0) ? m_schedPriority : sched_get_priority_min(m_schedPolicy);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, m_schedPolicy);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    int ret = pthread_create(&m_threadId, &attr, VAThreadFunc, (void *)this);
+    if (ret == EPERM && m_schedPolicy >= 0)
+    {
+        // real time policies need CAP_SYS_NICE, run with the default one instead of failing
+        printf("VAThreadBlock: no permission for sched policy %d of %s, using the default one\n", m_schedPolicy, m_name.c_str());
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        ret = pthread_create(&m_threadId, &attr, VAThreadFunc, (void *)this);
+    }
+    if (ret)
+    {
+        printf("VAThreadBlock: failed to create the thread of %s, error %d\n", m_name.c_str(), ret);
+    }
+    m_threadStarted = (ret == 0);
+    pthread_attr_destroy(&attr);
+    return ret;
+}
+
+void VAThreadBlock::ApplyPlacement()
+{
+    if (!m_name.empty())
+    {
+        // the kernel limits thread names to 16 bytes including the terminator
+        std::string name = m_name.substr(0, 15);
+        pthread_setname_np(pthread_self(), name.c_str());
+    }
+    if (m_numaNode >= 0)
+    {
+        SetMemPolicy(m_numaNode);
+    }
+}
+
+int VAThreadBlock::SetMemPolicy(int node)
+{
+    if (node < 0)
+    {
+        return syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+    }
+    const int bits = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask(node / bits + 1, 0);
+    mask[node / bits] |= 1UL << (node % bits);
+    // MPOL_PREFERRED falls back to the other nodes instead of failing the allocation
+    long ret = syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(), mask.size() * bits + 1);
+    if (ret)
+    {
+        printf("VAThreadBlock: failed to prefer numa node %d\n", node);
+    }
+    return ret;
+}
+
+int VAThreadBlock::ParseCpuList(const char *list, std::vector<int> &cpus)
+{
+    const char *p = list;
+    while (*p)
+    {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0)
+            return -1;
+        long last = first;
+        p = end;
+        if (*p == '-')
+        {
+            ++ p;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first)
+                return -1;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+        if (*p == ',')
+            ++ p;
+        else if (*p && *p != '\n')
+            return -1;
+        else
+            break;
+    }
+    return 0;
+}
+
+int VAThreadBlock::ParseSchedPolicy(const std::string &sched, int *policy, int *priority)
+{
+    std::string name = sched;
+    *priority = -1;
+    size_t colon = name.find(':');
+    if (colon != std::string::npos)
+    {
+        char *end;
+        const char *value = name.c_str() + colon + 1;
+        *priority = strtol(value, &end, 10);
+        if (end == value || *end)
+            return -1;
+        name = name.substr(0, colon);
+    }
+    if (name == "other")
+        *policy = SCHED_OTHER;
+    else if (name == "fifo")
+        *policy = SCHED_FIFO;
+    else if (name == "rr")
+        *policy = SCHED_RR;
+    else
+        return -1;
+    if (colon != std::string::npos
+        && (*priority < sched_get_priority_min(*policy) || *priority > sched_get_priority_max(*policy)))
+        return -1;
+    return 0;
+}
+
+int VAThreadBlock::GetNodeCpus(int node, std::vector<int> &cpus)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        printf("VAThreadBlock: numa node %d not found\n", node);
+        return -1;
+    }
+    char list[1024] = {};
+    int ret = -1;
+    if (fgets(list, sizeof(list), fp))
+    {
+        ret = ParseCpuList(list, cpus);
+    }
+    fclose(fp);
+    return ret;
 }
 
 void VAThreadBlock::Stop()
 {
     m_stop = true;
     DisconnectPin();
+    if (m_pooled)
+    {
+        VATaskScheduler::getInstance().Wake(this);
+    }
 }
 
 void VAThreadBlock::Join()
 {
-    pthread_join(m_threadId, nullptr);
+    if (m_pooled)
+    {
+        VATaskScheduler::getInstance().Join(this);
+        return;
+    }
+    if (m_threadStarted)
+    {
+        pthread_join(m_threadId, nullptr);
+        m_threadStarted = false;
+    }
+}
+
+void VAThreadBlock::OnConnectorEvent()
+{
+    VATaskScheduler::getInstance().Wake(this);
+}
+
+int VAThreadBlock::LoopSteps()
+{
+    while (!m_stop)
+    {
+        int ret = Step();
+        if (ret == VA_STEP_RETRY)
+            usleep(VATaskScheduler::RETRY_PERIOD_US);
+        else if (ret != VA_STEP_PROGRESS && ret != VA_STEP_IDLE)
+            break;
+    }
+    return 0;
+}
+
+void VAThreadBlock::SetExecutionMode(VA_EXEC_MODE mode, uint32_t workerNum)
+{
+    m_execMode = mode;
+    m_workerNum = workerNum;
 }
 
-void VAThreadBlock::RunAllThreads()
+int VAThreadBlock::RunAllThreads()
 {
+    if (m_execMode == VA_EXEC_POOL)
+    {
+        // the listeners must be in place before any data flows
+        for (auto ite = m_allThreads.begin(); ite != m_allThreads.end(); ite ++)
+        {
+            VAThreadBlock *t = *ite;
+            if (!t->CanStep())
+                continue;
+            t->m_pooled = true;
+            if (t->m_inputPin && t->m_inputPin->Connector())
+                t->m_inputPin->Connector()->AddListener(t);
+            if (t->m_outputPin && t->m_outputPin->Connector())
+                t->m_outputPin->Connector()->AddListener(t);
+        }
+        VATaskScheduler::getInstance().Start(m_workerNum);
+    }
+
+    int ret = 0;
     for (auto ite = m_allThreads.begin(); ite != m_allThreads.end(); ite ++)
     {
         VAThreadBlock *t = *ite;
-        t->Run();
+        if (t->m_pooled)
+            VATaskScheduler::getInstance().Add(t);
+        else if (t->Run())
+            ret = -1;
     }
+    return ret;
 }
 
 void VAThreadBlock::StopAllThreads()
@@ -89,5 +325,7 @@ void VAThreadBlock::StopAllThreads()
         VAThreadBlock *t = *ite;
         t->Join();
     }
+
+    VATaskScheduler::getInstance().Shutdown();
 }
 
@@ -25,6 +25,8 @@
 #include <stdint.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <atomic>
+#include <string>
 #include <vector>
 
 #include "DataPacket.h"
@@ -36,13 +38,34 @@
         return -1;                                                            \
     }
 
-class VAThreadBlock
+enum VA_EXEC_MODE
 {
+    VA_EXEC_THREAD,     // one thread per block running Loop()
+    VA_EXEC_POOL        // Step() of the blocks scheduled on VATaskScheduler
+};
+
+// return values of VAThreadBlock::Step(), any other value ends the block like an error of Loop()
+enum VA_STEP_STATUS
+{
+    VA_STEP_PROGRESS,   // did some work, can be run again right away
+    VA_STEP_IDLE,       // no input or no free output packet, wait for the connectors
+    VA_STEP_RETRY,      // waits for some other resource, poll again later
+    VA_STEP_DONE        // the block has finished
+};
+
+class VAThreadBlock : public VAConnectorListener
+{
+friend class VATaskScheduler;
+friend void *VAThreadFunc(void *arg);
 public:
     VAThreadBlock();
     virtual ~VAThreadBlock();
 
-    static void RunAllThreads();
+    // workerNum is only used by VA_EXEC_POOL, 0 means one worker per cpu
+    static void SetExecutionMode(VA_EXEC_MODE mode, uint32_t workerNum = 0);
+
+    // returns -1 if a block couldn't be started, the others run and StopAllThreads() must still be called
+    static int RunAllThreads();
 
     static void StopAllThreads();
 
@@ -52,18 +75,68 @@ public:
     virtual int Prepare();
     virtual int Loop() = 0;
 
+    // Blocks that can be resumed override CanStep() and Step().
+    // Step() processes at most one packet, or one batch of them, and never blocks on the connectors,
+    // whatever it can't finish is kept in the block for the next call.
+    // In VA_EXEC_POOL mode the other blocks, like the decoders waiting on the media SDK, still get a
+    // thread running Loop().
+    virtual bool CanStep() {return false; }
+    virtual int Step() {return VA_STEP_DONE; }
+
+    void OnConnectorEvent() override;
+
+    // Placement of the block thread, must be set before Prepare()
+    // the blocks run by the pool of VA_EXEC_POOL have no thread of their own, only the numa node applies
+    // cpus: cpus the thread may run on, all cpus of the numa node when empty and a node is set
+    // numaNode: the buffers allocated in Prepare() and by the thread come from this node, -1 for no preference
+    // policy/priority: SCHED_OTHER, SCHED_FIFO, SCHED_RR... as in sched_setscheduler(), policy -1 keeps the default,
+    //                  priority -1 is the lowest one of the policy
+    // name: shown by top/perf, truncated to 15 characters
+    inline void SetCpus(const std::vector<int> &cpus) {m_cpus = cpus; }
+    inline void SetNumaNode(int node) {m_numaNode = node; }
+    inline void SetSchedPolicy(int policy, int priority = -1) {m_schedPolicy = policy; m_schedPriority = priority; }
+    inline void SetName(const char *name) {m_name = name; }
+    inline const char *Name() {return m_name.c_str(); }
+
+    // parse a cpu list like "0-3,8,10-11", return -1 on syntax error
+    static int ParseCpuList(const char *list, std::vector<int> &cpus);
+    // parse "other|fifo|rr[:priority]", the priority is left to -1 when not given, return -1 on an
+    // unknown policy or a priority out of the range of the policy
+    static int ParseSchedPolicy(const std::string &sched, int *policy, int *priority);
+    // cpus of a numa node, read from sysfs
+    static int GetNodeCpus(int node, std::vector<int> &cpus);
+
     inline void ConnectInput(VAConnectorPin *pin) {m_inputPin = pin; }
     inline void ConnectOutput(VAConnectorPin *pin) {m_outputPin = pin; }
 
     inline void Finish() {m_finish = true; }
 
 protected:
+    // scheduling state of a pooled block
+    enum
+    {
+        STEP_PARKED,
+        STEP_QUEUED,
+        STEP_RUNNING,
+        STEP_NOTIFIED,  // woken up while running
+        STEP_DONE
+    };
+
+    // runs Step() until the block is stopped, for the blocks that implement Loop() with it
+    int LoopSteps();
+
+    // applies the name, cpus and memory policy to the calling thread
+    void ApplyPlacement();
+    // sets the memory policy of the calling thread to prefer the node, -1 restores the default policy
+    static int SetMemPolicy(int node);
+
+    // in pooled mode these return nullptr instead of waiting
     VADataPacket* AcquireInput()
     {
         if (!m_inputPin)
             return nullptr;
 
-        VADataPacket* packet = m_inputPin->Get();
+        VADataPacket* packet = m_pooled ? m_inputPin->TryGet() : m_inputPin->Get();
         return packet;
     }
     
@@ -81,7 +154,7 @@ protected:
         if (!m_outputPin)
             return nullptr;
 
-        VADataPacket *packet = m_outputPin->Get();
+        VADataPacket *packet = m_pooled ? m_outputPin->TryGet() : m_outputPin->Get();
         if (!packet || !packet->empty())
             return nullptr;
 
@@ -96,6 +169,50 @@ protected:
         m_outputPin->Store(data);
     }
 
+    // takes up to maxNum input packets with one connector round trip, waits
+    // for the first one unless the block runs on the pool
+    uint32_t AcquireInputs(std::vector<VADataPacket *> &packets, uint32_t maxNum, bool wait = true)
+    {
+        packets.clear();
+        if (!m_inputPin)
+            return 0;
+
+        return m_inputPin->GetBatch(packets, maxNum, wait && !m_pooled);
+    }
+
+    void ReleaseInputs(std::vector<VADataPacket *> &packets)
+    {
+        if (!m_inputPin)
+            return;
+
+        for (auto ite = packets.begin(); ite != packets.end(); ite ++)
+        {
+            (*ite)->clear();
+        }
+        m_inputPin->StoreBatch(packets);
+        packets.clear();
+    }
+
+    // takes up to maxNum output packets with one connector round trip, waits
+    // for the first one unless the block runs on the pool
+    uint32_t DequeueOutputs(std::vector<VADataPacket *> &packets, uint32_t maxNum)
+    {
+        packets.clear();
+        if (!m_outputPin)
+            return 0;
+
+        return m_outputPin->GetBatch(packets, maxNum, !m_pooled);
+    }
+
+    void EnqueueOutputs(std::vector<VADataPacket *> &packets)
+    {
+        if (!m_outputPin)
+            return;
+
+        m_outputPin->StoreBatch(packets);
+        packets.clear();
+    }
+
     void DisconnectPin()
     {
         if (m_inputPin)
@@ -117,11 +234,23 @@ protected:
     VAConnectorPin *m_outputPin;
 
     pthread_t m_threadId;
+    bool m_threadStarted;
 
     static std::vector<VAThreadBlock *> m_allThreads;
+    static VA_EXEC_MODE m_execMode;
+    static uint32_t m_workerNum;
 
     bool m_stop;
     bool m_finish;
+
+    bool m_pooled;
+    std::atomic<int> m_stepState;
+
+    std::vector<int> m_cpus;
+    int m_numaNode;
+    int m_schedPolicy;
+    int m_schedPriority;
+    std::string m_name;
 };
 
 #endif
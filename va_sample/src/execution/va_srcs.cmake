@@ -25,8 +25,11 @@ set(VA_SOURCES
     ${CMAKE_CURRENT_LIST_DIR}/DataPacket.cpp
     ${CMAKE_CURRENT_LIST_DIR}/Connector.cpp
     ${CMAKE_CURRENT_LIST_DIR}/ConnectorRR.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/ConnectorLockFree.cpp
     ${CMAKE_CURRENT_LIST_DIR}/ConnectorDispatch.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/ConnectorReorder.cpp
     ${CMAKE_CURRENT_LIST_DIR}/ThreadBlock.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/TaskScheduler.cpp
     )
 
 include_directories(${CMAKE_CURRENT_LIST_DIR})
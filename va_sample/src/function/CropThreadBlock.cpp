@@ -23,6 +23,7 @@
 #include "CropThreadBlock.h"
 #include "common.h"
 #include "logs.h"
+#include "ImageKernels.h"
 
 extern VADisplay m_va_dpy;
 
@@ -46,7 +47,12 @@ CropThreadBlock::CropThreadBlock(uint32_t index):
     m_vaSyncFlag(false),
     m_vpMemOutTypeVideo(false),
     m_keepAspectRatio(false),
-    m_pipeflag(0)
+    m_pipeflag(0),
+    m_stepOutput(nullptr),
+    m_stepDecodeOutput(nullptr),
+    m_stepRoiIndex(0),
+    m_stepWidth(0),
+    m_stepHeight(0)
 {
     TRACE("");
 
@@ -72,7 +78,7 @@ CropThreadBlock::~CropThreadBlock()
         {
             if (m_outBuffers[i])
             {
-                delete[] m_outBuffers[i];
+                free(m_outBuffers[i]);
                 m_outBuffers[i] = nullptr;
             }
         }
@@ -103,7 +109,8 @@ int CropThreadBlock::PrepareInternal()
 
     m_outputVASurfs.resize(m_bufferNum);
     m_outBuffers.resize(m_bufferNum);
-    m_outRefs.resize(m_bufferNum);
+    std::vector<VARefCount> refs(m_bufferNum);
+    m_outRefs.swap(refs);
     for (int i = 0; i < m_outputVASurfs.size(); i++)
     {
         m_outputVASurfs[i] = VA_INVALID_ID;
@@ -170,7 +177,13 @@ int CropThreadBlock::PrepareInternal()
     
     for (int i = 0; i < m_outBuffers.size(); i++)
     {
-        m_outBuffers[i] = new uint8_t[m_vpOutWidth * m_vpOutHeight * 3];
+        void *buffer = nullptr;
+        if (posix_memalign(&buffer, VA_SURFACE_ALIGNMENT, m_vpOutWidth * m_vpOutHeight * 3))
+        {
+            ERRLOG("failed to allocate the crop output buffers");
+            return -1;
+        }
+        m_outBuffers[i] = (uint8_t *)buffer;
     }
 
     return 0;
@@ -181,7 +194,7 @@ int CropThreadBlock::FindFreeOutput()
     TRACE("");
     for (int i = 0; i < m_outRefs.size(); i ++)
     {
-        if (m_outRefs[i] <= 0)
+        if (m_outRefs[i].load(std::memory_order_acquire) <= 0)
         {
             return i;
         }
@@ -192,21 +205,33 @@ int CropThreadBlock::FindFreeOutput()
 
 int CropThreadBlock::Loop()
 {
-    // dump the cropping output for test
+    return LoopSteps();
+}
+
+int CropThreadBlock::Step()
+{
     TRACE("");
-    while(!m_stop)
+    if (!m_stepOutput)
+    {
+        m_stepOutput = DequeueOutput();
+        if (!m_stepOutput)
+            return m_pooled ? VA_STEP_IDLE : VA_STEP_DONE;
+    }
+
+    // start a new frame unless the previous step left some rois to crop
+    if (!m_stepDecodeOutput)
     {
         VADataPacket *input = AcquireInput();
-        VADataPacket *output = DequeueOutput();
         VAData *decodeOutput = nullptr;
-        std::vector<VAData *> rois;
 
-        if (!input || !output)
-            break;
+        if (!input)
+            return m_pooled ? VA_STEP_IDLE : VA_STEP_DONE;
 
         if (input->size() == 0)
-            break;
+            return VA_STEP_DONE;
 
+        m_stepRois.clear();
+        m_stepRoiIndex = 0;
         for (auto ite = input->begin(); ite != input->end(); ite++)
         {
             VAData *data = *ite;
@@ -214,13 +239,18 @@ int CropThreadBlock::Loop()
             {
                 decodeOutput = data;
             }
+            else if (IsRoiRegion(data) && !data->NeedsClassification())
+            {
+                // the tracker attached the classes of the region, no need to crop it
+                data->DeRef(m_stepOutput);
+            }
             else if (IsRoiRegion(data))
             {
-                rois.push_back(data);
+                m_stepRois.push_back(data);
             }
             else
             {
-                output->push_back(data);
+                m_stepOutput->push_back(data);
             }
         }
 
@@ -238,145 +268,143 @@ int CropThreadBlock::Loop()
         }
 
         if (!decodeOutput || decodeWidth == 0 || decodeHeight == 0)
-            continue;
-
-        //printf("in Crop, %d rois\n", rois.size());
-        for (int i = 0; i < rois.size(); i++)
         {
-            VAData *roi = rois[i];
-            float l, r, t, b;
-            roi->GetRoiRegion(&l, &t, &r, &b);
+            // drop the frame, the output packet is kept for the next one
+            m_stepOutput->clear();
+            return VA_STEP_PROGRESS;
+        }
 
-            int index = -1;
-            while (index == -1)
-            {
-                if (m_stop)
-                    goto exit;
+        m_stepDecodeOutput = decodeOutput;
+        m_stepWidth = decodeWidth;
+        m_stepHeight = decodeHeight;
+    }
 
-                index = FindFreeOutput();
-                if (index == -1)
-                    usleep(10000);
-            }
+    VAData *decodeOutput = m_stepDecodeOutput;
+    VADataPacket *output = m_stepOutput;
+    uint32_t decodeWidth = m_stepWidth;
+    uint32_t decodeHeight = m_stepHeight;
 
-            mfxFrameSurface1 *mfxSurf = decodeOutput->GetMfxSurface();
-            if (!mfxSurf)
-            {
-                ERRLOG("Fail to get MSDK surface!\n");
-                break;
-            }
-            VASurfaceID inputSurf;
+    //printf("in Crop, %d rois\n", m_stepRois.size());
+    for (; m_stepRoiIndex < m_stepRois.size(); m_stepRoiIndex++)
+    {
+        VAData *roi = m_stepRois[m_stepRoiIndex];
+        float l, r, t, b;
+        roi->GetRoiRegion(&l, &t, &r, &b);
+
+        int index = FindFreeOutput();
+        if (index == -1)
+        {
+            // all the output buffers are still used by the next blocks
+            return VA_STEP_RETRY;
+        }
+
+        mfxFrameSurface1 *mfxSurf = decodeOutput->GetMfxSurface();
+        if (!mfxSurf)
+        {
+            ERRLOG("Fail to get MSDK surface!\n");
+            break;
+        }
+        VASurfaceID inputSurf;
 #ifndef MSDK_2_0_API
-            mfxFrameAllocator *alloc = decodeOutput->GetMfxAllocator();
-            if (!alloc)
-            {
-                ERRLOG("Fail to get MSDK allocator!\n");
-                break;
-            }
-            // Get Input VASurface
-            mfxHDL handle;
-            alloc->GetHDL(alloc->pthis, mfxSurf->Data.MemId, &(handle));
-            inputSurf = *(VASurfaceID *)handle;
+        mfxFrameAllocator *alloc = decodeOutput->GetMfxAllocator();
+        if (!alloc)
+        {
+            ERRLOG("Fail to get MSDK allocator!\n");
+            break;
+        }
+        // Get Input VASurface
+        mfxHDL handle;
+        alloc->GetHDL(alloc->pthis, mfxSurf->Data.MemId, &(handle));
+        inputSurf = *(VASurfaceID *)handle;
 #else
-            mfxHDL handle;
-            mfxResourceType type;
-            mfxSurf->FrameInterface->GetNativeHandle(mfxSurf, &handle, &type);
-            inputSurf = (VASurfaceID)(uint64_t)handle;
+        mfxHDL handle;
+        mfxResourceType type;
+        mfxSurf->FrameInterface->GetNativeHandle(mfxSurf, &handle, &type);
+        inputSurf = (VASurfaceID)(uint64_t)handle;
 #endif
+        
+        Crop(inputSurf,
+             m_outputVASurfs[index],
+             (uint32_t)(l * decodeWidth),
+             (uint32_t)(t * decodeHeight),
+             (uint32_t)((r - l) * decodeWidth),
+             (uint32_t)((b - t) * decodeHeight),
+              m_keepAspectRatio);
+
+        VAData *cropOut = nullptr;
+        if (!m_vpMemOutTypeVideo || m_dumpFlag)
+        {
+            // copy to system memory if needed
+            VAImage surface_image;
+            void *surface_p = nullptr;
+            VAStatus va_status = vaDeriveImage(m_va_dpy, m_outputVASurfs[index], &surface_image);
+            CHECK_VASTATUS(va_status, "vaDeriveImage");
+            va_status = vaMapBuffer(m_va_dpy, surface_image.buf, &surface_p);
+            CHECK_VASTATUS(va_status, "vaMapBuffer");
             
-            Crop(inputSurf,
-                 m_outputVASurfs[index],
-                 (uint32_t)(l * decodeWidth),
-                 (uint32_t)(t * decodeHeight),
-                 (uint32_t)((r - l) * decodeWidth),
-                 (uint32_t)((b - t) * decodeHeight),
-                  m_keepAspectRatio);
-
-            VAData *cropOut = nullptr;
-            if (!m_vpMemOutTypeVideo || m_dumpFlag)
-            {
-                // copy to system memory if needed
-                VAImage surface_image;
-                void *surface_p = nullptr;
-                VAStatus va_status = vaDeriveImage(m_va_dpy, m_outputVASurfs[index], &surface_image);
-                CHECK_VASTATUS(va_status, "vaDeriveImage");
-                va_status = vaMapBuffer(m_va_dpy, surface_image.buf, &surface_p);
-                CHECK_VASTATUS(va_status, "vaMapBuffer");
-                
-                uint8_t *y_dst = m_outBuffers[index];
-                uint8_t *y_src = (uint8_t *)surface_p;
-
-                if (m_vpOutFormat == MFX_FOURCC_NV12)
-                {
-                    y_src = (uint8_t *)surface_p + surface_image.offsets[0];
-                    for (int row = 0; row < surface_image.height; row++)
-                    {
-                        memcpy(y_dst, y_src, surface_image.width);
-                        y_src += surface_image.pitches[0];
-                        y_dst += surface_image.width;
-                    }
-                    y_src = (uint8_t *)surface_p + surface_image.offsets[1];
-                    for (int row = 0; row < surface_image.height/2; row++)
-                    {
-                        memcpy(y_dst, y_src, surface_image.width);
-                        y_src += surface_image.pitches[1];
-                        y_dst += surface_image.width;
-                    }
-                }
-                else
-                {
-                    for (int i = surface_image.num_planes - 1 ; i >= 0; i --)
-                    {
-                        y_src = (uint8_t *)surface_p + surface_image.offsets[i];
-                        for (int row = 0; row < surface_image.height; row++)
-                        {
-                            memcpy(y_dst, y_src, surface_image.width);
-                            y_src += surface_image.pitches[i];
-                            y_dst += surface_image.width;
-                        }
-                    }
-                }
-                
-                vaUnmapBuffer(m_va_dpy, surface_image.buf);
-                vaDestroyImage(m_va_dpy, surface_image.image_id);
-            }
-            if (m_vpMemOutTypeVideo)
+            uint8_t *y_dst = m_outBuffers[index];
+            uint8_t *y_src = (uint8_t *)surface_p;
+
+            uint32_t planeSize = surface_image.width * surface_image.height;
+            if (m_vpOutFormat == MFX_FOURCC_NV12)
             {
-                cropOut = VAData::Create(m_outputVASurfs[index], m_vpOutWidth, m_vpOutHeight, m_vpOutWidth, m_vpOutFormat);
+                y_src = (uint8_t *)surface_p + surface_image.offsets[0];
+                VACopyPlane(y_dst, surface_image.width, y_src, surface_image.pitches[0], surface_image.width, surface_image.height);
+                y_src = (uint8_t *)surface_p + surface_image.offsets[1];
+                VACopyPlane(y_dst + planeSize, surface_image.width, y_src, surface_image.pitches[1], surface_image.width, surface_image.height/2);
             }
             else
             {
-                cropOut = VAData::Create(m_outBuffers[index], m_vpOutWidth, m_vpOutHeight, m_vpOutWidth, m_vpOutFormat);
+                for (int i = surface_image.num_planes - 1 ; i >= 0; i --)
+                {
+                    y_src = (uint8_t *)surface_p + surface_image.offsets[i];
+                    VACopyPlane(y_dst, surface_image.width, y_src, surface_image.pitches[i], surface_image.width, surface_image.height);
+                    y_dst += planeSize;
+                }
             }
-            if (cropOut)
+            
+            vaUnmapBuffer(m_va_dpy, surface_image.buf);
+            vaDestroyImage(m_va_dpy, surface_image.image_id);
+        }
+        if (m_vpMemOutTypeVideo)
+        {
+            cropOut = VAData::Create(m_outputVASurfs[index], m_vpOutWidth, m_vpOutHeight, m_vpOutWidth, m_vpOutFormat);
+        }
+        else
+        {
+            cropOut = VAData::Create(m_outBuffers[index], m_vpOutWidth, m_vpOutHeight, m_vpOutWidth, m_vpOutFormat);
+        }
+        if (cropOut)
+        {
+            cropOut->SetID(roi->ChannelIndex(), roi->FrameIndex());
+            cropOut->SetRoiIndex(roi->RoiIndex());
+            cropOut->SetExternalRef(&m_outRefs[index]);
+            cropOut->SetRef(1);
+            roi->DeRef(output);
+            output->push_back(cropOut);
+        }
+
+        if (m_dumpFlag)
+        {
+            FILE *fp = GetDumpFile(roi->ChannelIndex());
+            if (m_vpOutFormat == MFX_FOURCC_NV12)
             {
-                cropOut->SetID(roi->ChannelIndex(), roi->FrameIndex());
-                cropOut->SetRoiIndex(roi->RoiIndex());
-                cropOut->SetExternalRef(&m_outRefs[index]);
-                cropOut->SetRef(1);
-                roi->DeRef(output);
-                output->push_back(cropOut);
+                fwrite(m_outBuffers[index], 1, m_vpOutWidth*m_vpOutHeight*3/2, fp);
             }
-
-            if (m_dumpFlag)
+            else
             {
-                FILE *fp = GetDumpFile(roi->ChannelIndex());
-                if (m_vpOutFormat == MFX_FOURCC_NV12)
-                {
-                    fwrite(m_outBuffers[index], 1, m_vpOutWidth*m_vpOutHeight*3/2, fp);
-                }
-                else
-                {
-                    fwrite(m_outBuffers[index], 1, m_vpOutWidth*m_vpOutHeight*3, fp);
-                }
+                fwrite(m_outBuffers[index], 1, m_vpOutWidth*m_vpOutHeight*3, fp);
             }
         }
-
-        decodeOutput->DeRef(output);
-        EnqueueOutput(output);
     }
 
-exit:
-    return 0;
+    decodeOutput->DeRef(output);
+    EnqueueOutput(output);
+
+    m_stepOutput = nullptr;
+    m_stepDecodeOutput = nullptr;
+    m_stepRois.clear();
+    return VA_STEP_PROGRESS;
 }
 
 int CropThreadBlock::Crop(VASurfaceID inSurf,
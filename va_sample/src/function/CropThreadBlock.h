@@ -42,6 +42,9 @@ public:
 
     int Loop();
 
+    bool CanStep() override {return true; }
+    int Step() override;
+
     inline void SetOutDump(bool flag = true) {m_dumpFlag = flag; }
     inline void SetVASync(bool flag = true) {m_vaSyncFlag = flag; }
     inline void SetOutResolution(uint32_t w, uint32_t h) {m_vpOutWidth = w; m_vpOutHeight = h; }
@@ -86,7 +89,7 @@ protected:
 
     std::vector<VASurfaceID> m_outputVASurfs;
     std::vector<uint8_t*> m_outBuffers;
-    std::vector<int> m_outRefs;
+    std::vector<VARefCount> m_outRefs;
 
     bool m_dumpFlag;
     bool m_vpMemOutTypeVideo;
@@ -95,6 +98,14 @@ protected:
     std::map<uint32_t, FILE *> m_dumpFps;
 
     uint32_t  m_pipeflag;
+
+    // frame being cropped, kept between steps
+    VADataPacket *m_stepOutput;
+    VAData *m_stepDecodeOutput;
+    std::vector<VAData *> m_stepRois;
+    uint32_t m_stepRoiIndex;
+    uint32_t m_stepWidth;
+    uint32_t m_stepHeight;
 };
 
 #endif
@@ -25,6 +25,7 @@
 #include "logs.h"
 #include "Statistics.h"
 #include "MfxSessionMgr.h"
+#include "ImageKernels.h"
 #include <iostream>
 
 using namespace std;
@@ -102,7 +103,7 @@ DecodeThreadBlock::~DecodeThreadBlock()
     for (int i = 0; i < m_vpOutSurfNum; i++)
     {
             delete m_vpOutSurfaces[i];
-            delete m_vpOutBuffers[i];
+            free(m_vpOutBuffers[i]);
     }
     delete[] m_vpOutSurfaces;
     delete[] m_vpOutBuffers;
@@ -349,8 +350,11 @@ int DecodeThreadBlock::PrepareInternal()
     // [VPP input]
     // use decode output as vpp input
     // each vp input (decode output) has an external reference count
-    m_decOutRefs = new int[m_decodeSurfNum];
-    memset(m_decOutRefs, 0, sizeof(int)*m_decodeSurfNum);
+    m_decOutRefs = new VARefCount[m_decodeSurfNum];
+    for (int i = 0; i < m_decodeSurfNum; i++)
+    {
+        m_decOutRefs[i] = 0;
+    }
 
     // [VPP output]
     mfxFrameAllocResponse VPP_Out_Response = { 0 };
@@ -371,8 +375,11 @@ int DecodeThreadBlock::PrepareInternal()
     }
     m_vpOutSurfNum = VPP_Out_Response.NumFrameActual;
     m_vpOutSurfaces = new mfxFrameSurface1 * [m_vpOutSurfNum];
-    m_vpOutRefs = new int[m_vpOutSurfNum];
-    memset(m_vpOutRefs, 0, sizeof(int)*m_vpOutSurfNum);
+    m_vpOutRefs = new VARefCount[m_vpOutSurfNum];
+    for (int i = 0; i < m_vpOutSurfNum; i++)
+    {
+        m_vpOutRefs[i] = 0;
+    }
     m_vpOutBuffers = new uint8_t *[m_vpOutSurfNum];
     memset(m_vpOutBuffers, 0, sizeof(uint8_t *)*m_vpOutSurfNum);
     
@@ -392,7 +399,13 @@ int DecodeThreadBlock::PrepareInternal()
         m_vpOutSurfaces[i]->Data.MemId = VPP_Out_Response.mids[i];
 
         // allocate system buffer to store VP output
-        m_vpOutBuffers[i] = new uint8_t[3*m_vpOutWidth*m_vpOutHeight]; // RGBP
+        void *buffer = nullptr;
+        if (posix_memalign(&buffer, VA_SURFACE_ALIGNMENT, 3*m_vpOutWidth*m_vpOutHeight)) // RGBP
+        {
+            MSDK_PRINT_RET_MSG(MFX_ERR_MEMORY_ALLOC);
+            return 1;
+        }
+        m_vpOutBuffers[i] = (uint8_t *)buffer;
         memset(m_vpOutBuffers[i], 0, 3*m_vpOutWidth*m_vpOutHeight);
     }
 
@@ -520,70 +533,34 @@ int DecodeThreadBlock::CaptureSurface(mfxFrameSurface1* pSurface, uint8_t *pOutB
     }
 
 
-    uint8_t *pTemp = pOutBuffer;
     if(m_vpOutFormat == MFX_FOURCC_NV12)
     {
         ptr	= pData->R + (pInfo->CropX ) + (pInfo->CropY ) * pData->Pitch;
-
-        for(int i = 0; i < h; i++)
-        {
-            memcpy(pTemp  + i*w, ptr + i*pData->Pitch, w);
-        }
+        VACopyPlane(pOutBuffer, w, ptr, pData->Pitch, w, h);
 
         ptr	= pData->G + (pInfo->CropX ) + (pInfo->CropY ) * pData->Pitch;
-        pTemp = pOutBuffer + w*h;
-        for(int i = 0; i < h / 2; i++)
-        {
-            memcpy(pTemp  + i*w, ptr + i*pData->Pitch, w);
-        }
+        VACopyPlane(pOutBuffer + w*h, w, ptr, pData->Pitch, w, h / 2);
     }
 
     else if(!m_rgbpWA)
     {
-        uint8_t *pTemp = pOutBuffer + 2 * w * h;
         ptr   = pData->B + (pInfo->CropX ) + (pInfo->CropY ) * pData->Pitch;
-        for (int i = 0; i < h; i++)
-        {
-            memcpy(pTemp  + i*w, ptr + i * pData->Pitch, w);
-        }
+        VACopyPlane(pOutBuffer + 2 * w * h, w, ptr, pData->Pitch, w, h);
 
         ptr	= pData->G + (pInfo->CropX ) + (pInfo->CropY ) * pData->Pitch;
-        pTemp = pOutBuffer + w*h;
-        for(int i = 0; i < h; i++)
-        {
-            memcpy(pTemp  + i*w, ptr + i*pData->Pitch, w);
-        }
+        VACopyPlane(pOutBuffer + w*h, w, ptr, pData->Pitch, w, h);
 
         ptr	= pData->R + (pInfo->CropX ) + (pInfo->CropY ) * pData->Pitch;
-        pTemp = pOutBuffer;
-        for(int i = 0; i < h; i++)
-        {
-            memcpy(pTemp  + i*w, ptr + i*pData->Pitch, w);
-        }
+        VACopyPlane(pOutBuffer, w, ptr, pData->Pitch, w, h);
     }
     else
     {
-        uint8_t *pbuffer = new uint8_t[pData->Pitch*h];
-        MSDK_CHECK_POINTER(pbuffer, MFX_ERR_MEMORY_ALLOC);
-
-        memcpy(pbuffer, pData->B, pData->Pitch * h);
-
+        // the surface is RGB4, deinterleaved straight from the locked surface
         uint8_t *ptrR = pOutBuffer;
         uint8_t *ptrG = ptrR + w * h;
         uint8_t *ptrB = ptrG + w * h;
 
-        for (int i = 0; i < h; i ++)
-        {
-            for (int j = 0; j < w; j ++)
-            {
-                ptrB[i*w+j] = pbuffer[i * pData->Pitch + j*4];
-                ptrG[i*w+j] = pbuffer[i * pData->Pitch + j*4 + 1];
-                ptrR[i*w+j] = pbuffer[i * pData->Pitch + j*4 + 2];
-            }
-        }
-
-        delete[] pbuffer;
-
+        VABGRAToRGBP(ptrR, ptrG, ptrB, w, pData->B, pData->Pitch, w, h);
     }
 
     sts = m_mfxAllocator->Unlock(m_mfxAllocator->pthis, pSurface->Data.MemId, &(pSurface->Data));
@@ -617,6 +594,7 @@ int DecodeThreadBlock::Loop()
     int nIndexVpIn = 0;
     int nIndexVpOut = 0;
     uint32_t nDecoded = 0;
+    uint32_t sequence = 0;
     FILE* fp_dumpall = nullptr;
     TRACE("m_vpDumpAllFrame %d", m_vpDumpAllFrame);
     if(m_vpDumpAllFrame){
@@ -856,7 +834,7 @@ int DecodeThreadBlock::Loop()
 
                     VAData *vaData = VAData::Create(m_vpOutSurfaces[nIndexVpOut], m_mfxAllocator);
                     // Increasing Ref counter manually
-                    m_vpOutRefs[nIndexVpOut]++;
+                    m_vpOutRefs[nIndexVpOut].fetch_add(1, std::memory_order_relaxed);
                     vaData->SetExternalRef(&m_vpOutRefs[nIndexVpOut]);
                     //vaData->SetRef(1);
                     vaData->SetID(m_channel, nDecoded);
@@ -864,6 +842,15 @@ int DecodeThreadBlock::Loop()
                 }
             }
         }
+        // the packets with data are numbered without gap for the connectors that keep the frames in order
+        if (!outputPacket->empty())
+        {
+            ++ sequence;
+            for (auto ite = outputPacket->begin(); ite != outputPacket->end(); ite ++)
+            {
+                (*ite)->SetSequence(sequence);
+            }
+        }
         EnqueueOutput(outputPacket);
 
         if (m_frameNumber != 0 && nDecoded >= m_frameNumber)
@@ -882,13 +869,14 @@ exit:
     return ret;
 }
 
-int DecodeThreadBlock::GetFreeSurface(mfxFrameSurface1 **surfaces, int *refs, uint32_t count)
+int DecodeThreadBlock::GetFreeSurface(mfxFrameSurface1 **surfaces, VARefCount *refs, uint32_t count)
 {
     if (surfaces)
     {
         for (uint32_t i = 0; i < count; i ++)
         {
-            int refNum = (refs == nullptr)?0:refs[i];
+            // acquire pairs with the release in VAData::DeRef, so the last reader is done with the surface
+            int refNum = (refs == nullptr)?0:refs[i].load(std::memory_order_acquire);
             if (surfaces[i]->Data.Locked == 0 && refNum == 0)
             {
                 return i;
@@ -78,7 +78,7 @@ protected:
 
     int ReadBitStreamData(); // fill the buffer in m_mfxBS, and store the remaining in m_buffer
 
-    int GetFreeSurface(mfxFrameSurface1 **surfaces, int *refs, uint32_t count);
+    int GetFreeSurface(mfxFrameSurface1 **surfaces, VARefCount *refs, uint32_t count);
     
     int DumpVPPOutput(uint8_t *pOutBuffer, FILE* fp_dumpall);
 
@@ -124,8 +124,8 @@ protected:
     uint32_t m_vpOutWidth_1stPass;
     uint32_t m_vpOutHeight_1stPass;
 
-    int *m_decOutRefs;
-    int *m_vpOutRefs;
+    VARefCount *m_decOutRefs;
+    VARefCount *m_vpOutRefs;
 
     bool m_vpOutDump;
     int  m_vpDumpAllFrame;
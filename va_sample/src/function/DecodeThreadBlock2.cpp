@@ -175,8 +175,11 @@ int DecodeThreadBlock::PrepareInternal()
     MSDK_IGNORE_MFX_STS(sts, MFX_WRN_PARTIAL_ACCELERATION);
     MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 
-    m_vpOutRefs = new int[m_vpOutBufNum];
-    memset(m_vpOutRefs, 0, sizeof(int)*m_vpOutBufNum);
+    m_vpOutRefs = new VARefCount[m_vpOutBufNum];
+    for (int i = 0; i < m_vpOutBufNum; i++)
+    {
+        m_vpOutRefs[i] = 0;
+    }
     m_vpOutBuffers = new uint8_t *[m_vpOutBufNum];
     memset(m_vpOutBuffers, 0, sizeof(uint8_t *)*m_vpOutBufNum);
 
@@ -258,6 +261,7 @@ int DecodeThreadBlock::Loop()
     TRACE("");
     mfxStatus sts = MFX_ERR_NONE;
     uint32_t nDecoded = 0;
+    uint32_t sequence = 0;
     FILE* fp_dumpall;
     if(m_vpDumpAllFrame){
         if(!m_usersetdumpname.empty())
@@ -560,6 +564,15 @@ int DecodeThreadBlock::Loop()
         }
 
         
+        // the packets with data are numbered without gap for the connectors that keep the frames in order
+        if (!outputPacket->empty())
+        {
+            ++ sequence;
+            for (auto ite = outputPacket->begin(); ite != outputPacket->end(); ite ++)
+            {
+                (*ite)->SetSequence(sequence);
+            }
+        }
         EnqueueOutput(outputPacket);
 
         if (m_frameNumber != 0 && nDecoded >= m_frameNumber)
@@ -581,7 +594,7 @@ int DecodeThreadBlock::GetFreeVPOutBuffer()
 {
     for (int i = 0; i < m_vpOutBufNum; i++)
     {
-        if (m_vpOutRefs[i] == 0)
+        if (m_vpOutRefs[i].load(std::memory_order_acquire) == 0)
         {
             return i;
         }
@@ -89,7 +89,7 @@ protected:
     // only used when vp output is in cpu memory
     uint8_t **m_vpOutBuffers;
     uint32_t m_vpOutBufNum;
-    int *m_vpOutRefs;
+    VARefCount *m_vpOutRefs;
 
     mfxVideoParam m_mfxVideoParam;
     mfxU32  m_CodecId;
@@ -60,7 +60,10 @@ EncodeThreadBlock::EncodeThreadBlock(uint32_t channel, VAEncodeType type):
 {
     memset(&m_encParams, 0, sizeof(m_encParams));
     memset(m_outBuffers, 0, sizeof(m_outBuffers));
-    memset(m_outRefs, 0, sizeof(m_outRefs));
+    for (int i = 0; i < m_bufferNum; i++)
+    {
+        m_outRefs[i] = 0;
+    }
 }
 
 EncodeThreadBlock::EncodeThreadBlock(uint32_t channel, VAEncodeType type, MFXVideoSession *mfxSession, mfxFrameAllocator *allocator):
@@ -247,7 +250,7 @@ int EncodeThreadBlock::FindFreeOutput()
 {
     for (int i = 0; i < m_bufferNum; i ++)
     {
-        if (m_outRefs[i] <= 0)
+        if (m_outRefs[i].load(std::memory_order_acquire) <= 0)
         {
             return i;
         }
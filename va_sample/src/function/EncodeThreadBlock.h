@@ -98,7 +98,7 @@ protected:
 
     static const uint32_t m_bufferNum = 3;
     uint8_t *m_outBuffers[m_bufferNum];
-    int m_outRefs[m_bufferNum];
+    VARefCount m_outRefs[m_bufferNum];
 
     int m_outputRef;
 };
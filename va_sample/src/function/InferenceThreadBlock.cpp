@@ -24,6 +24,7 @@
 #include "Inference.h"
 #include "logs.h"
 #include "Statistics.h"
+#include "TrackerThreadBlock.h"
 #include <queue>
 #include <map>
 #include <iostream>
@@ -41,11 +42,24 @@ InferenceThreadBlock::InferenceThreadBlock(uint32_t index, InferenceModelType ty
     m_modelInputReshapeWidth(0),
     m_modelInputReshapeHeight(0),
     m_confidenceThreshold(0.8),
+    m_nmsIoUThreshold(0),
+    m_nmsCrossClass(false),
+    m_topK(1),
+    m_softmax(false),
+    m_frameWidth(0),
+    m_frameHeight(0),
+    m_tileOverlap(0),
     m_outRef(1),
+    m_maxBatchDelayUs(0),
     m_device(nullptr),
+    m_cacheDir(nullptr),
     m_infer(nullptr),
+    m_trackClasses(nullptr),
     m_lastInferID(0),
-    m_enableSharing(false)
+    m_needInput(true),
+    m_enableSharing(false),
+    m_zeroCopy(false),
+    m_sentNum(0)
 {
 }
 
@@ -55,6 +69,27 @@ InferenceThreadBlock::~InferenceThreadBlock()
     {
         InferenceBlock::Destroy(m_infer);
     }
+    for (auto ite = m_freePackets.begin(); ite != m_freePackets.end(); ite ++)
+    {
+        delete *ite;
+    }
+}
+
+VADataPacket *InferenceThreadBlock::NewTempPacket()
+{
+    if (m_freePackets.empty())
+    {
+        return new VADataPacket;
+    }
+    VADataPacket *packet = m_freePackets.back();
+    m_freePackets.pop_back();
+    return packet;
+}
+
+void InferenceThreadBlock::RecycleTempPacket(VADataPacket *packet)
+{
+    packet->clear();
+    m_freePackets.push_back(packet);
 }
 
 int InferenceThreadBlock::PrepareInternal()
@@ -64,6 +99,12 @@ int InferenceThreadBlock::PrepareInternal()
     m_infer->Initialize(m_batchNum, m_asyncDepth, m_streamNum, m_confidenceThreshold, m_modelInputReshapeHeight, m_modelInputReshapeWidth);
     TRACE("Initialize m_batchNum %d    m_asyncDepth %d   m_confidenceThreshold %d m_modelInputReshapeHeight %d m_modelInputReshapeWidth %d",
         m_batchNum, m_asyncDepth, m_confidenceThreshold, m_modelInputReshapeHeight, m_modelInputReshapeWidth);
+    m_infer->SetMaxBatchDelay(m_maxBatchDelayUs);
+    m_infer->SetNMS(m_nmsIoUThreshold, m_nmsCrossClass);
+    m_infer->SetTopK(m_topK, m_softmax);
+    m_infer->SetTiling(m_frameWidth, m_frameHeight, m_tileOverlap);
+    m_infer->SetCacheDir(m_cacheDir);
+    m_infer->EnableZeroCopy(m_zeroCopy);
 
     if (m_enableSharing)
     {
@@ -109,207 +150,239 @@ bool InferenceThreadBlock::CanBeProcessed(VAData *data)
     return w == arw  && h == arh && format == rf;
 }
 
-stopWatch watch = {};
-int InferenceThreadBlock::Loop()
+// returns 1 if the packet waits for inference, 0 if it goes to the next block as it is
+int InferenceThreadBlock::ProcessInput(VADataPacket *InPacket)
 {
-    std::queue<uint64_t> hasOutputs;
-    std::map<uint64_t, VADataPacket *> recordedPackets;
-    bool needInput = true;
+    if (InPacket->size() == 0)
+        return 0;
+
+    // get all the inference inputs
+    VADataPacket *tempPacket = NewTempPacket();
+    std::vector<VAData *>vpOuts;
+    uint32_t channelIndex = 0;
+    uint32_t frameIndex = 0;
+    for (auto ite = InPacket->begin(); ite != InPacket->end(); ite++)
+    {
+        VAData *data = *ite;
+        channelIndex = data->ChannelIndex();
+        frameIndex = data->FrameIndex();;
+        if (CanBeProcessed(data))
+        {
+            //printf("Get VP out\n");
+            vpOuts.push_back(data);
+            tempPacket->push_back(data);
+        }
+        else
+        {
+            tempPacket->push_back(data);
+        }
+    }
 
-    TRACE("m_stop %d", m_stop);
+    TRACE("vpOuts % \n", vpOuts.size());
+    // insert the images to inference engine
+    if (vpOuts.size() > 0 || m_pendingIDs.size() > 0)
+    {
+        m_recordedPackets[ID(channelIndex, frameIndex)] = tempPacket;
+    }
+    else
+    {
+        // no need for inference
+        // no pending IDs before this
+        // sent to next block right after the packets already waiting for an output packet
+        TRACE("sent out id directly %llu\n", ID(channelIndex, frameIndex));
+        m_sendPackets.push_back(tempPacket);
+        return 0;
+    }
 
-    //startTimer(&watch);
-    while (!m_stop)
+    if (vpOuts.size() == 0)
     {
-        TRACE("needInput %d ", needInput);
-        if (needInput)
+        m_pendingIDs[m_lastInferID].push_back(ID(channelIndex, frameIndex));
+    }
+
+    for (int i = 0; i < vpOuts.size(); i ++)
+    {
+        if (vpOuts[i]->Type() == USER_SURFACE)
         {
-            //printf("HFDebug: try to get input in inference\n");
-            //stopTimer(&watch);
-            //printf("%fms: Before AcquireInput\n", watch.elapsed);
-            VADataPacket *InPacket = AcquireInput();
-            //stopTimer(&watch);
-            //printf("%fms: After AcquireInput\n", watch.elapsed);
-            
-            TRACE("get input in inference ");
-
-            if (!InPacket || InPacket->size() == 0){
-                if (InPacket)
-                    ReleaseInput(InPacket);
-                continue;
-            }
+            TRACE("USER_SURFACE   vpOuts.size() %d   i %d  ", vpOuts.size(), i);
+            m_infer->InsertData(vpOuts[i]);
+        }
+        else if (vpOuts[i]->Type() == MFX_SURFACE || vpOuts[i]->Type() == VA_SURFACE)
+        {
+            TRACE("VA_SURFACE   vpOuts.size() %d   i %d ", vpOuts.size(), i);
+            m_infer->InsertImage(vpOuts[i]->GetVASurface(), vpOuts[i]->ChannelIndex(), vpOuts[i]->FrameIndex(), vpOuts[i]->RoiIndex());
+        }
 
-            // get all the inference inputs
-            VADataPacket *tempPacket = new VADataPacket;
-            std::vector<VAData *>vpOuts;
-            uint32_t channelIndex = 0;
-            uint32_t frameIndex = 0;
-            for (auto ite = InPacket->begin(); ite != InPacket->end(); ite++)
-            {
-                VAData *data = *ite;
-                channelIndex = data->ChannelIndex();
-                frameIndex = data->FrameIndex();;
-                if (CanBeProcessed(data))
-                {
-                    //printf("Get VP out\n");
-                    vpOuts.push_back(data);
-                    tempPacket->push_back(data);
-                }
-                else
-                {
-                    tempPacket->push_back(data);
-                }
-            }
-            ReleaseInput(InPacket);
+        Statistics::getInstance().Step(INFERENCE_FRAMES_RECEIVED);
+        if (m_type == MOBILENET_SSD_U8 || m_type == YOLO)
+        {
+            Statistics::getInstance().Step(INFERENCE_FRAMES_OD_RECEIVED);
+        }
+        else if (m_type == RESNET_50)
+        {
+            Statistics::getInstance().Step(INFERENCE_FRAMES_OC_RECEIVED);
+        }
+        m_lastInferID = ID(vpOuts[i]->ChannelIndex(), vpOuts[i]->FrameIndex());
+        if (m_pendingIDs.find(m_lastInferID) == m_pendingIDs.end())
+        {
+            m_pendingIDs[m_lastInferID] = std::vector<uint64_t>();
+        }
+    }
+    return 1;
+}
 
-            TRACE("vpOuts % \n", vpOuts.size());
-            // insert the images to inference engine
-            if (vpOuts.size() > 0 || m_pendingIDs.size() > 0)
-            {
-                recordedPackets[ID(channelIndex, frameIndex)] = tempPacket;
-            }
-            else
-            {
-                // no need for inference
-                // no pending IDs before this
-                // enqueue to next block directly
-                VADataPacket *outputPacket = DequeueOutput();
-                if (!outputPacket)
-                {
-                    delete tempPacket;
-                    goto exit;
-                }
+int InferenceThreadBlock::Loop()
+{
+    return LoopSteps();
+}
+
+bool InferenceThreadBlock::SendPackets()
+{
+    while (m_sentNum < m_sendPackets.size())
+    {
+        if (DequeueOutputs(m_outPackets, m_sendPackets.size() - m_sentNum) == 0)
+            return false;
 
-                outputPacket->insert(outputPacket->end(), tempPacket->begin(), tempPacket->end());
-                delete tempPacket;
-                TRACE("sent out id directly %llu\n", ID(channelIndex, frameIndex));
+        for (auto ite = m_outPackets.begin(); ite != m_outPackets.end(); ite ++, m_sentNum ++)
+        {
+            VADataPacket *targetPacket = m_sendPackets[m_sentNum];
+            (*ite)->insert((*ite)->end(), targetPacket->begin(), targetPacket->end());
+            RecycleTempPacket(targetPacket);
+        }
+        EnqueueOutputs(m_outPackets);
+        TRACE("finished EnqueueOutputs \n");
+    }
+    m_sendPackets.clear();
+    m_sentNum = 0;
+    return true;
+}
 
-                EnqueueOutput(outputPacket);
-                continue;
-            }
+int InferenceThreadBlock::Step()
+{
+    TRACE("needInput %d ", m_needInput);
+    // the packets the next block had no room for go out first
+    if (!SendPackets())
+        return m_pooled ? VA_STEP_IDLE : VA_STEP_DONE;
 
-            if (vpOuts.size() == 0)
+    bool progress = false;
+    if (m_needInput)
+    {
+        // take up to a full inference batch with one connector round trip,
+        // don't block while a partial batch waits for its deadline or requests are in flight,
+        // their results must not wait for the next frame
+        int32_t batchTimeout = m_infer->GetBatchTimeout();
+        bool inFlight = m_infer->InFlight();
+        bool wait = !m_pooled && batchTimeout < 0 && !inFlight;
+        if (AcquireInputs(m_inPackets, m_batchNum, wait) > 0)
+        {
+            TRACE("get %d inputs in inference ", m_inPackets.size());
+            for (auto ite = m_inPackets.begin(); ite != m_inPackets.end(); ite ++)
             {
-                m_pendingIDs[m_lastInferID].push_back(ID(channelIndex, frameIndex));
+                ProcessInput(*ite);
             }
+            ReleaseInputs(m_inPackets);
+            progress = true;
+        }
+        else if (wait)
+        {
+            return VA_STEP_IDLE;
+        }
+        else if (!m_pooled)
+        {
+            // poll the inputs until a request completes or the deadline, GetOutput() then
+            // returns the results or submits the partial batch
+            int32_t pollUs = INPUT_POLL_US;
+            if (batchTimeout >= 0 && batchTimeout < pollUs)
+                pollUs = batchTimeout;
+            if (inFlight)
+                m_infer->WaitCompleted(pollUs);
+            else if (pollUs > 0)
+                usleep(pollUs);
+        }
+    }
+
+    // get all avalible inference output, the pool doesn't wait for them
+    std::vector<VAData *> outputs;
+    std::vector<uint32_t> channels;
+    std::vector<uint32_t> frames;
+    uint32_t lastSize = 0;
+    bool inferenceFree = false;
+    bool isPendingTasks = true;
+    bool isAllWorkerBusy = false;
+    // get available outputs
+    while (1)
+    {
+        if (m_stop)
+            return VA_STEP_DONE;
 
-           for (int i = 0; i < vpOuts.size(); i ++)
+        int ret = m_infer->GetOutput(outputs, channels, frames, m_pooled ? 0 : OUTPUT_TIMEOUT_US);
+        if (ret < 0)
+        {
+            inferenceFree = true;
+        }
+        if (ret == -1)
+        {
+            isPendingTasks = false;
+        }
+        if (ret == 2)
+        {
+            isAllWorkerBusy = true;
+        }
+        if (outputs.size() == lastSize)
+        {
+            break;
+        }
+        else
+        {
+            for (int i = 0; i < frames.size(); i++)
             {
-                if (vpOuts[i]->Type() == USER_SURFACE)
-                {
-                    TRACE("USER_SURFACE   vpOuts.size() %d   i %d  ", vpOuts.size(), i);
-                    m_infer->InsertImage(vpOuts[i]->GetSurfacePointer(), vpOuts[i]->ChannelIndex(), vpOuts[i]->FrameIndex(), vpOuts[i]->RoiIndex());
-                }
-                else if (vpOuts[i]->Type() == MFX_SURFACE || vpOuts[i]->Type() == VA_SURFACE)
-                {
-                    TRACE("VA_SURFACE   vpOuts.size() %d   i %d ", vpOuts.size(), i);
-                    //stopTimer(&watch);
-                    //printf("%fms: Before InsertImage, channel %d frame %d\n", watch.elapsed, vpOuts[i]->ChannelIndex(), vpOuts[i]->FrameIndex());
-                    m_infer->InsertImage(vpOuts[i]->GetVASurface(), vpOuts[i]->ChannelIndex(), vpOuts[i]->FrameIndex(), vpOuts[i]->RoiIndex());
-                }
-                
-                Statistics::getInstance().Step(INFERENCE_FRAMES_RECEIVED);
+                Statistics::getInstance().Step(INFERENCE_FRAMES_PROCESSED);
                 if (m_type == MOBILENET_SSD_U8 || m_type == YOLO)
                 {
-                    Statistics::getInstance().Step(INFERENCE_FRAMES_OD_RECEIVED);
+                    Statistics::getInstance().Step(INFERENCE_FRAMES_OD_PROCESSED);
                 }
                 else if (m_type == RESNET_50)
                 {
-                    Statistics::getInstance().Step(INFERENCE_FRAMES_OC_RECEIVED);
-                }
-                m_lastInferID = ID(vpOuts[i]->ChannelIndex(), vpOuts[i]->FrameIndex());
-                if (m_pendingIDs.find(m_lastInferID) == m_pendingIDs.end())
-                {
-                    m_pendingIDs[m_lastInferID] = std::vector<uint64_t>();
+                    Statistics::getInstance().Step(INFERENCE_FRAMES_OC_PROCESSED);
                 }
             }
+            lastSize = outputs.size();
         }
+    }
+    TRACE("lastSize %d    outputs.size  %d ", lastSize,  outputs.size());
+    progress = progress || !channels.empty();
 
 
+    // insert the inference outputs to the packets
+    int j = 0;
+    for (int i = 0; i < channels.size(); i++)
+    {
+        VADataPacket *targetPacket = m_recordedPackets[ID(channels[i], frames[i])];
 
-        // get all avalible inference output
-        std::vector<VAData *> outputs;
-        std::vector<uint32_t> channels;
-        std::vector<uint32_t> frames;
-        uint32_t lastSize = 0;
-        bool inferenceFree = false;
-        bool isPendingTasks = true;
-        bool isAllWorkerBusy = false;
-        // get available outputs
-        while (1)
+        if (m_hasOutputs.size() == 0 || ID(channels[i], frames[i]) != m_hasOutputs.back())
         {
-            if (m_stop)
-                goto exit;
-
-            int ret = m_infer->GetOutput(outputs, channels, frames);
-            //stopTimer(&watch);
-            //printf("%fms: After GetOutput, output size %d\n", watch.elapsed, outputs.size());
-            if (ret < 0)
-            {
-                inferenceFree = true;
-            }
-            if (ret == -1)
-            {
-                isPendingTasks = false;
-            }
-            if (ret == 2)
-            {
-                isAllWorkerBusy = true;
-            }
-            if (outputs.size() == lastSize)
-            {
-                break;
-            }
-            else
-            {
-                for (int i = 0; i < frames.size(); i++)
-                {
-                    Statistics::getInstance().Step(INFERENCE_FRAMES_PROCESSED);
-                    if (m_type == MOBILENET_SSD_U8 || m_type == YOLO)
-                    {
-                        Statistics::getInstance().Step(INFERENCE_FRAMES_OD_PROCESSED);
-                    }
-                    else if (m_type == RESNET_50)
-                    {
-                        Statistics::getInstance().Step(INFERENCE_FRAMES_OC_PROCESSED);
-                    }
-                }
-                lastSize = outputs.size();
-            }
+            m_hasOutputs.push(ID(channels[i], frames[i]));
         }
-        TRACE("lastSize %d    outputs.size  %d ", lastSize,  outputs.size());
 
-
-        // insert the inference outputs to the packets
-        int j = 0;
-        for (int i = 0; i < channels.size(); i++)
+        while (j < outputs.size()
+                && outputs[j]->ChannelIndex() == channels[i]
+                && outputs[j]->FrameIndex() == frames[i])
         {
-            VADataPacket *targetPacket = recordedPackets[ID(channels[i], frames[i])];
-
-            if (hasOutputs.size() == 0 || ID(channels[i], frames[i]) != hasOutputs.back())
-            {
-                hasOutputs.push(ID(channels[i], frames[i]));
-            }
-            
-            while (j < outputs.size()
-                    && outputs[j]->ChannelIndex() == channels[i]
-                    && outputs[j]->FrameIndex() == frames[i])
-            {
-                outputs[j]->SetRef(m_outRef);
-                targetPacket->push_back(outputs[j]);
-                ++j;
-            }
+            outputs[j]->SetRef(m_outRef);
+            targetPacket->push_back(outputs[j]);
+            ++j;
         }
+    }
 
-        // send the packets to next block
-        if (hasOutputs.size() == 0)
-        {
-            needInput = inferenceFree || (!isAllWorkerBusy);
-            continue;
-        }
-        TRACE("hasOutputs size %d,  infernece free %d ", hasOutputs.size(), inferenceFree);
+    // send the packets to next block
+    if (m_hasOutputs.size() == 0)
+    {
+        m_needInput = inferenceFree || (!isAllWorkerBusy);
+    }
+    else
+    {
+        TRACE("hasOutputs size %d,  infernece free %d ", m_hasOutputs.size(), inferenceFree);
 
-        uint32_t outputNum = hasOutputs.size() - 1; // can't enqueue last one because it may has following outputs in next GetOutput
+        uint32_t outputNum = m_hasOutputs.size() - 1; // can't enqueue last one because it may has following outputs in next GetOutput
         if (inferenceFree && !isPendingTasks)
         {
             ++ outputNum; // no inference task now, so the last one can also be enqueued
@@ -318,29 +391,26 @@ int InferenceThreadBlock::Loop()
         {
             // No output but inferenece still working
             // wait longer
-            needInput = false;
+            m_needInput = false;
         }
         else
         {
-            needInput = true;
+            m_needInput = true;
         }
 
         for (int i = 0; i < outputNum; i++)
         {
-            uint64_t id = hasOutputs.front();
-            hasOutputs.pop();
-            VADataPacket *targetPacket = recordedPackets[id];
-            recordedPackets.erase(id);
+            uint64_t id = m_hasOutputs.front();
+            m_hasOutputs.pop();
+            VADataPacket *targetPacket = m_recordedPackets[id];
+            m_recordedPackets.erase(id);
 
-            VADataPacket *outputPacket = DequeueOutput();
-            if (!outputPacket)
-                goto exit;
-
-            outputPacket->insert(outputPacket->end(), targetPacket->begin(), targetPacket->end());
-            delete targetPacket;
-            TRACE("sent out id %llu   outputNum %d  i %d \n", id, outputNum, i);
-            EnqueueOutput(outputPacket);
-            TRACE("finished EnqueueOutput \n");
+            if (m_trackClasses)
+            {
+                m_trackClasses->Learn(targetPacket);
+            }
+            TRACE("sending id %llu   outputNum %d  i %d \n", id, outputNum, i);
+            m_sendPackets.push_back(targetPacket);
 
             if (m_pendingIDs.find(id) != m_pendingIDs.end())
             {
@@ -348,21 +418,19 @@ int InferenceThreadBlock::Loop()
                 for (int i = 0; i < pendinglist.size(); i++)
                 {
                     uint64_t pid = pendinglist[i];
-                    VADataPacket *ptargetPacket = recordedPackets[pid];
-                    recordedPackets.erase(pid);
-                    VADataPacket *poutputPacket = DequeueOutput();
-                    if (!poutputPacket)
-                        goto exit;
-
-                    poutputPacket->insert(poutputPacket->end(), ptargetPacket->begin(), ptargetPacket->end());
-                    delete ptargetPacket;
-                    EnqueueOutput(poutputPacket);
+                    m_sendPackets.push_back(m_recordedPackets[pid]);
+                    m_recordedPackets.erase(pid);
                 }
                 m_pendingIDs.erase(id);
             }
         }
     }
 
-exit:
-    return 0;
+    if (!SendPackets())
+        return m_pooled ? VA_STEP_IDLE : VA_STEP_DONE;
+
+    if (progress || !m_pooled)
+        return VA_STEP_PROGRESS;
+    // the completion of the requests and the deadline of a partial batch don't come through the connectors
+    return (m_infer->InFlight() || m_infer->GetBatchTimeout() >= 0) ? VA_STEP_RETRY : VA_STEP_IDLE;
 }
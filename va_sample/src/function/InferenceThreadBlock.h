@@ -27,11 +27,13 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <queue>
 
 #include "ThreadBlock.h"
 #include "Inference.h"
 
 class InferenceBlock;
+class VATrackClasses;
 
 class InferenceThreadBlock : public VAThreadBlock
 {
@@ -48,22 +50,65 @@ public:
     inline void SetModelInputReshapeWidth(uint32_t width) {m_modelInputReshapeWidth = width; }
     inline void SetModelInputReshapeHeight(uint32_t height) {m_modelInputReshapeHeight = height; }
     inline void SetConfidenceThreshold(float confidence) { m_confidenceThreshold = confidence; }
+    // non maximum suppression of the detection models, iouThreshold 0 keeps the default of the model
+    inline void SetNMS(float iouThreshold, bool crossClass)
+    {
+        m_nmsIoUThreshold = iouThreshold;
+        m_nmsCrossClass = crossClass;
+    }
+    // classes reported per image by the classification models, softmax turns their scores into probabilities
+    inline void SetTopK(uint32_t k, bool softmax)
+    {
+        m_topK = k;
+        m_softmax = softmax;
+    }
+    // frames split in tiles of the model input size by the detection and super resolution models, 0 disables the tiling
+    inline void SetTiling(uint32_t frameWidth, uint32_t frameHeight, uint32_t overlap)
+    {
+        m_frameWidth = frameWidth;
+        m_frameHeight = frameHeight;
+        m_tileOverlap = overlap;
+    }
     inline void SetDevice(const char *device) {m_device = device; }
+    // compiled models are exported to and imported from this directory, kept by the caller
+    inline void SetCacheDir(const char *dir) {m_cacheDir = dir; }
     inline void SetModelFile(const char *model, const char *weights)
     {
         m_modelFile = model;
         m_weightsFile = weights;
     }
     inline void SetOutputRef(int ref) {m_outRef = ref; }
+    // the classification results of the tracked regions are kept for the tracker, kept by the caller
+    inline void SetTrackClasses(VATrackClasses *classes) {m_trackClasses = classes; }
+    // submit a partial batch once its first frame waited this long, 0 always waits for a full batch
+    inline void SetMaxBatchDelay(uint32_t us) {m_maxBatchDelayUs = us; }
 
     inline void EnabelSharingWithVA() {m_enableSharing = true; }
+    // the inference reads the input buffers in place when they suit the model, with batch 1
+    inline void EnableZeroCopy() {m_zeroCopy = true; }
 
     int Loop();
 
+    // in VA_EXEC_POOL the steps never wait: the block is polled while requests are in flight
+    bool CanStep() override {return true; }
+    int Step() override;
+
 protected:
     int PrepareInternal() override;
 
     bool CanBeProcessed(VAData *data);
+    int ProcessInput(VADataPacket *input);
+    // sends m_sendPackets in order, false if the output had no free packet, the rest goes at the next step
+    bool SendPackets();
+
+    // the packets holding the frames under inference are reused instead of new/delete per frame
+    VADataPacket *NewTempPacket();
+    void RecycleTempPacket(VADataPacket *packet);
+
+    // how long GetOutput() waits for a result while all the inference requests are busy, m_stop is checked in between
+    static const uint32_t OUTPUT_TIMEOUT_US = 10000;
+    // period the inputs are polled with while requests are in flight or a partial batch waits
+    static const int32_t INPUT_POLL_US = 500;
 
     uint32_t m_index;
     InferenceModelType m_type;
@@ -73,11 +118,21 @@ protected:
     uint32_t m_modelInputReshapeWidth;
     uint32_t m_modelInputReshapeHeight;
     float m_confidenceThreshold;
+    float m_nmsIoUThreshold;
+    bool m_nmsCrossClass;
+    uint32_t m_topK;
+    bool m_softmax;
+    uint32_t m_frameWidth;
+    uint32_t m_frameHeight;
+    uint32_t m_tileOverlap;
     int m_outRef;
+    uint32_t m_maxBatchDelayUs;
     const char *m_device;
+    const char *m_cacheDir;
     const char *m_modelFile;
     const char *m_weightsFile;
     InferenceBlock *m_infer;
+    VATrackClasses *m_trackClasses;
 
     // A, B, C, D, E
     // insert A for inference
@@ -85,6 +140,19 @@ protected:
     // then B, C, D are pending IDs of A, because B, C, D can only be sent to next block after A is ready
     std::map<uint64_t, std::vector<uint64_t>> m_pendingIDs;
     uint64_t m_lastInferID;
+    // the packets under inference by id, and the ids with results in submission order
+    std::map<uint64_t, VADataPacket *> m_recordedPackets;
+    std::queue<uint64_t> m_hasOutputs;
+    bool m_needInput;
 
     bool m_enableSharing;
+    bool m_zeroCopy;
+
+    std::vector<VADataPacket *> m_freePackets;
+    // input packets taken together by AcquireInputs
+    std::vector<VADataPacket *> m_inPackets;
+    // packets with results, in sending order, and the output packets taken together by DequeueOutputs
+    std::vector<VADataPacket *> m_sendPackets;
+    std::vector<VADataPacket *> m_outPackets;
+    size_t m_sentNum;
 };
\ No newline at end of file
@@ -0,0 +1,810 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Elements and their properties:
+//
+// filesrc   location=file loop=false
+// decode    codec=264|265 ref vp_ref vp_ratio vp_width vp_height
+//           vp_format=nv12|rgbp|rgb4 scale=hq|fast_inplace|fast
+//           with_vp=true dump=false va_share=false batch
+// infer     type=ssd|yolo|resnet|sisr|rcan model=path_without_extension
+//           device=GPU batch nireq streams conf ref width height va_share=false zero_copy=false
+//           batch_delay (ms) cache_dir nms_iou nms_cross_class=false
+//           topk=1 softmax=false frame_width frame_height tile_overlap=16
+// crop      width=224 height=224 format=nv12|rgbp|rgb4 mode=hq|fast
+//           keep_ratio=false va_share=false va_sync=false dump=false batch
+// track     interval=30 conf_drop=0.2 iou=0.3 max_age=5, the resnet blocks
+//           after it learn the classes of its tracks; one instance, the queue
+//           before it is a reorder queue (the default there)
+// queue     type=rr|lockfree|dispatch|reorder buffers=10
+//           policy=channel|least|p2c|sticky spill=4 (dispatch only)
+//           window=16 timeout=200 (reorder only, timeout in ms)
+// fakesink
+// csvsink   location=output.csv, a name with the index like output.%02d.csv
+//           (one %d, %u or %0Nd, %% for a %) with more than one block before the sink
+//
+// decode, infer, crop and track also take
+//           count=1 name=<thread name prefix> affinity=cpus[@node]
+//           sched=other|fifo|rr[:priority]
+// A property that is not given keeps the default of the block.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <sched.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "PipelineBuilder.h"
+#include "ConnectorRR.h"
+#include "ConnectorLockFree.h"
+#include "ConnectorDispatch.h"
+#include "ConnectorReorder.h"
+#include "CropThreadBlock.h"
+#include "DecodeThreadBlock.h"
+#include "InferenceThreadBlock.h"
+#include "TrackerThreadBlock.h"
+#include "logs.h"
+
+static const uint32_t default_queue_buffers = 10;
+static const uint32_t default_crop_width = 224;
+static const uint32_t default_crop_height = 224;
+
+bool PipelineBuilder::Element::Has(const char *key)
+{
+    return props.find(key) != props.end();
+}
+
+std::string PipelineBuilder::Element::GetString(const char *key, const char *def)
+{
+    used.insert(key);
+    auto ite = props.find(key);
+    return (ite == props.end()) ? def : ite->second;
+}
+
+int PipelineBuilder::Element::GetInt(const char *key, int def)
+{
+    used.insert(key);
+    auto ite = props.find(key);
+    if (ite == props.end())
+        return def;
+
+    char *end = nullptr;
+    long value = strtol(ite->second.c_str(), &end, 0);
+    if (ite->second.empty() || *end != '\0')
+    {
+        ERRLOG("%s: %s=%s is not an integer", name.c_str(), key, ite->second.c_str());
+        invalid = true;
+        return def;
+    }
+    return (int)value;
+}
+
+float PipelineBuilder::Element::GetFloat(const char *key, float def)
+{
+    used.insert(key);
+    auto ite = props.find(key);
+    if (ite == props.end())
+        return def;
+
+    char *end = nullptr;
+    float value = strtof(ite->second.c_str(), &end);
+    if (ite->second.empty() || *end != '\0')
+    {
+        ERRLOG("%s: %s=%s is not a number", name.c_str(), key, ite->second.c_str());
+        invalid = true;
+        return def;
+    }
+    return value;
+}
+
+bool PipelineBuilder::Element::GetBool(const char *key, bool def)
+{
+    used.insert(key);
+    auto ite = props.find(key);
+    if (ite == props.end())
+        return def;
+
+    const std::string &value = ite->second;
+    if (value == "true" || value == "1")
+        return true;
+    if (value == "false" || value == "0")
+        return false;
+    ERRLOG("%s: %s=%s is not a boolean", name.c_str(), key, value.c_str());
+    invalid = true;
+    return def;
+}
+
+int PipelineBuilder::Element::CheckUnused()
+{
+    int ret = invalid ? -1 : 0;
+    for (auto ite = props.begin(); ite != props.end(); ite ++)
+    {
+        if (used.find(ite->first) == used.end())
+        {
+            ERRLOG("%s: unknown property %s", name.c_str(), ite->first.c_str());
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+static int ParseFourcc(const std::string &format, uint32_t *fourcc)
+{
+    if (format == "nv12")
+        *fourcc = MFX_FOURCC_NV12;
+    else if (format == "rgbp")
+        *fourcc = MFX_FOURCC_RGBP;
+    else if (format == "rgb4")
+        *fourcc = MFX_FOURCC_RGB4;
+    else
+        return -1;
+    return 0;
+}
+
+// replaces the only %d, %u or %0Nd of the location by the index and %% by %, returns how many
+// indexes were written, -1 on any other conversion, the location isn't given to printf
+static int FormatLocation(const std::string &location, uint32_t index, std::string &name)
+{
+    int indexes = 0;
+    name.clear();
+    for (size_t i = 0; i < location.size(); i++)
+    {
+        if (location[i] != '%')
+        {
+            name += location[i];
+            continue;
+        }
+        if (++ i < location.size() && location[i] == '%')
+        {
+            name += '%';
+            continue;
+        }
+        bool zero = i < location.size() && location[i] == '0';
+        uint32_t width = 0;
+        for (; i < location.size() && isdigit(location[i]) && width < 100; i++)
+        {
+            width = width * 10 + (location[i] - '0');
+        }
+        if (i == location.size() || (location[i] != 'd' && location[i] != 'u') || width >= 100 || ++ indexes > 1)
+        {
+            return -1;
+        }
+        std::string digits = std::to_string(index);
+        if (digits.size() < width)
+        {
+            name.append(width - digits.size(), zero ? '0' : ' ');
+        }
+        name += digits;
+    }
+    return indexes;
+}
+
+static bool IsBlock(const std::string &name)
+{
+    return name == "decode" || name == "infer" || name == "crop" || name == "track";
+}
+
+PipelineBuilder::PipelineBuilder():
+    m_decodeWidth(0),
+    m_decodeHeight(0)
+{
+}
+
+PipelineBuilder::~PipelineBuilder()
+{
+    // the blocks use the pins, and the connectors own the pins they created
+    m_blocks.clear();
+    m_pins.clear();
+    m_connectors.clear();
+}
+
+int PipelineBuilder::ParseFile(const char *filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        ERRLOG("can't open the pipeline description %s", filename);
+        return -1;
+    }
+    std::stringstream description;
+    description << file.rdbuf();
+    return Parse(description.str());
+}
+
+int PipelineBuilder::Parse(const std::string &description)
+{
+    // drop the comments, new lines are plain spaces
+    std::string text;
+    bool comment = false;
+    for (auto ite = description.begin(); ite != description.end(); ite ++)
+    {
+        if (*ite == '#')
+            comment = true;
+        else if (*ite == '\n')
+            comment = false;
+        if (!comment)
+            text.push_back((*ite == '\n') ? ' ' : *ite);
+    }
+
+    m_elements.clear();
+    std::stringstream elements(text);
+    std::string desc;
+    while (std::getline(elements, desc, '!'))
+    {
+        std::stringstream tokens(desc);
+        std::string token;
+        Element e;
+        if (!(tokens >> e.name))
+        {
+            ERRLOG("empty element in the pipeline description");
+            return -1;
+        }
+        while (tokens >> token)
+        {
+            size_t equal = token.find('=');
+            if (equal == std::string::npos || equal == 0)
+            {
+                ERRLOG("%s: expect key=value, got %s", e.name.c_str(), token.c_str());
+                return -1;
+            }
+            e.props[token.substr(0, equal)] = token.substr(equal + 1);
+        }
+        m_elements.push_back(e);
+    }
+    return 0;
+}
+
+int PipelineBuilder::Build()
+{
+    if (m_elements.size() < 3 || m_elements.front().name != "filesrc" ||
+        (m_elements.back().name != "fakesink" && m_elements.back().name != "csvsink"))
+    {
+        ERRLOG("a pipeline goes from a filesrc to a fakesink or csvsink through one or more blocks");
+        return -1;
+    }
+
+    // blocks[i] and blocks[i+1] are joined by queues[i]
+    std::vector<Element *> blocks;
+    std::vector<Element *> queues;
+    Element defaultQueue;
+    defaultQueue.name = "queue";
+    for (size_t i = 1; i + 1 < m_elements.size(); i++)
+    {
+        Element &e = m_elements[i];
+        if (IsBlock(e.name))
+        {
+            if (!blocks.empty() && queues.size() < blocks.size())
+                queues.push_back(&defaultQueue);
+            blocks.push_back(&e);
+        }
+        else if (e.name == "queue")
+        {
+            if (blocks.empty() || queues.size() == blocks.size() || i + 2 == m_elements.size())
+            {
+                ERRLOG("a queue goes between two blocks");
+                return -1;
+            }
+            queues.push_back(&e);
+        }
+        else
+        {
+            ERRLOG("unknown element %s", e.name.c_str());
+            return -1;
+        }
+    }
+    if (blocks.empty())
+    {
+        ERRLOG("the pipeline has no block");
+        return -1;
+    }
+
+    std::vector<uint32_t> counts;
+    for (auto ite = blocks.begin(); ite != blocks.end(); ite ++)
+    {
+        int count = (*ite)->GetInt("count", 1);
+        if (count <= 0)
+        {
+            ERRLOG("%s: count must be positive", (*ite)->name.c_str());
+            return -1;
+        }
+        counts.push_back(count);
+    }
+
+    // a tracker sees all the frames of the channels, in order
+    Element reorderQueue;
+    reorderQueue.name = "queue";
+    reorderQueue.props["type"] = "reorder";
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        if (blocks[i]->name != "track")
+            continue;
+        if (counts[i] != 1)
+        {
+            ERRLOG("track: count must be 1, one tracker sees all the frames of a channel");
+            return -1;
+        }
+        if (i == 0)
+            continue;
+        if (queues[i - 1] == &defaultQueue)
+        {
+            queues[i - 1] = &reorderQueue;
+        }
+        else if (queues[i - 1]->GetString("type", "rr") != "reorder")
+        {
+            ERRLOG("track: the queue before it must be type=reorder");
+            return -1;
+        }
+    }
+
+    std::vector<VAConnector *> connectors;
+    for (size_t i = 0; i < queues.size(); i++)
+    {
+        VAConnector *connector = BuildConnector(*queues[i], counts[i], counts[i + 1]);
+        if (!connector)
+            return -1;
+        connectors.push_back(connector);
+    }
+
+    Element &source = m_elements.front();
+    Element &sink = m_elements.back();
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        for (uint32_t j = 0; j < counts[i]; j++)
+        {
+            VAConnectorPin *input = (i == 0) ? BuildSource(source) : connectors[i - 1]->NewOutputPin();
+            VAConnectorPin *output = (i + 1 == blocks.size()) ? BuildSink(sink, j) : connectors[i]->NewInputPin();
+            if (!input || !output)
+                return -1;
+            if (BuildBlock(*blocks[i], input, output, j))
+                return -1;
+        }
+    }
+    return 0;
+}
+
+VAConnectorPin *PipelineBuilder::BuildSource(Element &source)
+{
+    std::string location = source.GetString("location", "");
+    bool loop = source.GetBool("loop", false);
+    if (source.CheckUnused())
+        return nullptr;
+    if (location.empty())
+    {
+        ERRLOG("filesrc: missing location");
+        return nullptr;
+    }
+
+    try
+    {
+        m_pins.push_back(std::unique_ptr<VAConnectorPin>(new VAFilePin(location.c_str(), loop)));
+    }
+    catch (std::exception &e)
+    {
+        return nullptr;
+    }
+    return m_pins.back().get();
+}
+
+VAConnector *PipelineBuilder::BuildConnector(Element &queue, uint32_t inputs, uint32_t outputs)
+{
+    std::string type = queue.GetString("type", "rr");
+    int buffers = queue.GetInt("buffers", default_queue_buffers);
+    VA_DISPATCH_POLICY policy = VA_DISPATCH_CHANNEL;
+    int spill = VAConnectorDispatch::DEFAULT_SPILL_DEPTH;
+    if (type == "dispatch")
+    {
+        std::string name = queue.GetString("policy", "channel");
+        if (name == "channel")
+            policy = VA_DISPATCH_CHANNEL;
+        else if (name == "least")
+            policy = VA_DISPATCH_LEAST_DEPTH;
+        else if (name == "p2c")
+            policy = VA_DISPATCH_TWO_CHOICES;
+        else if (name == "sticky")
+            policy = VA_DISPATCH_STICKY;
+        else
+        {
+            ERRLOG("queue: unknown dispatch policy %s", name.c_str());
+            return nullptr;
+        }
+        spill = queue.GetInt("spill", spill);
+    }
+    int window = VAConnectorReorder::DEFAULT_WINDOW;
+    int timeout = VAConnectorReorder::DEFAULT_TIMEOUT_MS;
+    if (type == "reorder")
+    {
+        window = queue.GetInt("window", window);
+        timeout = queue.GetInt("timeout", timeout);
+    }
+    if (queue.CheckUnused())
+        return nullptr;
+    if (buffers <= 0 || spill < 0 || window <= 0 || timeout < 0)
+    {
+        ERRLOG("queue: buffers and window must be positive, spill and timeout not negative");
+        return nullptr;
+    }
+
+    VAConnector *connector = nullptr;
+    if (type == "rr")
+        connector = new VAConnectorRR(inputs, outputs, buffers);
+    else if (type == "lockfree")
+        connector = new VAConnectorLockFree(inputs, outputs, buffers);
+    else if (type == "dispatch")
+    {
+        VAConnectorDispatch *dispatch = new VAConnectorDispatch(inputs, outputs, buffers);
+        dispatch->SetPolicy(policy, spill);
+        connector = dispatch;
+    }
+    else if (type == "reorder")
+        connector = new VAConnectorReorder(inputs, outputs, buffers, window, timeout);
+    else
+    {
+        ERRLOG("queue: unknown type %s", type.c_str());
+        return nullptr;
+    }
+    m_connectors.push_back(std::unique_ptr<VAConnector>(connector));
+    return connector;
+}
+
+VAConnectorPin *PipelineBuilder::BuildSink(Element &sink, uint32_t index)
+{
+    if (sink.name == "fakesink")
+    {
+        if (sink.CheckUnused())
+            return nullptr;
+        m_pins.push_back(std::unique_ptr<VAConnectorPin>(new VASinkPin()));
+        return m_pins.back().get();
+    }
+
+    std::string location = sink.GetString("location", "output.csv");
+    if (sink.CheckUnused())
+        return nullptr;
+
+    std::string filename;
+    int indexes = FormatLocation(location, index, filename);
+    if (indexes < 0)
+    {
+        ERRLOG("csvsink: %s may only hold one %%d, %%u or %%0Nd, and %%%% for a %%", location.c_str());
+        return nullptr;
+    }
+    if (indexes == 0 && index > 0)
+    {
+        ERRLOG("csvsink: several blocks write to %s, use a format like output.%%02d.csv", location.c_str());
+        return nullptr;
+    }
+
+    try
+    {
+        m_pins.push_back(std::unique_ptr<VAConnectorPin>(new VACsvWriterPin(filename.c_str())));
+    }
+    catch (std::exception &e)
+    {
+        return nullptr;
+    }
+    return m_pins.back().get();
+}
+
+int PipelineBuilder::BuildBlock(Element &e, VAConnectorPin *input, VAConnectorPin *output, uint32_t index)
+{
+    VAThreadBlock *block = nullptr;
+    if (e.name == "decode")
+        block = CreateDecode(e, index);
+    else if (e.name == "infer")
+        block = CreateInfer(e, index);
+    else if (e.name == "track")
+        block = CreateTrack(e, index);
+    else
+        block = CreateCrop(e, index);
+    if (!block)
+        return -1;
+    m_blocks.push_back(std::unique_ptr<VAThreadBlock>(block));
+
+    block->ConnectInput(input);
+    block->ConnectOutput(output);
+    if (ApplyPlacement(e, block, index) || e.CheckUnused())
+        return -1;
+
+    int ret = block->Prepare();
+    if (ret)
+    {
+        ERRLOG("%s: prepare failed with %d", block->Name(), ret);
+        return ret;
+    }
+
+    if (e.name == "decode")
+    {
+        static_cast<DecodeThreadBlock *>(block)->GetDecodeResolution(&m_decodeWidth, &m_decodeHeight);
+        if (m_decodeWidth == 0 || m_decodeHeight == 0)
+        {
+            ERRLOG("%s: invalid decoding resolution", block->Name());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+VAThreadBlock *PipelineBuilder::CreateDecode(Element &e, uint32_t index)
+{
+    DecodeThreadBlock *dec = new DecodeThreadBlock(index);
+
+    std::string codec = e.GetString("codec", "264");
+    if (codec == "264")
+        dec->SetCodecType(MFX_CODEC_AVC);
+    else if (codec == "265")
+        dec->SetCodecType(MFX_CODEC_HEVC);
+    else
+    {
+        ERRLOG("decode: unknown codec %s", codec.c_str());
+        e.invalid = true;
+    }
+
+    if (e.Has("ref"))
+        dec->SetDecodeOutputRef(e.GetInt("ref", 1));
+    if (e.Has("vp_ref"))
+        dec->SetVPOutputRef(e.GetInt("vp_ref", 1));
+    if (e.Has("vp_ratio"))
+        dec->SetVPRatio(e.GetInt("vp_ratio", 1));
+    if (e.Has("vp_width") || e.Has("vp_height"))
+        dec->SetVPOutResolution(e.GetInt("vp_width", 0), e.GetInt("vp_height", 0));
+    if (e.Has("batch"))
+        dec->SetBatchSize(e.GetInt("batch", 1));
+    dec->SetDecodeOutputWithVP(e.GetBool("with_vp", true));
+    dec->SetVPOutDump(e.GetBool("dump", false));
+
+    std::string scale = e.GetString("scale", "fast");
+    if (scale == "hq" || scale == "fast")
+    {
+        dec->SetDecPostProc(false);
+        dec->SetFilterFlag(scale == "hq" ? 1 : 0);
+    }
+    else if (scale == "fast_inplace")
+    {
+        dec->SetDecPostProc(true);
+    }
+    else
+    {
+        ERRLOG("decode: unknown scale %s", scale.c_str());
+        e.invalid = true;
+    }
+
+    if (e.GetBool("va_share", false))
+    {
+        dec->SetVPOutFormat(MFX_FOURCC_NV12);
+        dec->SetVPMemOutTypeVideo(true);
+    }
+    if (e.Has("vp_format"))
+    {
+        uint32_t fourcc = 0;
+        if (ParseFourcc(e.GetString("vp_format", ""), &fourcc))
+        {
+            ERRLOG("decode: unknown vp_format %s", e.GetString("vp_format", "").c_str());
+            e.invalid = true;
+        }
+        else
+        {
+            dec->SetVPOutFormat(fourcc);
+        }
+    }
+    return dec;
+}
+
+VAThreadBlock *PipelineBuilder::CreateInfer(Element &e, uint32_t index)
+{
+    std::string type = e.GetString("type", "");
+    InferenceModelType modelType;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (type == "ssd")
+    {
+        modelType = MOBILENET_SSD_U8;
+        width = 300;
+        height = 300;
+    }
+    else if (type == "yolo")
+    {
+        modelType = YOLO;
+        width = 416;
+        height = 416;
+    }
+    else if (type == "resnet")
+        modelType = RESNET_50;
+    else if (type == "sisr")
+        modelType = SISR;
+    else if (type == "rcan")
+        modelType = RCAN;
+    else
+    {
+        ERRLOG("infer: unknown type '%s'", type.c_str());
+        return nullptr;
+    }
+
+    std::string model = e.GetString("model", "");
+    if (model.empty())
+    {
+        ERRLOG("infer: missing model");
+        return nullptr;
+    }
+
+    InferenceThreadBlock *infer = new InferenceThreadBlock(index, modelType);
+    m_strings.push_back(model + ".xml");
+    const char *modelFile = m_strings.back().c_str();
+    m_strings.push_back(model + ".bin");
+    infer->SetModelFile(modelFile, m_strings.back().c_str());
+    m_strings.push_back(e.GetString("device", "GPU"));
+    infer->SetDevice(m_strings.back().c_str());
+    if (e.Has("cache_dir"))
+    {
+        m_strings.push_back(e.GetString("cache_dir", ""));
+        infer->SetCacheDir(m_strings.back().c_str());
+    }
+
+    if (e.Has("batch"))
+        infer->SetBatchNum(e.GetInt("batch", 1));
+    if (e.Has("nireq"))
+        infer->SetAsyncDepth(e.GetInt("nireq", 1));
+    if (e.Has("streams"))
+        infer->SetStreamNum(e.GetInt("streams", 0));
+    if (e.Has("conf"))
+        infer->SetConfidenceThreshold(e.GetFloat("conf", 0.8));
+    if (e.Has("nms_iou") || e.Has("nms_cross_class"))
+        infer->SetNMS(e.GetFloat("nms_iou", 0), e.GetBool("nms_cross_class", false));
+    if (e.Has("topk") || e.Has("softmax"))
+        infer->SetTopK(e.GetInt("topk", 1), e.GetBool("softmax", false));
+    if (modelType == RESNET_50 && m_trackClasses)
+        infer->SetTrackClasses(m_trackClasses.get());
+    if (e.Has("frame_width") || e.Has("frame_height"))
+        infer->SetTiling(e.GetInt("frame_width", 0), e.GetInt("frame_height", 0), e.GetInt("tile_overlap", 16));
+    if (e.Has("ref"))
+        infer->SetOutputRef(e.GetInt("ref", 1));
+    if (e.Has("batch_delay"))
+        infer->SetMaxBatchDelay((uint32_t)(e.GetFloat("batch_delay", 0) * 1000));
+    infer->SetModelInputReshapeWidth(e.GetInt("width", width));
+    infer->SetModelInputReshapeHeight(e.GetInt("height", height));
+    if (e.GetBool("va_share", false))
+        infer->EnabelSharingWithVA();
+    if (e.GetBool("zero_copy", false))
+        infer->EnableZeroCopy();
+    return infer;
+}
+
+VAThreadBlock *PipelineBuilder::CreateTrack(Element &e, uint32_t index)
+{
+    if (m_decodeWidth == 0 || m_decodeHeight == 0)
+    {
+        ERRLOG("track: needs a decode block before it");
+        return nullptr;
+    }
+    // the instances share the track ids and classes
+    if (!m_trackClasses)
+        m_trackClasses = std::make_unique<VATrackClasses>();
+
+    TrackerThreadBlock *track = new TrackerThreadBlock(index, m_trackClasses.get());
+    track->SetInputResolution(m_decodeWidth, m_decodeHeight);
+    if (e.Has("interval"))
+        track->SetClassifyInterval(e.GetInt("interval", 30));
+    if (e.Has("conf_drop"))
+        track->SetConfidenceDrop(e.GetFloat("conf_drop", 0.2));
+    if (e.Has("iou"))
+        track->SetIoUThreshold(e.GetFloat("iou", 0.3));
+    if (e.Has("max_age"))
+        track->SetMaxAge(e.GetInt("max_age", 5));
+    return track;
+}
+
+VAThreadBlock *PipelineBuilder::CreateCrop(Element &e, uint32_t index)
+{
+    if (m_decodeWidth == 0 || m_decodeHeight == 0)
+    {
+        ERRLOG("crop: needs a decode block before it");
+        return nullptr;
+    }
+
+    CropThreadBlock *crop = new CropThreadBlock(index);
+    crop->SetInputResolution(m_decodeWidth, m_decodeHeight);
+    crop->SetOutResolution(e.GetInt("width", default_crop_width), e.GetInt("height", default_crop_height));
+    if (e.Has("batch"))
+        crop->SetBatchSize(e.GetInt("batch", 1));
+    crop->SetKeepAspectRatioFlag(e.GetBool("keep_ratio", false));
+    crop->SetVASync(e.GetBool("va_sync", false));
+    crop->SetOutDump(e.GetBool("dump", false));
+
+    std::string mode = e.GetString("mode", "fast");
+    if (mode == "hq" || mode == "fast")
+    {
+        crop->SetPipeFlag(mode == "hq" ? 1 : 0);
+    }
+    else
+    {
+        ERRLOG("crop: unknown mode %s", mode.c_str());
+        e.invalid = true;
+    }
+
+    if (e.GetBool("va_share", false))
+    {
+        crop->SetOutFormat(MFX_FOURCC_NV12);
+        crop->SetVPMemOutTypeVideo(true);
+    }
+    if (e.Has("format"))
+    {
+        uint32_t fourcc = 0;
+        if (ParseFourcc(e.GetString("format", ""), &fourcc))
+        {
+            ERRLOG("crop: unknown format %s", e.GetString("format", "").c_str());
+            e.invalid = true;
+        }
+        else
+        {
+            crop->SetOutFormat(fourcc);
+        }
+    }
+    return crop;
+}
+
+// affinity=cpus[@node] sched=other|fifo|rr[:priority]
+int PipelineBuilder::ApplyPlacement(Element &e, VAThreadBlock *block, uint32_t index)
+{
+    std::string prefix = e.GetString("name", e.name == "infer" ? e.GetString("type", "").c_str() : e.name.c_str());
+    char name[16];
+    snprintf(name, sizeof(name), "%s%d", prefix.c_str(), index);
+    block->SetName(name);
+
+    if (e.Has("affinity"))
+    {
+        std::string cpus = e.GetString("affinity", "");
+        size_t at = cpus.find('@');
+        if (at != std::string::npos)
+        {
+            char *end = nullptr;
+            std::string node = cpus.substr(at + 1);
+            long value = strtol(node.c_str(), &end, 10);
+            if (node.empty() || *end != '\0' || value < 0)
+            {
+                ERRLOG("%s: invalid numa node in affinity=%s", e.name.c_str(), cpus.c_str());
+                return -1;
+            }
+            block->SetNumaNode(value);
+            cpus = cpus.substr(0, at);
+        }
+        std::vector<int> cpuList;
+        if (VAThreadBlock::ParseCpuList(cpus.c_str(), cpuList))
+        {
+            ERRLOG("%s: invalid cpu list in affinity=%s", e.name.c_str(), cpus.c_str());
+            return -1;
+        }
+        block->SetCpus(cpuList);
+    }
+
+    if (e.Has("sched"))
+    {
+        std::string sched = e.GetString("sched", "");
+        int policy, priority;
+        if (VAThreadBlock::ParseSchedPolicy(sched, &policy, &priority))
+        {
+            ERRLOG("%s: invalid sched=%s, other|fifo|rr with a priority in the range of the policy", e.name.c_str(), sched.c_str());
+            return -1;
+        }
+        block->SetSchedPolicy(policy, priority);
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _PIPELINE_BUILDER_H_
+#define _PIPELINE_BUILDER_H_
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ThreadBlock.h"
+#include "Connector.h"
+
+class VATrackClasses;
+
+// Builds a pipeline from a gst-launch like description, e.g.
+//
+//   filesrc location=input.264
+//   ! decode count=4 codec=264 vp_width=300 vp_height=300 affinity=0-3@0
+//   ! queue buffers=10 type=lockfree
+//   ! infer type=ssd model=/path/ssd_mobilenet batch=1 nireq=2 count=2
+//   ! queue buffers=10
+//   ! crop width=224 height=224
+//   ! queue
+//   ! infer type=resnet model=/path/resnet-50
+//   ! csvsink location=output.%02d.csv
+//
+// Every element between two '!' is a stage with 'count' instances of a block.
+// Consecutive blocks are joined by one connector ('queue' can be omitted, it
+// then gets the default properties). The source feeds each instance of the
+// first block and the sink takes the output of each instance of the last one.
+// '#' starts a comment, new lines are spaces. See PipelineBuilder.cpp for the
+// properties of each element.
+class PipelineBuilder
+{
+public:
+    PipelineBuilder();
+    ~PipelineBuilder();
+
+    PipelineBuilder(const PipelineBuilder&) = delete;
+    PipelineBuilder& operator=(const PipelineBuilder&) = delete;
+
+    int ParseFile(const char *filename);
+    int Parse(const std::string &description);
+
+    // create, connect and prepare all the blocks, they are then started with VAThreadBlock::RunAllThreads()
+    int Build();
+
+    inline uint32_t BlockNum() {return m_blocks.size(); }
+
+protected:
+    struct Element
+    {
+        std::string name;
+        std::map<std::string, std::string> props;
+        std::set<std::string> used;
+        // a value could not be parsed, reported by CheckUnused()
+        bool invalid = false;
+
+        bool Has(const char *key);
+        std::string GetString(const char *key, const char *def);
+        int GetInt(const char *key, int def);
+        float GetFloat(const char *key, float def);
+        bool GetBool(const char *key, bool def);
+        // fails on an invalid value or a property that was never read, a typo or not supported by this element
+        int CheckUnused();
+    };
+
+    VAConnectorPin *BuildSource(Element &source);
+    VAConnector *BuildConnector(Element &queue, uint32_t inputs, uint32_t outputs);
+    VAConnectorPin *BuildSink(Element &sink, uint32_t index);
+    int BuildBlock(Element &e, VAConnectorPin *input, VAConnectorPin *output, uint32_t index);
+
+    VAThreadBlock *CreateDecode(Element &e, uint32_t index);
+    VAThreadBlock *CreateInfer(Element &e, uint32_t index);
+    VAThreadBlock *CreateCrop(Element &e, uint32_t index);
+    VAThreadBlock *CreateTrack(Element &e, uint32_t index);
+    int ApplyPlacement(Element &e, VAThreadBlock *block, uint32_t index);
+
+    std::vector<Element> m_elements;
+
+    // classes of the tracked objects, shared by the track and resnet blocks, outlives them
+    std::unique_ptr<VATrackClasses> m_trackClasses;
+
+    // kept in build order, the blocks are destroyed before the pins and connectors they use
+    std::vector<std::unique_ptr<VAConnector>> m_connectors;
+    std::vector<std::unique_ptr<VAConnectorPin>> m_pins;
+    std::vector<std::unique_ptr<VAThreadBlock>> m_blocks;
+    // file names and devices the blocks keep a pointer to
+    std::list<std::string> m_strings;
+
+    // decoding resolution, used as the input resolution of the crop blocks
+    uint32_t m_decodeWidth;
+    uint32_t m_decodeHeight;
+};
+
+#endif
@@ -0,0 +1,249 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TrackerThreadBlock.h"
+#include "logs.h"
+
+VATrackClasses::VATrackClasses():
+    m_ids(0)
+{
+}
+
+VATrackClasses::~VATrackClasses()
+{
+}
+
+void VATrackClasses::Add(uint32_t track)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_classes[track].num = 0;
+}
+
+void VATrackClasses::Remove(uint32_t track)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_classes.erase(track);
+}
+
+VAData *VATrackClasses::CreateClasses(uint32_t track)
+{
+    Classes classes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto ite = m_classes.find(track);
+        if (ite == m_classes.end() || ite->second.num == 0)
+        {
+            return nullptr;
+        }
+        classes = ite->second;
+    }
+    return VAData::Create(classes.c, classes.confidence, classes.num);
+}
+
+void VATrackClasses::Learn(VADataPacket *packet)
+{
+    // a packet holds one frame, the classes of a region have its roi index
+    for (auto ite = packet->begin(); ite != packet->end(); ite ++)
+    {
+        VAData *result = *ite;
+        if (result->Type() != IMAGENET_CLASS)
+        {
+            continue;
+        }
+        for (auto roiIte = packet->begin(); roiIte != packet->end(); roiIte ++)
+        {
+            VAData *roi = *roiIte;
+            if (roi->Type() != ROI_REGION || roi->RoiIndex() != result->RoiIndex())
+            {
+                continue;
+            }
+            // the classes attached by the tracker are already known
+            if (roi->TrackID() != 0 && roi->NeedsClassification())
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto known = m_classes.find(roi->TrackID());
+                if (known != m_classes.end())
+                {
+                    Classes &classes = known->second;
+                    classes.num = result->ClassNum();
+                    for (uint32_t k = 0; k < classes.num; k ++)
+                    {
+                        classes.c[k] = result->Class(k);
+                        classes.confidence[k] = result->Confidence(k);
+                    }
+                }
+            }
+            break;
+        }
+    }
+}
+
+TrackerThreadBlock::TrackerThreadBlock(uint32_t index, VATrackClasses *classes):
+    m_index(index),
+    m_classes(classes),
+    m_inputWidth(0),
+    m_inputHeight(0),
+    m_iouThreshold(0.3),
+    m_maxAge(5),
+    m_classifyInterval(30),
+    m_confidenceDrop(0.2),
+    m_stepOutput(nullptr),
+    m_roiNum(0),
+    m_classifiedNum(0)
+{
+}
+
+TrackerThreadBlock::~TrackerThreadBlock()
+{
+    if (m_roiNum)
+    {
+        INFO("Tracker %d: %lu regions, %lu classified (%.1f%%)", m_index, m_roiNum, m_classifiedNum,
+             100.0 * m_classifiedNum / m_roiNum);
+    }
+    for (auto ite = m_trackers.begin(); ite != m_trackers.end(); ite ++)
+    {
+        delete ite->second;
+    }
+}
+
+VAObjectTracker *TrackerThreadBlock::GetTracker(uint32_t channel)
+{
+    auto ite = m_trackers.find(channel);
+    if (ite != m_trackers.end())
+    {
+        return ite->second;
+    }
+    VAObjectTracker *tracker = new VAObjectTracker();
+    if (m_inputWidth != 0 && m_inputHeight != 0)
+    {
+        tracker->SetFrameSize(m_inputWidth, m_inputHeight);
+    }
+    tracker->SetIoUThreshold(m_iouThreshold);
+    tracker->SetMaxAge(m_maxAge);
+    tracker->SetIdSource(m_classes->Ids());
+    m_trackers[channel] = tracker;
+    return tracker;
+}
+
+int TrackerThreadBlock::Loop()
+{
+    return LoopSteps();
+}
+
+int TrackerThreadBlock::Step()
+{
+    TRACE("");
+    if (!m_stepOutput)
+    {
+        m_stepOutput = DequeueOutput();
+        if (!m_stepOutput)
+            return m_pooled ? VA_STEP_IDLE : VA_STEP_DONE;
+    }
+
+    VADataPacket *input = AcquireInput();
+    if (!input)
+        return m_pooled ? VA_STEP_IDLE : VA_STEP_DONE;
+
+    if (input->size() == 0)
+        return VA_STEP_DONE;
+
+    m_rois.clear();
+    m_rects.clear();
+    for (auto ite = input->begin(); ite != input->end(); ite++)
+    {
+        VAData *data = *ite;
+        if (data->Type() == ROI_REGION)
+        {
+            float l, t, r, b;
+            data->GetRoiRegion(&l, &t, &r, &b);
+            m_rects.push_back(l);
+            m_rects.push_back(t);
+            m_rects.push_back(r);
+            m_rects.push_back(b);
+            m_rois.push_back(data);
+        }
+    }
+
+    uint32_t count = m_rois.size();
+    m_roiNum += count;
+    // a frame without regions still ages the tracks, so the lost ones are dropped
+    VAData *first = *input->begin();
+    VAObjectTracker *tracker = GetTracker(first->ChannelIndex());
+    bool tracked = tracker->Update(first->FrameIndex(), m_rects.data(), count, m_tracks) == 0;
+    if (tracked)
+    {
+        for (uint32_t id : tracker->Dropped())
+        {
+            m_classes->Remove(id);
+        }
+    }
+    else
+    {
+        // out of order, the regions stay untracked and go to the classification
+        m_classifiedNum += count;
+    }
+
+    // the known classes follow their region
+    uint32_t roiIndex = 0;
+    for (auto ite = input->begin(); ite != input->end(); ite++)
+    {
+        VAData *data = *ite;
+        m_stepOutput->push_back(data);
+        if (!tracked || data->Type() != ROI_REGION)
+        {
+            continue;
+        }
+
+        VATrack *track = m_tracks[roiIndex ++];
+        uint32_t frame = data->FrameIndex();
+        float confidence = data->Confidence();
+        if (track->hits == 1)
+        {
+            m_classes->Add(track->id);
+        }
+        VAData *classes = nullptr;
+        if (!VAObjectTracker::ClassifyDue(track, frame, confidence, m_classifyInterval, m_confidenceDrop))
+        {
+            classes = m_classes->CreateClasses(track->id);
+        }
+        if (classes)
+        {
+            classes->SetID(data->ChannelIndex(), frame);
+            classes->SetRoiIndex(data->RoiIndex());
+            data->SetTrack(track->id, false);
+            m_stepOutput->push_back(classes);
+        }
+        else
+        {
+            // classified until the classification of the track comes back
+            data->SetTrack(track->id, true);
+            track->classifiedFrame = frame;
+            track->classifiedConfidence = confidence;
+            ++ m_classifiedNum;
+        }
+    }
+
+    ReleaseInput(input);
+    EnqueueOutput(m_stepOutput);
+    m_stepOutput = nullptr;
+    return VA_STEP_PROGRESS;
+}
@@ -0,0 +1,123 @@
+/*
+* Copyright (c) 2021, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _TRACKER_THREAD_BLOCK_H_
+#define _TRACKER_THREAD_BLOCK_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "ThreadBlock.h"
+#include "ObjectTracker.h"
+
+// Classes of the tracked objects, shared by the tracker blocks which attach them to the regions
+// they don't send to the classification, and the classification blocks which learn them.
+class VATrackClasses
+{
+public:
+    VATrackClasses();
+    ~VATrackClasses();
+
+    VATrackClasses(const VATrackClasses&) = delete;
+    VATrackClasses& operator=(const VATrackClasses&) = delete;
+
+    // ids of the new tracks of all the channels
+    inline std::atomic<uint32_t> *Ids() {return &m_ids; }
+
+    // a track is known from its creation to its drop, only the known tracks learn classes
+    void Add(uint32_t track);
+    void Remove(uint32_t track);
+
+    // a new IMAGENET_CLASS data with the classes of the track, nullptr before the track has any
+    VAData *CreateClasses(uint32_t track);
+
+    // takes the classes the classification found for the tracked regions of the packet
+    void Learn(VADataPacket *packet);
+
+protected:
+    struct Classes
+    {
+        int c[VA_MAX_TOP_CLASSES];
+        float confidence[VA_MAX_TOP_CLASSES];
+        uint32_t num;
+    };
+    std::mutex m_mutex;
+    std::map<uint32_t, Classes> m_classes;
+    std::atomic<uint32_t> m_ids;
+};
+
+// Tracks the regions of the detection per channel and marks the ones the classification can skip:
+// a region is classified when its track is new, every classify interval frames, when its confidence
+// dropped since the last classification, or while the classes of its track aren't known yet. The
+// skipped regions get the known classes of their track attached right away and are passed through
+// by the crop.
+// The frames of a channel must come in order, with a VAConnectorReorder in front of the block
+// when there are several detection blocks; a frame older than the last one isn't tracked.
+class TrackerThreadBlock : public VAThreadBlock
+{
+public:
+    TrackerThreadBlock(uint32_t index, VATrackClasses *classes);
+    ~TrackerThreadBlock();
+
+    TrackerThreadBlock(const TrackerThreadBlock&) = delete;
+    TrackerThreadBlock& operator=(const TrackerThreadBlock&) = delete;
+
+    int Loop();
+
+    bool CanStep() override {return true; }
+    int Step() override;
+
+    // the size of the decoded frames, the filter of the tracks runs in pixels
+    inline void SetInputResolution(uint32_t w, uint32_t h) {m_inputWidth = w; m_inputHeight = h; }
+    inline void SetIoUThreshold(float threshold) {m_iouThreshold = threshold; }
+    inline void SetMaxAge(uint32_t frames) {m_maxAge = frames; }
+    inline void SetClassifyInterval(uint32_t frames) {m_classifyInterval = frames; }
+    inline void SetConfidenceDrop(float drop) {m_confidenceDrop = drop; }
+
+protected:
+    VAObjectTracker *GetTracker(uint32_t channel);
+
+    uint32_t m_index;
+    VATrackClasses *m_classes;
+    uint32_t m_inputWidth;
+    uint32_t m_inputHeight;
+    float m_iouThreshold;
+    uint32_t m_maxAge;
+    uint32_t m_classifyInterval;
+    float m_confidenceDrop;
+
+    std::map<uint32_t, VAObjectTracker *> m_trackers;
+    VADataPacket *m_stepOutput;
+
+    // scratch of Step()
+    std::vector<VAData *> m_rois;
+    std::vector<float> m_rects;
+    std::vector<VATrack *> m_tracks;
+
+    uint64_t m_roiNum;
+    uint64_t m_classifiedNum;
+};
+
+#endif
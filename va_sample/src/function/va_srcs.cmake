@@ -48,6 +48,12 @@ set(ENCODE_SOURCES
 set(INFER_SOURCES
     ${INFER_SOURCES}
     ${CMAKE_CURRENT_LIST_DIR}/InferenceThreadBlock.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/TrackerThreadBlock.cpp
+    )
+
+set(PIPELINE_SOURCES
+    ${PIPELINE_SOURCES}
+    ${CMAKE_CURRENT_LIST_DIR}/PipelineBuilder.cpp
     )
 
 set(DISPLAY_SOURCES
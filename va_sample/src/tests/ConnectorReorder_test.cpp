@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Feeds VAConnectorReorder the way a pipeline with -r 3 and two detection blocks does:
+// only every third frame carries data, so the frame indices have gaps while the decoder
+// sequence doesn't, and the two producers finish the frames out of order, the later frame
+// of a pair often first. Checks every channel leaves in decoding order without waiting for
+// the timeout and without skipping, then that a packet really lost is skipped once.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "ConnectorReorder.h"
+
+static const uint32_t VP_RATIO = 3;
+
+static void StoreFrame(VAConnectorPin *pin, uint32_t channel, uint32_t sequence)
+{
+    VADataPacket *packet = pin->Get();
+    VAData *data = VAData::Create((int)sequence, 1.0f);
+    data->SetID(channel, (sequence - 1) * VP_RATIO);
+    data->SetSequence(sequence);
+    packet->push_back(data);
+    pin->Store(packet);
+}
+
+// reads num packets, returns the number out of order
+static uint32_t ReadInOrder(VAConnectorPin *pin, uint32_t num, std::vector<uint32_t> &next)
+{
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        VADataPacket *packet = pin->Get();
+        if (!packet)
+        {
+            printf("ERROR: %u packets missing\n", num - i);
+            return wrong + num - i;
+        }
+        VAData *data = packet->front();
+        uint32_t channel = data->ChannelIndex();
+        if (data->Sequence() < next[channel] || data->FrameIndex() != (data->Sequence() - 1) * VP_RATIO)
+            ++ wrong;
+        next[channel] = data->Sequence() + 1;
+        data->DeRef();
+        packet->clear();
+        pin->Store(packet);
+    }
+    return wrong;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t frames = 2000;
+    if (argc > 1)
+    {
+        frames = atoi(argv[1]);
+    }
+    if (frames < 10)
+    {
+        printf("Usage: %s [frame number, at least 10]\n", argv[0]);
+        return -1;
+    }
+    int ret = 0;
+    const uint32_t channels = 4;
+
+    // two producers finishing the frames of the channels out of order, a long timeout
+    // makes any wait for a frame that never comes show up as a slow run
+    {
+        VAConnectorReorder connector(2, 1, 16, VAConnectorReorder::DEFAULT_WINDOW, 10000);
+        VAConnectorPin *in[2] = {connector.NewInputPin(), connector.NewInputPin()};
+        VAConnectorPin *out = connector.NewOutputPin();
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> producers;
+        for (uint32_t p = 0; p < 2; p ++)
+        {
+            producers.emplace_back([&, p]() {
+                std::mt19937 rng(p + 1);
+                // producer p handles the pairs of frames sequence 2k+1 and 2k+2 of the channels
+                // p, p + 2..., storing the second one first half of the time
+                for (uint32_t s = 1; s + 1 <= frames; s += 2)
+                {
+                    for (uint32_t c = p; c < channels; c += 2)
+                    {
+                        bool swap = rng() & 1;
+                        StoreFrame(in[p], c, swap ? s + 1 : s);
+                        StoreFrame(in[p], c, swap ? s : s + 1);
+                    }
+                    if (rng() % 8 == 0)
+                        std::this_thread::yield();
+                }
+            });
+        }
+        std::vector<uint32_t> next(channels, 1);
+        uint32_t total = (frames / 2) * 2 * channels;
+        uint32_t wrong = ReadInOrder(out, total, next);
+        for (auto &t : producers)
+            t.join();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%u channels, %u packets with frame gaps of %u: %u out of order, %lu skipped, %.1f ms\n",
+               channels, total, VP_RATIO, wrong, connector.SkippedFrames(), ms);
+        if (wrong || connector.SkippedFrames() || ms > 5000)
+        {
+            printf("ERROR: the packets must leave in order without skip or timeout\n");
+            ret = -1;
+        }
+    }
+
+    // a packet lost upstream is given up after the timeout, the others keep their order
+    {
+        VAConnectorReorder connector(1, 1, 16, VAConnectorReorder::DEFAULT_WINDOW, 50);
+        VAConnectorPin *in = connector.NewInputPin();
+        VAConnectorPin *out = connector.NewOutputPin();
+        for (uint32_t s = 1; s <= 10; s ++)
+        {
+            if (s != 5)
+                StoreFrame(in, 0, s);
+        }
+        std::vector<uint32_t> next(1, 1);
+        uint32_t wrong = ReadInOrder(out, 9, next);
+        printf("lost packet: %u out of order, %lu skipped\n", wrong, connector.SkippedFrames());
+        if (wrong || connector.SkippedFrames() != 1)
+        {
+            printf("ERROR: exactly the lost packet must be skipped\n");
+            ret = -1;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Compares VADataPacket with the std::list it replaced on the per-frame path:
+// a block takes a recycled packet, pushes the surface and the ROIs of one frame,
+// walks it, copies it into the next packet and clears both.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <list>
+#include "DataPacket.h"
+
+typedef std::list<VAData *> ListPacket;
+
+template <typename Packet>
+static double RunFrames(uint32_t frames, uint32_t roiNum, uintptr_t *checksum)
+{
+    Packet in;
+    Packet out;
+    uintptr_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        for (uint32_t i = 0; i <= roiNum; i++)
+        {
+            in.push_back((VAData *)(uintptr_t)((f << 8) | i));
+        }
+        for (auto ite = in.begin(); ite != in.end(); ite++)
+        {
+            sum += (uintptr_t)*ite;
+        }
+        out.insert(out.end(), in.begin(), in.end());
+        sum += out.size();
+        in.clear();
+        out.clear();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    *checksum += sum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / frames;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t frames = 1000000;
+    if (argc > 1)
+    {
+        frames = atoi(argv[1]);
+    }
+    if (frames == 0)
+    {
+        printf("Usage: %s [frame number]\n", argv[0]);
+        return -1;
+    }
+
+    const uint32_t roiNums[] = {0, 4, 15, 64, 256};
+    uintptr_t checksum = 0;
+    printf("%8s %16s %16s\n", "rois", "std::list ns", "VADataPacket ns");
+    for (uint32_t i = 0; i < sizeof(roiNums)/sizeof(roiNums[0]); i++)
+    {
+        double listTime = RunFrames<ListPacket>(frames, roiNums[i], &checksum);
+        double packetTime = RunFrames<VADataPacket>(frames, roiNums[i], &checksum);
+        printf("%8u %16.1f %16.1f\n", roiNums[i], listTime, packetTime);
+    }
+    // keep the loops from being optimized away
+    printf("checksum %lu\n", (unsigned long)checksum);
+    return 0;
+}
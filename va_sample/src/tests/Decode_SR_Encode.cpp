@@ -40,10 +40,18 @@ std::string input_filename;
 std::string model_name;
 std::string infer_device = "GPU";
 std::string model_type = "RCAN";
+// frames larger than the model input are split in tiles
+uint32_t frame_w = 0;
+uint32_t frame_h = 0;
+uint32_t tile_overlap = 16;
+uint32_t infer_nireq = 1;
+uint32_t infer_batch = 1;
 
 void App_ShowUsage(void)
 {
     printf("Usage: TranscodeSR -i input.264 -m model_file -device [CPU, GPU (default)] -type [SISR, RCAN(default)]\n");
+    printf("                   [-frame WxH] [-overlap pixels (default: 16)] [-nireq n] [-batch n]\n");
+    printf("  -frame WxH    Upscale WxH frames in tiles of the model input size, blended over the overlap\n");
 }
 
 void ParseOpt(int argc, char *argv[])
@@ -74,6 +82,21 @@ void ParseOpt(int argc, char *argv[])
             infer_device = sources.at(++i);
         if (sources.at(i) == "-type")
             model_type = sources.at(++i);
+        if (sources.at(i) == "-frame")
+        {
+            if (sscanf(sources.at(++i).c_str(), "%ux%u", &frame_w, &frame_h) != 2)
+            {
+                printf("ERROR: invalid frame size %s\n", sources.at(i).c_str());
+                App_ShowUsage();
+                exit(0);
+            }
+        }
+        if (sources.at(i) == "-overlap")
+            tile_overlap = std::stoi(sources.at(++i));
+        if (sources.at(i) == "-nireq")
+            infer_nireq = std::stoi(sources.at(++i));
+        if (sources.at(i) == "-batch")
+            infer_batch = std::stoi(sources.at(++i));
     }
 
     if (input_filename.empty())
@@ -120,6 +143,14 @@ int main(int argc, char *argv[])
         out_h = 1080;
         infer_type = SISR;
     }
+    if (frame_w > 0 && frame_h > 0)
+    {
+        // the model input is a tile of the frame, the upscale ratio stays the same
+        out_w = frame_w * out_w / vpp_w;
+        out_h = frame_h * out_h / vpp_h;
+        vpp_w = frame_w;
+        vpp_h = frame_h;
+    }
     std::string model_xml = model_name + ".xml";
     std::string model_bin = model_name + ".bin";;
 
@@ -148,6 +179,12 @@ int main(int argc, char *argv[])
     infer->SetDevice(infer_device.c_str());
     infer->SetModelFile(model_xml.c_str(), model_bin.c_str());
     //infer->SetOutputResolution(w*4, h*4);
+    infer->SetAsyncDepth(infer_nireq);
+    infer->SetBatchNum(infer_batch);
+    if (frame_w > 0 && frame_h > 0)
+    {
+        infer->SetTiling(frame_w, frame_h, tile_overlap);
+    }
     CHECK_STATUS(infer->Prepare());
 
     e->ConnectInput(c2->NewOutputPin());
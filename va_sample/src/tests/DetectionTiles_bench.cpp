@@ -0,0 +1,230 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Slices a frame of small objects in the tiles of a detection model, as -dslice does, makes up the
+// boxes a detector would report in each tile, a whole box where the object is inside the tile and
+// a clipped box of lower confidence where most of it is, then feeds DetectionTiles in shuffled
+// order and checks the non maximum suppression leaves exactly one box per object, at its place,
+// and that a frame with a tile of a failed request is dropped once its other tiles are in.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "DetectionTiles.h"
+#include "NonMaxSuppression.h"
+
+struct SliceCase
+{
+    uint32_t frameWidth;
+    uint32_t frameHeight;
+    uint32_t tileWidth;
+    uint32_t tileHeight;
+    uint32_t overlap;
+};
+
+struct Object
+{
+    float left, top, right, bottom;
+    int32_t classId;
+    float confidence;
+};
+
+// objects of up to the overlap, on a jittered grid so they don't overlap each other
+static void MakeObjects(const SliceCase &sc, std::mt19937 &rng, std::vector<Object> &objects)
+{
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    uint32_t cell = sc.overlap * 2;
+    objects.clear();
+    for (uint32_t y = 0; y + cell <= sc.frameHeight; y += cell)
+    {
+        for (uint32_t x = 0; x + cell <= sc.frameWidth; x += cell)
+        {
+            float w = 8 + unit(rng) * (sc.overlap - 8);
+            float h = 8 + unit(rng) * (sc.overlap - 8);
+            float l = x + unit(rng) * (cell - w);
+            float t = y + unit(rng) * (cell - h);
+            objects.push_back({l, t, l + w, t + h, (int32_t)(rng() % 4), 0.6f + 0.4f * unit(rng)});
+        }
+    }
+}
+
+// the boxes of the objects seen in one tile, in the normalized coordinates of the tile
+static void DetectInTile(const SliceCase &sc, const std::vector<Object> &objects, uint32_t x0, uint32_t y0, VADetections &boxes)
+{
+    boxes.Clear();
+    float x1 = x0 + sc.tileWidth;
+    float y1 = y0 + sc.tileHeight;
+    for (const Object &o : objects)
+    {
+        float l = std::max(o.left, (float)x0);
+        float t = std::max(o.top, (float)y0);
+        float r = std::min(o.right, x1);
+        float b = std::min(o.bottom, y1);
+        if (r <= l || b <= t)
+            continue;
+        float visible = (r - l) * (b - t) / ((o.right - o.left) * (o.bottom - o.top));
+        if (visible < 0.6f)
+            continue;
+        float confidence = visible < 1.f ? o.confidence * visible * 0.9f : o.confidence;
+        boxes.Push((l - x0) / sc.tileWidth, (t - y0) / sc.tileHeight, (r - x0) / sc.tileWidth, (b - y0) / sc.tileHeight,
+                   o.classId, confidence);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t loops = 20;
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+    }
+    if (loops == 0)
+    {
+        printf("Usage: %s [loop number]\n", argv[0]);
+        return -1;
+    }
+
+    // ssd and yolo inputs on 1080p and 4k frames
+    const SliceCase cases[] = {
+        {1920, 1080, 300, 300, 32},
+        {1920, 1080, 416, 416, 32},
+        {3840, 2160, 416, 416, 48},
+    };
+    std::mt19937 rng(42);
+    NonMaxSuppression nms;
+    nms.SetIoUThreshold(0.5);
+    std::vector<uint32_t> keep;
+    double checksum = 0;
+    int ret = 0;
+
+    printf("%10s %8s %8s %6s %8s %10s %12s %12s\n", "frame", "tile", "overlap", "tiles", "objects", "boxes", "merge us", "object px");
+    for (const SliceCase &sc : cases)
+    {
+        TileGrid grid;
+        if (grid.Configure(sc.frameWidth, sc.frameHeight, sc.tileWidth, sc.tileHeight, sc.overlap))
+        {
+            ret = -1;
+            continue;
+        }
+        DetectionTiles tiles;
+        tiles.Configure(grid);
+
+        std::vector<Object> objects;
+        MakeObjects(sc, rng, objects);
+        std::vector<VADetections> tileBoxes(grid.TileNum());
+        size_t boxNum = 0;
+        for (uint32_t t = 0; t < grid.TileNum(); t ++)
+        {
+            uint32_t x, y;
+            grid.TileOrigin(t, &x, &y);
+            DetectInTile(sc, objects, x, y, tileBoxes[t]);
+            boxNum += tileBoxes[t].Size();
+        }
+
+        std::vector<uint32_t> order(grid.TileNum());
+        for (uint32_t t = 0; t < grid.TileNum(); t ++)
+            order[t] = t;
+        double mergeUs = 0;
+        for (uint32_t l = 0; l < loops; l ++)
+        {
+            std::shuffle(order.begin(), order.end(), rng);
+            VADetections *frameBoxes = nullptr;
+            uint32_t keepNum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t t : order)
+            {
+                frameBoxes = tiles.AddTile(0, l, 0, t, tileBoxes[t]);
+            }
+            if (frameBoxes)
+            {
+                keepNum = nms.Run(*frameBoxes, keep);
+            }
+            auto end = std::chrono::steady_clock::now();
+            mergeUs += std::chrono::duration<double, std::micro>(end - start).count();
+            if (!frameBoxes)
+            {
+                printf("ERROR: the frame isn't complete after its %u tiles\n", grid.TileNum());
+                ret = -1;
+                break;
+            }
+
+            // one box per object, where the object is
+            std::vector<uint32_t> found(objects.size(), 0);
+            for (uint32_t k = 0; k < keepNum; k ++)
+            {
+                uint32_t i = keep[k];
+                float cx = (frameBoxes->left[i] + frameBoxes->right[i]) * 0.5f * sc.frameWidth;
+                float cy = (frameBoxes->top[i] + frameBoxes->bottom[i]) * 0.5f * sc.frameHeight;
+                for (size_t o = 0; o < objects.size(); o ++)
+                {
+                    const Object &ob = objects[o];
+                    if (cx > ob.left && cx < ob.right && cy > ob.top && cy < ob.bottom)
+                    {
+                        if (fabsf(frameBoxes->left[i] * sc.frameWidth - ob.left) < 0.01f
+                            && fabsf(frameBoxes->bottom[i] * sc.frameHeight - ob.bottom) < 0.01f
+                            && frameBoxes->confidence[i] == ob.confidence)
+                            ++ found[o];
+                        else
+                            found[o] += 100;
+                    }
+                }
+                checksum += frameBoxes->confidence[i];
+            }
+            uint32_t wrong = 0;
+            for (size_t o = 0; o < objects.size(); o ++)
+                wrong += found[o] != 1;
+            if (wrong || keepNum != objects.size())
+            {
+                printf("ERROR: %u boxes kept for %zu objects, %u objects not found once\n", keepNum, objects.size(), wrong);
+                ret = -1;
+            }
+            tiles.Release(frameBoxes);
+        }
+
+        // a tile of a failed request first, the frame is dropped, its id can come again
+        uint32_t dropped = 0;
+        tiles.DropTile(0, loops, 0, 0);
+        for (uint32_t t = 1; t < grid.TileNum(); t ++)
+            dropped += tiles.AddTile(0, loops, 0, t, tileBoxes[t]) == nullptr;
+        VADetections *again = nullptr;
+        for (uint32_t t = 0; t < grid.TileNum(); t ++)
+            again = tiles.AddTile(0, loops, 0, t, tileBoxes[t]);
+        if (dropped + 1 != grid.TileNum() || !again || again->Size() != boxNum)
+        {
+            printf("ERROR: the frame with a failed tile isn't dropped\n");
+            ret = -1;
+        }
+        tiles.Release(again);
+
+        // how large the smallest object is at the model input, squeezed whole or sliced
+        float squeezed = 8.f * std::min((float)sc.tileWidth / sc.frameWidth, (float)sc.tileHeight / sc.frameHeight);
+        printf("%5ux%-4u %8u %8u %6u %8zu %10zu %12.2f %5.1f->%.0f\n", sc.frameWidth, sc.frameHeight, sc.tileWidth,
+               sc.overlap, grid.TileNum(), objects.size(), boxNum, mergeUs / loops, squeezed, 8.f);
+    }
+    // keep the loops from being optimized away
+    printf("checksum %f\n", checksum);
+    return ret;
+}
@@ -0,0 +1,174 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Compares the plane copy and the RGB4 to RGBP kernels of each instruction set the
+// CPU supports with the scalar ones, on a 1080p surface with a padded pitch and on
+// an odd sized one, and checks that they write the same output.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "ImageKernels.h"
+
+// the surfaces are 64 bytes aligned, as VA_SURFACE_ALIGNMENT
+static const uint32_t SURFACE_ALIGNMENT = 64;
+
+struct Frame
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+    uint8_t *nv12;
+    uint8_t *rgb4;
+};
+
+static uint8_t *AlignedAlloc(size_t size)
+{
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, SURFACE_ALIGNMENT, size))
+    {
+        return nullptr;
+    }
+    return (uint8_t *)ptr;
+}
+
+static double RunCopy(const Frame &frame, uint8_t *dst, uint32_t loops)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t l = 0; l < loops; l++)
+    {
+        VACopyPlane(dst, frame.width, frame.nv12, frame.pitch, frame.width, frame.height);
+        VACopyPlane(dst + frame.width * frame.height, frame.width, frame.nv12 + frame.pitch * frame.height,
+                    frame.pitch, frame.width, frame.height / 2);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / loops;
+}
+
+static double RunRGBP(const Frame &frame, uint8_t *dst, uint32_t loops)
+{
+    uint32_t planeSize = frame.width * frame.height;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t l = 0; l < loops; l++)
+    {
+        VABGRAToRGBP(dst, dst + planeSize, dst + 2 * planeSize, frame.width, frame.rgb4, frame.pitch * 4, frame.width, frame.height);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / loops;
+}
+
+static uint32_t Checksum(const uint8_t *data, size_t size)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        sum = sum * 31 + data[i];
+    }
+    return sum;
+}
+
+static int RunFrame(const Frame &frame, uint32_t loops, uint32_t *checksum)
+{
+    size_t nv12Size = (size_t)frame.width * frame.height * 3 / 2;
+    size_t rgbpSize = (size_t)frame.width * frame.height * 3;
+    uint8_t *refNV12 = AlignedAlloc(nv12Size);
+    uint8_t *refRGBP = AlignedAlloc(rgbpSize);
+    uint8_t *outNV12 = AlignedAlloc(nv12Size);
+    uint8_t *outRGBP = AlignedAlloc(rgbpSize);
+    int ret = 0;
+
+    printf("%ux%u pitch %u\n", frame.width, frame.height, frame.pitch);
+    printf("%8s %16s %16s\n", "isa", "nv12 copy us", "rgb4->rgbp us");
+    VASetImageIsa(VA_ISA_SCALAR);
+    double refCopy = RunCopy(frame, refNV12, loops);
+    double refRGBPTime = RunRGBP(frame, refRGBP, loops);
+    printf("%8s %16.1f %16.1f\n", VAImageIsaName(VA_ISA_SCALAR), refCopy, refRGBPTime);
+    *checksum += Checksum(refNV12, nv12Size) + Checksum(refRGBP, rgbpSize);
+
+    for (int isa = VA_ISA_SSE4; isa <= VA_ISA_AVX512; isa++)
+    {
+        if (VASetImageIsa((VA_IMAGE_ISA)isa))
+        {
+            printf("%8s %16s %16s\n", VAImageIsaName((VA_IMAGE_ISA)isa), "unsupported", "unsupported");
+            continue;
+        }
+        memset(outNV12, 0, nv12Size);
+        memset(outRGBP, 0, rgbpSize);
+        double copyTime = RunCopy(frame, outNV12, loops);
+        double rgbpTime = RunRGBP(frame, outRGBP, loops);
+        printf("%8s %16.1f %16.1f\n", VAImageIsaName((VA_IMAGE_ISA)isa), copyTime, rgbpTime);
+        if (memcmp(outNV12, refNV12, nv12Size) || memcmp(outRGBP, refRGBP, rgbpSize))
+        {
+            printf("ERROR: %s output differs from the scalar one\n", VAImageIsaName((VA_IMAGE_ISA)isa));
+            ret = -1;
+        }
+    }
+
+    free(refNV12);
+    free(refRGBP);
+    free(outNV12);
+    free(outRGBP);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t loops = 200;
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+    }
+    if (loops == 0)
+    {
+        printf("Usage: %s [loop number]\n", argv[0]);
+        return -1;
+    }
+
+    // a surface with a padded pitch, then an odd size for the tails and the unaligned loads
+    Frame frames[] = {{1920, 1080, 2048, nullptr, nullptr}, {1917, 541, 1931, nullptr, nullptr}};
+    VA_IMAGE_ISA best = VAGetImageIsa();
+    uint32_t checksum = 0;
+    int ret = 0;
+    for (uint32_t i = 0; i < sizeof(frames)/sizeof(frames[0]); i++)
+    {
+        Frame &frame = frames[i];
+        size_t size = (size_t)frame.pitch * frame.height;
+        frame.nv12 = AlignedAlloc(size * 3 / 2);
+        frame.rgb4 = AlignedAlloc(size * 4);
+        for (size_t j = 0; j < size * 4; j++)
+        {
+            frame.rgb4[j] = (uint8_t)(j * 7 + j / 251);
+            if (j < size * 3 / 2)
+            {
+                frame.nv12[j] = (uint8_t)(j * 13 + j / 127);
+            }
+        }
+        ret |= RunFrame(frame, i == 0 ? loops : 1, &checksum);
+        free(frame.nv12);
+        free(frame.rgb4);
+    }
+    printf("dispatched isa %s\n", VAImageIsaName(best));
+    // keep the loops from being optimized away
+    printf("checksum %u\n", checksum);
+    return ret;
+}
@@ -0,0 +1,194 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Compares NonMaxSuppression with the all-pairs loops it replaced in InferenceYOLO, the
+// advanced one (per class, any box of higher confidence suppresses) and the classic one
+// (greedy, across the classes), on crowded synthetic scenes, and checks the kept boxes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include "NonMaxSuppression.h"
+
+static const float IOU_THRESHOLD = 0.5f;
+
+static double IntersectionOverUnion(const VADetections &boxes, uint32_t i, uint32_t j)
+{
+    float l1 = boxes.left[i], t1 = boxes.top[i], r1 = boxes.right[i], b1 = boxes.bottom[i];
+    float l2 = boxes.left[j], t2 = boxes.top[j], r2 = boxes.right[j], b2 = boxes.bottom[j];
+    double overlappingWidth = fmin(r1, r2) - fmax(l1, l2);
+    double overlappingHeight = fmin(b1, b2) - fmax(t1, t2);
+    double intersectionArea = (overlappingWidth < 0 || overlappingHeight < 0) ? 0 : overlappingHeight * overlappingWidth;
+    double unionArea = (r1 - l1) * (b1 - t1) + (r2 - l2) * (b2 - t2) - intersectionArea;
+    return intersectionArea / unionArea;
+}
+
+static void AdvancedReference(const VADetections &boxes, std::vector<uint32_t> &keep)
+{
+    keep.clear();
+    for (uint32_t i = 0; i < boxes.Size(); ++i) {
+        bool isGoodResult = true;
+        for (uint32_t j = 0; j < boxes.Size(); ++j) {
+            if (boxes.classId[i] == boxes.classId[j] && boxes.confidence[i] < boxes.confidence[j] && IntersectionOverUnion(boxes, i, j) >= IOU_THRESHOLD) {
+                isGoodResult = false;
+                break;
+            }
+        }
+        if (isGoodResult)
+            keep.push_back(i);
+    }
+}
+
+static void ClassicReference(const VADetections &boxes, std::vector<uint32_t> &keep, std::vector<float> &confidence)
+{
+    keep.clear();
+    std::vector<uint32_t> order(boxes.Size());
+    for (uint32_t i = 0; i < boxes.Size(); ++i)
+        order[i] = i;
+    confidence = boxes.confidence;
+    std::sort(order.begin(), order.end(), [&boxes](uint32_t i, uint32_t j) { return boxes.confidence[i] > boxes.confidence[j]; });
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (confidence[order[i]] == 0)
+            continue;
+        for (size_t j = i + 1; j < order.size(); ++j)
+            if (IntersectionOverUnion(boxes, order[i], order[j]) >= IOU_THRESHOLD)
+                confidence[order[j]] = 0.0;
+        keep.push_back(order[i]);
+    }
+}
+
+static bool SameIndexes(std::vector<uint32_t> a, std::vector<uint32_t> b)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+// objects spread over the frame, each detected several times with jittered boxes and classes
+static void MakeScene(uint32_t count, uint32_t classes, std::mt19937 &rng, VADetections &boxes)
+{
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    std::normal_distribution<float> jitter(0.f, 0.01f);
+    boxes.Clear();
+    while (boxes.Size() < count)
+    {
+        float w = 0.02f + 0.1f * uniform(rng);
+        float h = 0.02f + 0.2f * uniform(rng);
+        float x = uniform(rng) * (1.f - w);
+        float y = uniform(rng) * (1.f - h);
+        int32_t c = 1 + (int32_t)(uniform(rng) * classes);
+        for (uint32_t k = 0; k < 6 && boxes.Size() < count; k++)
+        {
+            float l = std::max(0.f, x + jitter(rng));
+            float t = std::max(0.f, y + jitter(rng));
+            float r = std::min(1.f, x + w + jitter(rng));
+            float b = std::min(1.f, y + h + jitter(rng));
+            int32_t cls = uniform(rng) < 0.2f ? 1 + (int32_t)(uniform(rng) * classes) : c;
+            boxes.Push(l, t, r, b, cls, 0.3f + 0.7f * uniform(rng));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t loops = 20;
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+    }
+    if (loops == 0)
+    {
+        printf("Usage: %s [loop number]\n", argv[0]);
+        return -1;
+    }
+
+    const uint32_t counts[] = {50, 200, 1000, 4000};
+    std::mt19937 rng(42);
+    VADetections boxes;
+    std::vector<uint32_t> refKeep;
+    std::vector<uint32_t> keep;
+    std::vector<float> confidence;
+    NonMaxSuppression advanced;
+    advanced.SetIoUThreshold(IOU_THRESHOLD);
+    advanced.SetGreedy(false);
+    NonMaxSuppression classic;
+    classic.SetIoUThreshold(IOU_THRESHOLD);
+    classic.SetGreedy(true);
+    classic.SetCrossClass(true);
+    uint32_t checksum = 0;
+    int ret = 0;
+
+    printf("overlap tests with %s\n", NonMaxSuppression::Isa());
+    printf("%8s %8s %14s %14s %8s %14s %14s\n", "boxes", "kept", "advanced us", "nms us", "kept", "classic us", "nms us");
+    for (uint32_t c = 0; c < sizeof(counts)/sizeof(counts[0]); c++)
+    {
+        MakeScene(counts[c], 10, rng, boxes);
+        // the all-pairs loops get slow with many boxes
+        uint32_t refLoops = counts[c] > 1000 ? 1 : loops;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < refLoops; l++)
+            AdvancedReference(boxes, refKeep);
+        auto end = std::chrono::steady_clock::now();
+        double refAdvanced = std::chrono::duration<double, std::micro>(end - start).count() / refLoops;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+            advanced.Run(boxes, keep);
+        end = std::chrono::steady_clock::now();
+        double nmsAdvanced = std::chrono::duration<double, std::micro>(end - start).count() / loops;
+        uint32_t advancedKept = keep.size();
+        if (!SameIndexes(refKeep, keep))
+        {
+            printf("ERROR: %u boxes, advanced mode keeps %u boxes instead of %u\n", counts[c], advancedKept, (uint32_t)refKeep.size());
+            ret = -1;
+        }
+        checksum += advancedKept;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < refLoops; l++)
+            ClassicReference(boxes, refKeep, confidence);
+        end = std::chrono::steady_clock::now();
+        double refClassic = std::chrono::duration<double, std::micro>(end - start).count() / refLoops;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+            classic.Run(boxes, keep);
+        end = std::chrono::steady_clock::now();
+        double nmsClassic = std::chrono::duration<double, std::micro>(end - start).count() / loops;
+        if (!SameIndexes(refKeep, keep))
+        {
+            printf("ERROR: %u boxes, classic mode keeps %u boxes instead of %u\n", counts[c], (uint32_t)keep.size(), (uint32_t)refKeep.size());
+            ret = -1;
+        }
+        checksum += keep.size();
+
+        printf("%8u %8u %14.1f %14.1f %8u %14.1f %14.1f\n", counts[c], advancedKept, refAdvanced, nmsAdvanced,
+            (uint32_t)keep.size(), refClassic, nmsClassic);
+    }
+    // keep the loops from being optimized away
+    printf("checksum %u\n", checksum);
+    return ret;
+}
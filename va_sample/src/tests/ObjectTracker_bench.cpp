@@ -0,0 +1,196 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Moves objects across the frames of several channels, with jitter on the detected boxes, missed
+// detections and objects coming in and out, and runs a tracker per channel as the tracker block
+// does. Counts the track id switches of the objects and how many boxes still go to the
+// classification when only the new tracks, the tracks due every interval frames and the tracks
+// whose confidence dropped are classified.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "ObjectTracker.h"
+
+struct Object
+{
+    float cx, cy, w, h;     // pixels
+    float vx, vy;           // pixels per frame
+    float confidence;
+    uint32_t track;         // track id of its last detection
+    bool visible;
+};
+
+struct Scene
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t objects;
+    uint32_t interval;
+};
+
+static void Spawn(const Scene &sc, std::mt19937 &rng, Object &o)
+{
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    o.w = 40 + unit(rng) * 160;
+    o.h = 40 + unit(rng) * 160;
+    o.cx = o.w + unit(rng) * (sc.width - 2 * o.w);
+    o.cy = o.h + unit(rng) * (sc.height - 2 * o.h);
+    o.vx = (unit(rng) - 0.5f) * 12;
+    o.vy = (unit(rng) - 0.5f) * 6;
+    o.confidence = 0.6f + 0.4f * unit(rng);
+    o.track = 0;
+    o.visible = true;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t frames = 600;
+    if (argc > 1)
+    {
+        frames = atoi(argv[1]);
+    }
+    if (frames == 0)
+    {
+        printf("Usage: %s [frame number]\n", argv[0]);
+        return -1;
+    }
+
+    const Scene scenes[] = {
+        {1920, 1080, 10, 30},
+        {1920, 1080, 40, 30},
+        {3840, 2160, 100, 60},
+    };
+    const uint32_t channels = 4;
+    const float missRate = 0.05f;
+    const float jitter = 2.0f;
+    const float confidenceDrop = 0.2f;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::normal_distribution<float> noise(0.f, 1.f);
+    std::atomic<uint32_t> ids(0);
+    int ret = 0;
+
+    printf("%10s %8s %9s %10s %9s %9s %10s %12s\n", "frame", "objects", "interval", "boxes", "switches", "tracks",
+           "classified", "update us");
+    for (const Scene &sc : scenes)
+    {
+        std::vector<VAObjectTracker> trackers(channels);
+        std::vector<std::vector<Object>> objects(channels, std::vector<Object>(sc.objects));
+        for (uint32_t c = 0; c < channels; c ++)
+        {
+            trackers[c].SetFrameSize(sc.width, sc.height);
+            trackers[c].SetIdSource(&ids);
+            for (auto &o : objects[c])
+                Spawn(sc, rng, o);
+        }
+
+        uint64_t boxes = 0, switches = 0, classified = 0, newTracks = 0;
+        double updateUs = 0;
+        std::vector<float> rects;
+        std::vector<float> confidences;
+        std::vector<Object *> detected;
+        std::vector<VATrack *> tracks;
+        for (uint32_t f = 0; f < frames; f ++)
+        {
+            for (uint32_t c = 0; c < channels; c ++)
+            {
+                rects.clear();
+                confidences.clear();
+                detected.clear();
+                for (auto &o : objects[c])
+                {
+                    o.cx += o.vx;
+                    o.cy += o.vy;
+                    if (o.cx < o.w / 2 || o.cy < o.h / 2 || o.cx > sc.width - o.w / 2 || o.cy > sc.height - o.h / 2)
+                    {
+                        // left the frame, another one comes in
+                        Spawn(sc, rng, o);
+                    }
+                    if (unit(rng) < missRate)
+                        continue;
+                    float l = o.cx - o.w / 2 + noise(rng) * jitter;
+                    float t = o.cy - o.h / 2 + noise(rng) * jitter;
+                    float r = o.cx + o.w / 2 + noise(rng) * jitter;
+                    float b = o.cy + o.h / 2 + noise(rng) * jitter;
+                    rects.push_back(l / sc.width);
+                    rects.push_back(t / sc.height);
+                    rects.push_back(r / sc.width);
+                    rects.push_back(b / sc.height);
+                    // occlusions now and then lower the confidence for a few frames
+                    confidences.push_back(std::min(1.f, o.confidence + noise(rng) * 0.05f - (unit(rng) < 0.02f ? 0.3f : 0.f)));
+                    detected.push_back(&o);
+                }
+
+                uint32_t count = detected.size();
+                auto start = std::chrono::steady_clock::now();
+                if (trackers[c].Update(f, rects.data(), count, tracks))
+                {
+                    printf("ERROR: frame %u rejected\n", f);
+                    return -1;
+                }
+                auto end = std::chrono::steady_clock::now();
+                updateUs += std::chrono::duration<double, std::micro>(end - start).count();
+
+                for (uint32_t d = 0; d < count; d ++)
+                {
+                    VATrack *track = tracks[d];
+                    Object *o = detected[d];
+                    if (!track)
+                    {
+                        printf("ERROR: detection %u without track\n", d);
+                        return -1;
+                    }
+                    // a respawned object starts with track 0, its new track isn't a switch
+                    if (o->track && o->track != track->id)
+                        ++ switches;
+                    o->track = track->id;
+                    newTracks += track->hits == 1;
+                    if (VAObjectTracker::ClassifyDue(track, f, confidences[d], sc.interval, confidenceDrop))
+                    {
+                        track->classifiedFrame = f;
+                        track->classifiedConfidence = confidences[d];
+                        ++ classified;
+                    }
+                }
+                boxes += count;
+            }
+        }
+
+        uint32_t alive = 0;
+        for (auto &tracker : trackers)
+            alive += tracker.TrackNum();
+        printf("%5ux%-4u %8u %9u %10lu %9lu %9lu %9.1f%% %12.2f\n", sc.width, sc.height, sc.objects, sc.interval, boxes,
+               switches, newTracks, 100.0 * classified / boxes, updateUs / (frames * channels));
+        // the tracks of the objects still in view and the lost ones not yet dropped
+        if (alive > channels * sc.objects * 2 || switches * 100 > boxes)
+        {
+            printf("ERROR: %u tracks alive, %lu id switches\n", alive, switches);
+            ret = -1;
+        }
+    }
+    return ret;
+}
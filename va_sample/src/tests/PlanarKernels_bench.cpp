@@ -0,0 +1,272 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Compares the conversion of the super resolution outputs, FloatRGBToNV12 on one thread and
+// on the row bands of a RowBandPool, with the per pixel loop it replaced in InferenceSISR and
+// InferenceRCAN, at the 1080p and 4K outputs of a 4x upscale, and checks the pixels.
+// Then compares U8ToFloat with the merge of the RGBP planes and the per pixel split back to
+// the FP32 planes it replaced for the inputs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "PlanarKernels.h"
+#include "RowBandPool.h"
+
+inline uint8_t clip(float val)
+{
+    return (val < 0) ? 0 : ((val>255)? 255: (uint8_t)val);
+}
+
+// the loop of InferenceSISR::Translate
+static void NV12Reference(const float *curResult, uint32_t width, uint32_t height, uint8_t *outImg)
+{
+    uint32_t planeSize = width * height;
+    uint32_t alignedHeight = ((height + 15) / 16) * 16;
+    uint32_t planeSizeNV12 = alignedHeight * width;
+    memset(outImg, 0, 3 * planeSizeNV12 / 2);
+    for (size_t h = 0; h < height; h++)
+    {
+        for (size_t w = 0; w < width; w++)
+        {
+            float r = clip(curResult[0 * planeSize + h * width + w] * 255);
+            float g = clip(curResult[1 * planeSize + h * width + w] * 255);
+            float b = clip(curResult[2 * planeSize + h * width + w] * 255);
+            uint8_t y = clip( 0.257 * r + 0.504 * g + 0.098 * b +  16);
+            outImg[h * width + w] = y;
+            if (h%2 == 0 && w%2 == 0)
+            {
+                uint8_t u = clip(-0.148 * r - 0.291 * g + 0.439 * b + 128);
+                uint8_t v = clip( 0.439 * r - 0.368 * g - 0.071 * b + 128);
+                outImg[planeSizeNV12 + (h/2) * width + w + 0] = u;
+                outImg[planeSizeNV12 + (h/2) * width + w + 1] = v;
+            }
+        }
+    }
+}
+
+// the fixed point formulas the kernels must match exactly
+static void FixedPointReference(const float *rgb, uint32_t width, uint32_t height, uint8_t *y, uint8_t *uv)
+{
+    uint32_t planeSize = width * height;
+    for (uint32_t h = 0; h < height; h++)
+    {
+        for (uint32_t w = 0; w < width; w++)
+        {
+            int r = clip(rgb[h * width + w] * 255);
+            int g = clip(rgb[planeSize + h * width + w] * 255);
+            int b = clip(rgb[2 * planeSize + h * width + w] * 255);
+            y[h * width + w] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+            if (h % 2 == 0 && w % 2 == 0)
+            {
+                uv[(h / 2) * width + w] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+                uv[(h / 2) * width + w + 1] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+            }
+        }
+    }
+}
+
+// cv::merge of the RGBP planes then matU8ToBlob, as InferenceSISR::InsertImage did
+static void InputReference(const uint8_t *img, uint32_t width, uint32_t height, uint8_t *merged, float *blob)
+{
+    size_t planeSize = (size_t)width * height;
+    for (size_t i = 0; i < planeSize; i++)
+        for (uint32_t c = 0; c < 3; c++)
+            merged[i * 3 + c] = img[c * planeSize + i];
+    for (size_t c = 0; c < 3; c++)
+        for (size_t h = 0; h < height; h++)
+            for (size_t w = 0; w < width; w++)
+                blob[c * width * height + h * width + w] = merged[(h * width + w) * 3 + c];
+}
+
+// a smooth image slightly outside [0, 1], like the outputs of the models
+static void MakeImage(float *rgb, uint32_t width, uint32_t height, std::mt19937 &rng)
+{
+    std::normal_distribution<float> noise(0.f, 0.02f);
+    for (uint32_t c = 0; c < 3; c++)
+        for (uint32_t h = 0; h < height; h++)
+            for (uint32_t w = 0; w < width; w++)
+                rgb[(c * height + h) * width + w] = 0.5f + 0.55f * sinf(0.01f * w * (c + 1) + 0.013f * h) + noise(rng);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t loops = 10;
+    uint32_t threads = 0;
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        threads = atoi(argv[2]);
+    }
+    if (loops == 0)
+    {
+        printf("Usage: %s [loop number] [thread number]\n", argv[0]);
+        return -1;
+    }
+
+    struct Size { uint32_t width; uint32_t height; };
+    // 1080 is not a multiple of 16, so the NV12 buffer has padding rows, 1918 leaves a scalar tail
+    const Size sizes[] = {{1920, 1080}, {1918, 1080}, {3840, 2160}};
+    std::mt19937 rng(42);
+    RowBandPool bands(threads);
+    uint64_t checksum = 0;
+    int ret = 0;
+
+    printf("conversions with %s, %u threads\n", PlanarKernelsIsa(), bands.ThreadNum());
+    printf("%12s %14s %14s %14s %9s\n", "output", "loop ms", "kernel ms", "bands ms", "max diff");
+    for (uint32_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++)
+    {
+        uint32_t width = sizes[s].width;
+        uint32_t height = sizes[s].height;
+        uint32_t alignedHeight = (height + 15) / 16 * 16;
+        size_t size = (size_t)width * alignedHeight * 3 / 2;
+        std::vector<float> rgb((size_t)3 * width * height);
+        MakeImage(rgb.data(), width, height, rng);
+        std::vector<uint8_t> reference(size);
+        std::vector<uint8_t> exact(size, 0);
+        std::vector<uint8_t> out(size, 0);
+        uint8_t *uv = out.data() + (size_t)width * alignedHeight;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+        {
+            NV12Reference(rgb.data(), width, height, reference.data());
+            checksum += reference[l];
+        }
+        auto end = std::chrono::steady_clock::now();
+        double loopMs = std::chrono::duration<double, std::milli>(end - start).count() / loops;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+        {
+            FloatRGBToNV12(rgb.data(), width, height, 255.f, out.data(), uv, 0, height);
+            checksum += out[l];
+        }
+        end = std::chrono::steady_clock::now();
+        double kernelMs = std::chrono::duration<double, std::milli>(end - start).count() / loops;
+
+        FixedPointReference(rgb.data(), width, height, exact.data(), exact.data() + (size_t)width * alignedHeight);
+        if (out != exact)
+        {
+            printf("ERROR: %ux%u, the kernel differs from the fixed point formulas\n", width, height);
+            ret = -1;
+        }
+
+        memset(out.data(), 0, size);
+        start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+        {
+            bands.Run(height, 2, [&](uint32_t begin, uint32_t end) {
+                FloatRGBToNV12(rgb.data(), width, height, 255.f, out.data(), uv, begin, end);
+            });
+            checksum += out[l];
+        }
+        end = std::chrono::steady_clock::now();
+        double bandsMs = std::chrono::duration<double, std::milli>(end - start).count() / loops;
+        if (out != exact)
+        {
+            printf("ERROR: %ux%u, the row bands differ from the fixed point formulas\n", width, height);
+            ret = -1;
+        }
+
+        int maxDiff = 0;
+        for (size_t i = 0; i < size; i++)
+            maxDiff = std::max(maxDiff, abs((int)out[i] - (int)reference[i]));
+        // rounding instead of truncating moves a value by one at most
+        if (maxDiff > 1)
+        {
+            printf("ERROR: %ux%u, %d away from the previous conversion\n", width, height, maxDiff);
+            ret = -1;
+        }
+
+        // RGBP truncates like before, the values must be the same
+        std::vector<uint8_t> planes((size_t)3 * width * height);
+        bands.Run(height, 1, [&](uint32_t begin, uint32_t end) {
+            FloatToRGBP(rgb.data(), width, height, 3, 255.f, planes.data(), begin, end);
+        });
+        for (size_t i = 0; i < planes.size(); i++)
+        {
+            if (planes[i] != clip(rgb[i] * 255))
+            {
+                printf("ERROR: %ux%u, RGBP value %u instead of %u\n", width, height, planes[i], clip(rgb[i] * 255));
+                ret = -1;
+                break;
+            }
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%ux%u", width, height);
+        printf("%12s %14.2f %14.2f %14.2f %9d\n", name, loopMs, kernelMs, bandsMs, maxDiff);
+    }
+    // the low resolution inputs of the same upscales
+    printf("%12s %14s %14s\n", "input", "merge ms", "kernel ms");
+    for (uint32_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++)
+    {
+        uint32_t width = sizes[s].width / 4;
+        uint32_t height = sizes[s].height / 4;
+        size_t size = (size_t)3 * width * height;
+        std::vector<uint8_t> img(size);
+        for (size_t i = 0; i < size; i++)
+            img[i] = rng();
+        std::vector<uint8_t> merged(size);
+        std::vector<float> reference(size);
+        std::vector<float> blob(size);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+        {
+            InputReference(img.data(), width, height, merged.data(), reference.data());
+            checksum += reference[l];
+        }
+        auto end = std::chrono::steady_clock::now();
+        double mergeMs = std::chrono::duration<double, std::milli>(end - start).count() / loops;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+        {
+            U8ToFloat(img.data(), blob.data(), size);
+            checksum += blob[l];
+        }
+        end = std::chrono::steady_clock::now();
+        double kernelMs = std::chrono::duration<double, std::milli>(end - start).count() / loops;
+        if (blob != reference)
+        {
+            printf("ERROR: %ux%u, the input planes differ\n", width, height);
+            ret = -1;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%ux%u", width, height);
+        printf("%12s %14.3f %14.3f\n", name, mergeMs, kernelMs);
+    }
+
+    // keep the loops from being optimized away
+    printf("checksum %lu\n", checksum);
+    return ret;
+}
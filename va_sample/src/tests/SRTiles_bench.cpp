@@ -0,0 +1,181 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Splits frames in the tiles of the super resolution models, feeds SRTiles with the crops of
+// a known upscaled frame in shuffled order, as the inference requests return them, and checks
+// the blended frame comes back unchanged, and that a frame with a tile of a failed request is
+// dropped once its other tiles are in. Reports the blending time per frame.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "SRTiles.h"
+
+struct TileCase
+{
+    uint32_t frameWidth;
+    uint32_t frameHeight;
+    uint32_t tileWidth;
+    uint32_t tileHeight;
+    uint32_t overlap;
+    uint32_t scale;
+};
+
+// smooth planar frame, the blending of identical crops must give it back
+static void MakeFrame(std::vector<float> &frame, uint32_t width, uint32_t height, uint32_t channels)
+{
+    frame.resize((size_t)channels * width * height);
+    for (uint32_t c = 0; c < channels; c ++)
+        for (uint32_t y = 0; y < height; y ++)
+            for (uint32_t x = 0; x < width; x ++)
+                frame[((size_t)c * height + y) * width + x] = 0.5f + 0.4f * sinf(x * 0.01f * (c + 1) + y * 0.013f);
+}
+
+static void CropTile(const std::vector<float> &frame, uint32_t width, uint32_t height, uint32_t channels,
+                     uint32_t x0, uint32_t y0, uint32_t tileWidth, uint32_t tileHeight, std::vector<float> &tile)
+{
+    tile.resize((size_t)channels * tileWidth * tileHeight);
+    for (uint32_t c = 0; c < channels; c ++)
+        for (uint32_t y = 0; y < tileHeight; y ++)
+            std::copy_n(&frame[((size_t)c * height + y0 + y) * width + x0], tileWidth,
+                        &tile[((size_t)c * tileHeight + y) * tileWidth]);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t loops = 10;
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+    }
+    if (loops == 0)
+    {
+        printf("Usage: %s [loop number]\n", argv[0]);
+        return -1;
+    }
+
+    // the RCAN and SISR inputs on larger frames, and a frame of a single tile
+    const TileCase cases[] = {
+        {1280, 720, 640, 360, 16, 2},
+        {1920, 1080, 640, 360, 16, 2},
+        {960, 540, 480, 270, 8, 4},
+        {640, 360, 640, 360, 16, 2},
+    };
+    const uint32_t channels = 3;
+    std::mt19937 rng(42);
+    double checksum = 0;
+    int ret = 0;
+
+    printf("%10s %10s %8s %6s %12s %12s\n", "frame", "tile", "overlap", "tiles", "max error", "blend ms");
+    for (const TileCase &tc : cases)
+    {
+        TileGrid grid;
+        SRTiles tiles;
+        if (grid.Configure(tc.frameWidth, tc.frameHeight, tc.tileWidth, tc.tileHeight, tc.overlap)
+            || tiles.Configure(grid, tc.scale, channels))
+        {
+            ret = -1;
+            continue;
+        }
+        uint32_t width = tiles.OutputWidth();
+        uint32_t height = tiles.OutputHeight();
+        std::vector<float> frame;
+        MakeFrame(frame, width, height, channels);
+
+        std::vector<std::vector<float>> outputs(grid.TileNum());
+        for (uint32_t t = 0; t < grid.TileNum(); t ++)
+        {
+            uint32_t x, y;
+            grid.TileOrigin(t, &x, &y);
+            CropTile(frame, width, height, channels, x * tc.scale, y * tc.scale,
+                     tc.tileWidth * tc.scale, tc.tileHeight * tc.scale, outputs[t]);
+        }
+
+        // two frames in flight, their tiles interleaved and shuffled
+        std::vector<uint32_t> order;
+        for (uint32_t t = 0; t < 2 * grid.TileNum(); t ++)
+            order.push_back(t);
+        float maxError = 0;
+        double blendMs = 0;
+        for (uint32_t l = 0; l < loops; l ++)
+        {
+            std::shuffle(order.begin(), order.end(), rng);
+            uint32_t done = 0;
+            for (uint32_t t : order)
+            {
+                uint32_t tile = t % grid.TileNum();
+                uint32_t frameId = 2 * l + t / grid.TileNum();
+                auto start = std::chrono::steady_clock::now();
+                float *image = tiles.AddTile(0, frameId, 0, tile, outputs[tile].data());
+                auto end = std::chrono::steady_clock::now();
+                blendMs += std::chrono::duration<double, std::milli>(end - start).count();
+                if (!image)
+                    continue;
+                ++ done;
+                for (size_t i = 0; i < frame.size(); i ++)
+                    maxError = std::max(maxError, fabsf(image[i] - frame[i]));
+                checksum += image[frame.size() / 2];
+                tiles.Release(image);
+            }
+            if (done != 2)
+            {
+                printf("ERROR: %u frames blended instead of 2\n", done);
+                ret = -1;
+            }
+        }
+
+        // a tile of a failed request in the middle, the frame is dropped, its id can come again
+        uint32_t failedId = 2 * loops;
+        uint32_t dropped = 0;
+        for (uint32_t t = 0; t < grid.TileNum(); t ++)
+        {
+            if (t == grid.TileNum() / 2)
+                tiles.DropTile(0, failedId, 0, t);
+            else
+                dropped += tiles.AddTile(0, failedId, 0, t, outputs[t].data()) == nullptr;
+        }
+        float *again = nullptr;
+        for (uint32_t t = 0; t < grid.TileNum(); t ++)
+            again = tiles.AddTile(0, failedId, 0, t, outputs[t].data());
+        if (dropped + 1 != grid.TileNum() || !again)
+        {
+            printf("ERROR: the frame with a failed tile isn't dropped\n");
+            ret = -1;
+        }
+        tiles.Release(again);
+
+        if (maxError > 1e-5f)
+        {
+            printf("ERROR: %ux%u frame blended with an error of %g\n", tc.frameWidth, tc.frameHeight, maxError);
+            ret = -1;
+        }
+        printf("%5ux%-4u %5ux%-4u %8u %6u %12g %12.2f\n", tc.frameWidth, tc.frameHeight, tc.tileWidth, tc.tileHeight,
+               tc.overlap, grid.TileNum(), maxError, blendMs / (2 * loops));
+    }
+    // keep the loops from being optimized away
+    printf("checksum %f\n", checksum);
+    return ret;
+}
@@ -21,15 +21,21 @@
 */
 
 #include <stdio.h>
+#include <sched.h>
+#include <map>
 #include <memory>
 #include <string>
 
 #include "DataPacket.h"
 #include "ConnectorRR.h"
+#include "ConnectorLockFree.h"
+#include "ConnectorReorder.h"
 #include "CropThreadBlock.h"
 #include "DecodeThreadBlock.h"
 #include "InferenceThreadBlock.h"
+#include "PipelineBuilder.h"
 #include "Statistics.h"
+#include "TrackerThreadBlock.h"
 #include "logs.h"
 
 enum eSCALE_mode
@@ -56,7 +62,9 @@ enum eDETECT_type
 static int vp_ratio = 1;
 static int channel_num = 1;
 static int batch_num =1;
+static float batch_delay_ms = 0;
 std::string input_filename;
+std::string graph_filename;
 std::string model_classify;
 std::string model_detect;
 static eDETECT_type detect_type = eSSD;
@@ -67,10 +75,30 @@ static int classification_num = 1;
 static int duration = -1;
 static bool perf_test = false;
 static bool va_share = false;
+static bool zero_copy = false;
 static bool va_sync = false;
+static std::string connector_type = "rr";
+static VA_EXEC_MODE exec_mode = VA_EXEC_THREAD;
+static uint32_t worker_num = 0;
+
+// placement of the blocks of one type: decode, detect, crop or classify
+struct BlockPlacement
+{
+    std::vector<int> cpus;
+    int node = -1;
+    int policy = -1;
+    int priority = -1;
+};
+static std::map<std::string, BlockPlacement> placements;
 static int num_request = 1;
 static int num_stream = 0;
+static std::string infer_device = "GPU";
+static std::string cache_dir;
 static float dconf_threshold = 0.8;
+static float nms_iou = 0;
+static bool nms_cross_class = false;
+static int top_k = 1;
+static bool softmax = false;
 static mfxU32 codec_type = MFX_CODEC_AVC;
 static eSCALE_mode scale_mode = eSCALE_VECS;
 static eCROP_mode crop_mode = eCROP_DEFAULT;
@@ -87,10 +115,22 @@ static const uint32_t default_resnet_input_width = 224;
 static const uint32_t default_resnet_input_height = 224;
 static uint32_t dshape_width = 0;
 static uint32_t dshape_height = 0;
+// the vp frames of the detection are split in tiles of the model input when set
+static uint32_t dslice_width = 0;
+static uint32_t dslice_height = 0;
+static uint32_t dslice_overlap = 32;
+// the detected objects are tracked between the detection and the crop, the classification only
+// sees the new tracks and the ones due again
+static bool track_objects = false;
+static uint32_t track_interval = 30;
+static float track_conf_drop = 0.2;
+static float track_iou = 0.3;
+static uint32_t track_age = 5;
 
 void App_ShowUsage(void)
 {
     printf("Usage: SamplePipeline -i input.264 [<options>]\n");
+    printf("       SamplePipeline -graph pipeline.txt [-t seconds] [-exec thread|pool] [-workers num]\n");
     printf("\n");
     printf("Options:\n");
     printf("  -h, --help             Print this help\n");
@@ -106,12 +146,26 @@ void App_ShowUsage(void)
     printf("  -dshape_h height       Detection model input reshape height\n");
     printf("                           ssd default: %d\n", default_ssd_input_height);
     printf("                           yolo default: %d\n", default_yolo_input_reshape_height);
+    printf("  -dslice WxH            Detect on WxH vp frames split in overlapping tiles of the model input size\n");
+    printf("  -dslice_overlap pixels Minimum overlap of the detection tiles (default: %d)\n", dslice_overlap);
     printf("  -dconf threshold       Minimum detection output confidence, range [0-1] (default: %.1f)\n", default_dconf_threshold);
+    printf("  -nms_iou threshold     IoU threshold of the detection non maximum suppression (default: 0, the model default)\n");
+    printf("  -nms_cross_class       The detections of different classes suppress each other too\n");
+    printf("  -track                 Track the detected objects, only new tracks and the ones below are classified\n");
+    printf("  -track_interval frames Classify a tracked object again after this many frames (default: %u)\n", track_interval);
+    printf("  -track_conf_drop d     Classify a tracked object again when its detection confidence fell by d (default: %.1f)\n", track_conf_drop);
+    printf("  -track_iou threshold   Minimum IoU of a detection and the predicted box of its track (default: %.1f)\n", track_iou);
+    printf("  -track_age frames      Drop a track after this many frames without detection (default: %u)\n", track_age);
+    printf("  -topk k                Number of most likely classes reported per object, at most 5 (default: 1)\n");
+    printf("  -softmax               Turn the classification scores into probabilities with a softmax\n");
     printf("  -m_classify model      xml model file name with absolute path, no .xml needed\n");
     printf("                           default: %s\n", default_classify_model);
     printf("  -b batch_number        Batch number in the inference model (default: 1)\n");
+    printf("  -batch_delay ms        Submit a partial batch once its first frame waited ms (default: 0, wait for a full batch)\n");
     printf("  -nireq req_number      Set the inference request number (default: 1)\n");
     printf("  -nstreams stream_num   Set the inference stream number (default: 0)\n");
+    printf("  -device GPU|CPU        Inference device (default: GPU), -va_share needs GPU\n");
+    printf("  -cache_dir dir         Keep the compiled models in this directory, later runs import them\n");
     printf("  -r vp_ratio            Ratio of decoded frames to vp frames (default: 1)\n");
     printf("                           -r 0   disables vp\n");
     printf("                           -r 2   means doing vp every other frame\n");
@@ -126,11 +180,73 @@ void App_ShowUsage(void)
     printf("  -d                     Dump the inference input, raw data of decode and vp\n");
     printf("  -p                     Performance mode, don't dump the csv results\n");
     printf("  -va_share              Share surface between media and inferece\n");
+    printf("  -zero_copy             Without -va_share, the inference reads the system memory frames in place (batch 1)\n");
     printf("  -show                  Display every frame\n");
     printf("  -ssd                   ssd model thread number\n");
     printf("  -crop                  Crop thread number\n");
     printf("  -resnet                resnet thread number\n");
     printf("  -va_sync               Force vaSyncSurface() call in cropping thread block\n");
+    printf("  -connector rr|lockfree|reorder\n");
+    printf("                         Connector type between the thread blocks (default: rr)\n");
+    printf("                           reorder keeps the frames of every channel in order with several -ssd/-crop/-resnet\n");
+    printf("  -exec thread|pool      Run every block in its own thread, or the inference, track and crop blocks on a worker\n");
+    printf("                         pool, the decoders keep their thread (default: thread)\n");
+    printf("  -workers num           Worker number of the pool (default: number of cpus)\n");
+    printf("  -affinity type:[cpus][@node]\n");
+    printf("                         Run the blocks of this type on these cpus and allocate their buffers on this numa node\n");
+    printf("                           type is decode, detect, crop or classify, e.g. -affinity detect:0-7,16-23@0\n");
+    printf("  -sched type:other|fifo|rr[:priority]\n");
+    printf("                         Scheduling policy of the blocks of this type, e.g. -sched detect:fifo:10\n");
+    printf("  -graph file            Build the pipeline from this description instead of the options above\n");
+}
+
+static bool IsBlockType(const std::string &type)
+{
+    return type == "decode" || type == "detect" || type == "crop" || type == "classify";
+}
+
+// type:[cpus][@node]
+static bool ParseAffinity(const std::string &opt)
+{
+    size_t colon = opt.find(':');
+    if (colon == std::string::npos || !IsBlockType(opt.substr(0, colon)))
+        return false;
+
+    BlockPlacement &placement = placements[opt.substr(0, colon)];
+    std::string cpus = opt.substr(colon + 1);
+    size_t at = cpus.find('@');
+    if (at != std::string::npos)
+    {
+        placement.node = stoi(cpus.substr(at + 1));
+        cpus = cpus.substr(0, at);
+    }
+    placement.cpus.clear();
+    return VAThreadBlock::ParseCpuList(cpus.c_str(), placement.cpus) == 0;
+}
+
+// type:other|fifo|rr[:priority]
+static bool ParseSched(const std::string &opt)
+{
+    size_t colon = opt.find(':');
+    if (colon == std::string::npos || !IsBlockType(opt.substr(0, colon)))
+        return false;
+
+    BlockPlacement &placement = placements[opt.substr(0, colon)];
+    return VAThreadBlock::ParseSchedPolicy(opt.substr(colon + 1), &placement.policy, &placement.priority) == 0;
+}
+
+static void PlaceBlock(VAThreadBlock *block, const char *type, int index)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "%s%d", type, index);
+    block->SetName(name);
+
+    auto ite = placements.find(type);
+    if (ite == placements.end())
+        return;
+    block->SetCpus(ite->second.cpus);
+    block->SetNumaNode(ite->second.node);
+    block->SetSchedPolicy(ite->second.policy, ite->second.priority);
 }
 
 void ParseOpt(int argc, char *argv[])
@@ -157,8 +273,12 @@ void ParseOpt(int argc, char *argv[])
             channel_num = stoi(sources.at(++i));
         else if (sources.at(i) == "-b")
             batch_num = stoi(sources.at(++i));
+        else if (sources.at(i) == "-batch_delay")
+            batch_delay_ms = stof(sources.at(++i));
         else if (sources.at(i) == "-i")
             input_filename = sources.at(++i);
+        else if (sources.at(i) == "-graph")
+            graph_filename = sources.at(++i);
         else if (sources.at(i) == "-r")
             vp_ratio = stoi(sources.at(++i));
         else if (sources.at(i) == "-d")
@@ -167,8 +287,27 @@ void ParseOpt(int argc, char *argv[])
             perf_test = true;
         else if (sources.at(i) == "-va_share")
             va_share = true;
+        else if (sources.at(i) == "-zero_copy")
+            zero_copy = true;
         else if (sources.at(i) == "-va_sync")
             va_sync = true;
+        else if (sources.at(i) == "-connector")
+            connector_type = sources.at(++i);
+        else if (sources.at(i) == "-exec")
+            exec_mode = (sources.at(++i) == "pool") ? VA_EXEC_POOL : VA_EXEC_THREAD;
+        else if (sources.at(i) == "-workers")
+            worker_num = stoi(sources.at(++i));
+        else if (sources.at(i) == "-affinity" || sources.at(i) == "-sched")
+        {
+            bool affinity = (sources.at(i) == "-affinity");
+            const std::string &opt = sources.at(++i);
+            if (!(affinity ? ParseAffinity(opt) : ParseSched(opt)))
+            {
+                printf("invalid %s %s\n", affinity ? "-affinity" : "-sched", opt.c_str());
+                App_ShowUsage();
+                exit(0);
+            }
+        }
         else if (sources.at(i) == "-ssd")
             inference_num = stoi(sources.at(++i));
         else if (sources.at(i) == "-crop")
@@ -201,10 +340,59 @@ void ParseOpt(int argc, char *argv[])
         {
             dshape_height = stoul(sources.at(++i));
         }
+        else if (sources.at(i) == "-dslice")
+        {
+            if (sscanf(sources.at(++i).c_str(), "%ux%u", &dslice_width, &dslice_height) != 2)
+            {
+                printf("ERROR: invalid detection slice frame size %s\n", sources.at(i).c_str());
+                App_ShowUsage();
+                exit(0);
+            }
+        }
+        else if (sources.at(i) == "-dslice_overlap")
+        {
+            dslice_overlap = stoul(sources.at(++i));
+        }
         else if (sources.at(i) == "-dconf")
         {
             dconf_threshold = stof(sources.at(++i));
         }
+        else if (sources.at(i) == "-nms_iou")
+        {
+            nms_iou = stof(sources.at(++i));
+        }
+        else if (sources.at(i) == "-nms_cross_class")
+        {
+            nms_cross_class = true;
+        }
+        else if (sources.at(i) == "-track")
+        {
+            track_objects = true;
+        }
+        else if (sources.at(i) == "-track_interval")
+        {
+            track_interval = stoul(sources.at(++i));
+        }
+        else if (sources.at(i) == "-track_conf_drop")
+        {
+            track_conf_drop = stof(sources.at(++i));
+        }
+        else if (sources.at(i) == "-track_iou")
+        {
+            track_iou = stof(sources.at(++i));
+        }
+        else if (sources.at(i) == "-track_age")
+        {
+            track_age = stoul(sources.at(++i));
+        }
+        else if (sources.at(i) == "-topk")
+        {
+            top_k = stoi(sources.at(++i));
+        }
+        else if (sources.at(i) == "-softmax")
+        {
+            softmax = true;
+        }
         else if (sources.at(i) == "-scale")
         {
             std::string engine = sources.at(++i);
@@ -251,6 +439,14 @@ void ParseOpt(int argc, char *argv[])
         {
             num_stream = stoi(sources.at(++i));
         }
+        else if (sources.at(i) == "-device")
+        {
+            infer_device = sources.at(++i);
+        }
+        else if (sources.at(i) == "-cache_dir")
+        {
+            cache_dir = sources.at(++i);
+        }
         else
         {
             printf("unknown argument: %s\n", sources.at(i).c_str());
@@ -262,7 +458,7 @@ void ParseOpt(int argc, char *argv[])
     if (perf_test)
         dump_crop = false;
 
-    if (input_filename.empty())
+    if (input_filename.empty() && graph_filename.empty())
     {
         printf("Missing input file name!!!!!!!\n");
         App_ShowUsage();
@@ -291,26 +487,76 @@ void ParseOpt(int argc, char *argv[])
     }
 }
 
+static std::unique_ptr<VAConnector> NewConnector(uint32_t maxInput, uint32_t maxOutput, uint32_t bufferNum)
+{
+    if (connector_type == "lockfree")
+        return std::make_unique<VAConnectorLockFree>(maxInput, maxOutput, bufferNum);
+    if (connector_type == "reorder")
+        return std::make_unique<VAConnectorReorder>(maxInput, maxOutput, bufferNum);
+    return std::make_unique<VAConnectorRR>(maxInput, maxOutput, bufferNum);
+}
+
+static int RunGraph()
+{
+    PipelineBuilder builder;
+    if (builder.ParseFile(graph_filename.c_str()) || builder.Build())
+    {
+        ERRLOG("failed to build the pipeline from %s", graph_filename.c_str());
+        return -1;
+    }
+    INFO("%d blocks prepared from %s", builder.BlockNum(), graph_filename.c_str());
+
+    VAThreadBlock::SetExecutionMode(exec_mode, worker_num);
+    int ret = VAThreadBlock::RunAllThreads();
+    if (ret)
+    {
+        ERRLOG("failed to start the blocks");
+    }
+    else
+    {
+        Statistics::getInstance().ReportPeriodly(1.0, duration);
+    }
+    VAThreadBlock::StopAllThreads();
+    VADataPool::getInstance().Report();
+    return ret;
+}
+
 int main(int argc, char *argv[])
 {
     loglevel_setup();
 
     ParseOpt(argc, argv);
 
+    if (!graph_filename.empty())
+    {
+        return RunGraph();
+    }
+
     std::vector<std::unique_ptr<DecodeThreadBlock>> decodeBlocks;
     std::vector<std::unique_ptr<InferenceThreadBlock>> inferBlocks;
+    std::unique_ptr<TrackerThreadBlock> trackBlock;
+    std::unique_ptr<VATrackClasses> trackClasses;
     std::vector<std::unique_ptr<CropThreadBlock>> cropBlocks;
     std::vector<std::unique_ptr<InferenceThreadBlock>> classBlocks;
     std::vector<std::unique_ptr<VAFilePin>> filePins;
     std::vector<std::unique_ptr<VACsvWriterPin>> fileSinks;
     std::vector<std::unique_ptr<VASinkPin>> emptySinks;
 
-    std::unique_ptr<VAConnectorRR> c1 = std::make_unique<VAConnectorRR>(channel_num, inference_num, 10);
-    std::unique_ptr<VAConnectorRR> c2 = std::make_unique<VAConnectorRR>(inference_num, crop_num, 10);
-    std::unique_ptr<VAConnectorRR> c3 = std::make_unique<VAConnectorRR>(crop_num, classification_num, 10);
+    std::unique_ptr<VAConnector> c1 = NewConnector(channel_num, inference_num, 10);
+    // the tracker sits between the detection and the crop, it needs the frames of a channel in order:
+    // one detection block sends them in order, several need a reorder connector, which follows the
+    // decoder sequence so the frames left out by -r aren't waited for
+    std::unique_ptr<VAConnector> ct;
+    if (track_objects && inference_num > 1)
+        ct = std::make_unique<VAConnectorReorder>(inference_num, 1, 10);
+    else if (track_objects)
+        ct = NewConnector(inference_num, 1, 10);
+    std::unique_ptr<VAConnector> c2 = NewConnector(track_objects ? 1 : inference_num, crop_num, 10);
+    std::unique_ptr<VAConnector> c3 = NewConnector(crop_num, classification_num, 10);
 
     uint32_t decodeWidth = 0;
     uint32_t decodeHeight = 0;
+    int ret = 0;
 
     for (int i = 0; i < channel_num; i++)
     {
@@ -341,13 +587,21 @@ int main(int argc, char *argv[])
         }
         dec->SetDecodeOutputWithVP(); // when there is vp output, decode output also attached
         dec->SetVPRatio(vp_ratio);
-        dec->SetVPOutResolution(dshape_width, dshape_height);
+        if (dslice_width > 0 && dslice_height > 0)
+        {
+            dec->SetVPOutResolution(dslice_width, dslice_height);
+        }
+        else
+        {
+            dec->SetVPOutResolution(dshape_width, dshape_height);
+        }
         if (va_share)
         {
             dec->SetVPOutFormat(MFX_FOURCC_NV12);
             dec->SetVPMemOutTypeVideo(true);
         }
         dec->SetBatchSize(batch_num * 2); // two inference after
+        PlaceBlock(dec.get(), "decode", i);
         CHECK_STATUS(dec->Prepare());
         dec->GetDecodeResolution(&decodeWidth, &decodeHeight);
         if (decodeWidth == 0 || decodeHeight == 0)
@@ -370,15 +624,23 @@ int main(int argc, char *argv[])
         auto& infer = inferBlocks[i];
 
         infer->ConnectInput(c1->NewOutputPin());
-        infer->ConnectOutput(c2->NewInputPin());
+        infer->ConnectOutput(track_objects ? ct->NewInputPin() : c2->NewInputPin());
         infer->SetAsyncDepth(num_request);
         infer->SetStreamNum(num_stream);
         infer->SetBatchNum(batch_num);
+        infer->SetMaxBatchDelay((uint32_t)(batch_delay_ms * 1000));
         infer->SetModelInputReshapeWidth(dshape_width);
         infer->SetModelInputReshapeHeight(dshape_height);
         infer->SetConfidenceThreshold(dconf_threshold);
+        infer->SetNMS(nms_iou, nms_cross_class);
+        if (dslice_width > 0 && dslice_height > 0)
+        {
+            infer->SetTiling(dslice_width, dslice_height, dslice_overlap);
+        }
         infer->SetOutputRef(2);
-        infer->SetDevice("GPU");
+        infer->SetDevice(infer_device.c_str());
+        if (!cache_dir.empty())
+            infer->SetCacheDir(cache_dir.c_str());
 
         std::string model_file = model_detect+".xml";
         std::string coeff_file = model_detect+".bin";
@@ -388,10 +650,30 @@ int main(int argc, char *argv[])
         {
             infer->EnabelSharingWithVA();
         }
+        if (zero_copy)
+        {
+            infer->EnableZeroCopy();
+        }
+        PlaceBlock(infer.get(), "detect", i);
         CHECK_STATUS(infer->Prepare());
     }
     INFO("After inference  prepared");
 
+    if (track_objects)
+    {
+        trackClasses = std::make_unique<VATrackClasses>();
+        trackBlock = std::make_unique<TrackerThreadBlock>(0, trackClasses.get());
+        trackBlock->ConnectInput(ct->NewOutputPin());
+        trackBlock->ConnectOutput(c2->NewInputPin());
+        trackBlock->SetInputResolution(decodeWidth, decodeHeight);
+        trackBlock->SetIoUThreshold(track_iou);
+        trackBlock->SetMaxAge(track_age);
+        trackBlock->SetClassifyInterval(track_interval);
+        trackBlock->SetConfidenceDrop(track_conf_drop);
+        CHECK_STATUS(trackBlock->Prepare());
+        INFO("After tracker prepared");
+    }
+
     for (int i = 0; i < crop_num; i++)
     {
         cropBlocks.push_back(std::make_unique<CropThreadBlock>(i));
@@ -410,6 +692,7 @@ int main(int argc, char *argv[])
         crop->SetVASync(va_sync);
         crop->SetOutDump(dump_crop);
         crop->SetPipeFlag(crop_mode);
+        PlaceBlock(crop.get(), "crop", i);
         CHECK_STATUS(crop->Prepare());
     }
     INFO("After crop  prepared ");
@@ -438,7 +721,13 @@ int main(int argc, char *argv[])
         cla->SetAsyncDepth(num_request);
         cla->SetStreamNum(num_stream);
         cla->SetBatchNum(batch_num);
-        cla->SetDevice("GPU");
+        cla->SetMaxBatchDelay((uint32_t)(batch_delay_ms * 1000));
+        cla->SetTopK(top_k, softmax);
+        if (track_objects)
+            cla->SetTrackClasses(trackClasses.get());
+        cla->SetDevice(infer_device.c_str());
+        if (!cache_dir.empty())
+            cla->SetCacheDir(cache_dir.c_str());
 
         std::string model_file = model_classify+".xml";
         std::string coeff_file = model_classify+".bin";
@@ -449,28 +738,44 @@ int main(int argc, char *argv[])
         {
             cla->EnabelSharingWithVA();
         }
+        if (zero_copy)
+        {
+            cla->EnableZeroCopy();
+        }
+        PlaceBlock(cla.get(), "classify", i);
         CHECK_STATUS(cla->Prepare());
     }
     INFO("After classification  prepared ");
 
-    VAThreadBlock::RunAllThreads();
-    INFO("RunAllThreads");
-    Statistics::getInstance().ReportPeriodly(1.0, duration);
+    VAThreadBlock::SetExecutionMode(exec_mode, worker_num);
+    ret = VAThreadBlock::RunAllThreads();
+    if (ret)
+    {
+        ERRLOG("failed to start the blocks");
+    }
+    else
+    {
+        INFO("RunAllThreads");
+        Statistics::getInstance().ReportPeriodly(1.0, duration);
+    }
 
     VAThreadBlock::StopAllThreads();
 
     INFO("StopAllThreads ");
+    VADataPool::getInstance().Report();
 
 clean:
     decodeBlocks.clear();
     filePins.clear();
     inferBlocks.clear();
+    trackBlock.reset();
     cropBlocks.clear();
     classBlocks.clear();
+    trackClasses.reset();
     emptySinks.clear();
     fileSinks.clear();
 
     INFO("SamplePipeline test finished \n");
-    return 0;
+    return ret;
 }
 
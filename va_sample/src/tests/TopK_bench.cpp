@@ -0,0 +1,199 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Compares the classifier head of InferenceResnet50, TopKScores and SoftmaxSum, with the
+// argmax loop it replaced and with a std::partial_sort top k, for batches of 1000 class
+// outputs, and checks the classes and the probabilities.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "TopK.h"
+
+static const uint32_t CLASS_NUM = 1000;
+
+static void ArgmaxReference(const float *scores, uint32_t count, int *c, float *conf)
+{
+    *c = -1;
+    *conf = 0;
+    for (uint32_t j = 0; j < count; j ++)
+    {
+        if (scores[j] > *conf)
+        {
+            *c = j;
+            *conf = scores[j];
+        }
+    }
+}
+
+static void TopKReference(const float *scores, uint32_t count, uint32_t k, std::vector<int> &order)
+{
+    order.resize(count);
+    for (uint32_t j = 0; j < count; j ++)
+        order[j] = j;
+    std::partial_sort(order.begin(), order.begin() + k, order.end(), [scores](int a, int b) {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    });
+}
+
+// logits peaked on a few classes, with some repeated values to exercise the ties
+static void MakeScores(float *scores, uint32_t count, std::mt19937 &rng)
+{
+    std::normal_distribution<float> logit(0.f, 2.f);
+    std::uniform_int_distribution<uint32_t> pick(0, count - 1);
+    for (uint32_t j = 0; j < count; j ++)
+        scores[j] = roundf(logit(rng) * 64) / 64;
+    for (uint32_t p = 0; p < 3; p ++)
+        scores[pick(rng)] = 12.f - p;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t loops = 200;
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+    }
+    if (loops == 0)
+    {
+        printf("Usage: %s [loop number]\n", argv[0]);
+        return -1;
+    }
+
+    const uint32_t batches[] = {1, 8, 32};
+    const uint32_t ks[] = {1, 5};
+    std::mt19937 rng(42);
+    std::vector<float> scores(32 * CLASS_NUM);
+    for (uint32_t i = 0; i < 32; i ++)
+        MakeScores(&scores[i * CLASS_NUM], CLASS_NUM, rng);
+    std::vector<int> order;
+    int classes[5];
+    float topScores[5];
+    double checksum = 0;
+    int ret = 0;
+
+    // correctness on every image, including the sizes that leave a scalar tail
+    for (uint32_t i = 0; i < 32; i ++)
+    {
+        const float *image = &scores[i * CLASS_NUM];
+        uint32_t count = CLASS_NUM - i;
+        for (uint32_t k = 1; k <= 5; k ++)
+        {
+            uint32_t num = TopKScores(image, count, k, classes, topScores);
+            TopKReference(image, count, k, order);
+            for (uint32_t j = 0; j < k; j ++)
+            {
+                if (num != k || classes[j] != order[j] || topScores[j] != image[order[j]])
+                {
+                    printf("ERROR: image %u, top %u, rank %u is class %d instead of %d\n", i, k, j, classes[j], order[j]);
+                    ret = -1;
+                    break;
+                }
+            }
+        }
+        double sum = 0;
+        for (uint32_t j = 0; j < count; j ++)
+            sum += exp((double)image[j] - topScores[0]);
+        float fastSum = SoftmaxSum(image, count, topScores[0]);
+        if (fabs(fastSum - sum) > 1e-5 * sum)
+        {
+            printf("ERROR: image %u, softmax sum %f instead of %f\n", i, fastSum, sum);
+            ret = -1;
+        }
+    }
+    if (TopKScores(&scores[0], 3, 5, classes, topScores) != 3)
+    {
+        printf("ERROR: top 5 of 3 scores\n");
+        ret = -1;
+    }
+
+    printf("top k scans with %s\n", TopKIsa());
+    printf("%6s %3s %12s %14s %12s %14s\n", "batch", "k", "argmax us", "partial_sort us", "top k us", "+softmax us");
+    for (uint32_t b = 0; b < sizeof(batches)/sizeof(batches[0]); b ++)
+    {
+        uint32_t batch = batches[b];
+        for (uint32_t kk = 0; kk < sizeof(ks)/sizeof(ks[0]); kk ++)
+        {
+            uint32_t k = ks[kk];
+
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t l = 0; l < loops; l ++)
+            {
+                for (uint32_t i = 0; i < batch; i ++)
+                {
+                    ArgmaxReference(&scores[i * CLASS_NUM], CLASS_NUM, classes, topScores);
+                    checksum += classes[0];
+                }
+            }
+            auto end = std::chrono::steady_clock::now();
+            double argmax = std::chrono::duration<double, std::micro>(end - start).count() / loops;
+
+            start = std::chrono::steady_clock::now();
+            for (uint32_t l = 0; l < loops; l ++)
+            {
+                for (uint32_t i = 0; i < batch; i ++)
+                {
+                    TopKReference(&scores[i * CLASS_NUM], CLASS_NUM, k, order);
+                    checksum += order[k - 1];
+                }
+            }
+            end = std::chrono::steady_clock::now();
+            double partialSort = std::chrono::duration<double, std::micro>(end - start).count() / loops;
+
+            start = std::chrono::steady_clock::now();
+            for (uint32_t l = 0; l < loops; l ++)
+            {
+                for (uint32_t i = 0; i < batch; i ++)
+                {
+                    TopKScores(&scores[i * CLASS_NUM], CLASS_NUM, k, classes, topScores);
+                    checksum += classes[k - 1];
+                }
+            }
+            end = std::chrono::steady_clock::now();
+            double topK = std::chrono::duration<double, std::micro>(end - start).count() / loops;
+
+            start = std::chrono::steady_clock::now();
+            for (uint32_t l = 0; l < loops; l ++)
+            {
+                for (uint32_t i = 0; i < batch; i ++)
+                {
+                    const float *image = &scores[i * CLASS_NUM];
+                    uint32_t num = TopKScores(image, CLASS_NUM, k, classes, topScores);
+                    float sum = SoftmaxSum(image, CLASS_NUM, topScores[0]);
+                    for (uint32_t j = 0; j < num; j ++)
+                        checksum += exp(topScores[j] - topScores[0]) / sum;
+                }
+            }
+            end = std::chrono::steady_clock::now();
+            double softmax = std::chrono::duration<double, std::micro>(end - start).count() / loops;
+
+            printf("%6u %3u %12.2f %14.2f %12.2f %14.2f\n", batch, k, argmax, partialSort, topK, softmax);
+        }
+    }
+    // keep the loops from being optimized away
+    printf("checksum %f\n", checksum);
+    return ret;
+}
@@ -0,0 +1,219 @@
+/*
+* Copyright (c) 2019, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Compares the YOLO region decoding with the loop it replaced, which computes the sigmoid
+// of every objectness score and looks up every entry with CalculateEntryIndex, on synthetic
+// YOLOv4 416x416 outputs, and checks that both find the same boxes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include "YOLODecode.h"
+
+static const int CLASSES = 80;
+static const int ANCHORS = 3;
+static const int COORDS = 4;
+static const uint32_t INPUT_SIZE = 416;
+
+static inline float sigmoid(float x) {
+    return 1.f / (1.f + std::exp(-x));
+}
+
+static int CalculateEntryIndex(int totalCells, int lcoords, int lclasses, int location, int entry)
+{
+    int n = location / totalCells;
+    int loc = location % totalCells;
+    return (n * (lcoords + lclasses + 1) + entry) * totalCells + loc;
+}
+
+static void DecodeReference(const float *curResult, const YOLORegionLayout &region, float threshold, VADetections &boxes)
+{
+    int sideW = region.sideW;
+    int sideH = region.sideH;
+    int entriesNum = sideW * sideH;
+    for (int i = 0; i < entriesNum; ++i) {
+        int row = i / sideW;
+        int col = i % sideW;
+        for (int n = 0; n < region.num; ++n) {
+            int obj_index = CalculateEntryIndex(entriesNum, region.coords, region.classes, n * entriesNum + i, region.coords);
+            int box_index = CalculateEntryIndex(entriesNum, region.coords, region.classes, n * entriesNum + i, 0);
+            float scale = sigmoid(curResult[obj_index]);
+            if (scale >= threshold) {
+                double x = (col + sigmoid(curResult[box_index + 0 * entriesNum])) / sideW;
+                double y = (row + sigmoid(curResult[box_index + 1 * entriesNum])) / sideH;
+                double height = std::exp(curResult[box_index + 3 * entriesNum]) * region.anchors[2 * n + 1] / INPUT_SIZE;
+                double width = std::exp(curResult[box_index + 2 * entriesNum]) * region.anchors[2 * n] / INPUT_SIZE;
+
+                float l = (float)(x - width / 2);
+                float t = (float)(y - height / 2);
+                float r = (float)(x + width / 2);
+                float b = (float)(y + height / 2);
+                if (l < 0.0) l = 0.0;
+                if (t < 0.0) t = 0.0;
+                if (r > 1.0) r = 1.0;
+                if (b > 1.0) b = 1.0;
+
+                for (int j = 0; j < region.classes; ++j) {
+                    int class_index = CalculateEntryIndex(entriesNum, region.coords, region.classes, n * entriesNum + i, region.coords + 1 + j);
+                    float prob = scale * sigmoid(curResult[class_index]);
+                    if (prob >= threshold) {
+                        boxes.Push(l, t, r, b, j + 1, prob);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// the same boxes in any order, the decoding visits the anchors before the cells
+static bool SameBoxes(const VADetections &a, const VADetections &b)
+{
+    if (a.Size() != b.Size())
+    {
+        return false;
+    }
+    std::vector<bool> matched(b.Size(), false);
+    for (size_t i = 0; i < a.Size(); i++)
+    {
+        bool found = false;
+        for (size_t j = 0; j < b.Size() && !found; j++)
+        {
+            if (!matched[j] && a.left[i] == b.left[j] && a.top[i] == b.top[j] && a.right[i] == b.right[j] &&
+                a.bottom[i] == b.bottom[j] && a.classId[i] == b.classId[j] && a.confidence[i] == b.confidence[j])
+            {
+                matched[j] = found = true;
+            }
+        }
+        if (!found)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t loops = 100;
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+    }
+    if (loops == 0)
+    {
+        printf("Usage: %s [loop number]\n", argv[0]);
+        return -1;
+    }
+
+    // YOLOv4 anchors of the 52x52, 26x26 and 13x13 outputs
+    const float anchors[3][ANCHORS * 2] = {
+        {12.0f, 16.0f, 19.0f, 36.0f, 40.0f, 28.0f},
+        {36.0f, 75.0f, 76.0f, 55.0f, 72.0f, 146.0f},
+        {142.0f, 110.0f, 192.0f, 243.0f, 459.0f, 401.0f}};
+    const int sides[3] = {52, 26, 13};
+
+    // trained networks give a low objectness to nearly all the cells, a few percent get close to the threshold
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coordDist(-2.f, 2.f);
+    std::uniform_real_distribution<float> backgroundDist(-12.f, -3.f);
+    std::uniform_real_distribution<float> objectDist(-1.f, 5.f);
+    std::uniform_real_distribution<float> classDist(-8.f, 3.f);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+
+    std::vector<float> outputs[3];
+    YOLORegionLayout layouts[3];
+    for (int o = 0; o < 3; o++)
+    {
+        uint32_t entriesNum = sides[o] * sides[o];
+        outputs[o].resize(entriesNum * ANCHORS * (COORDS + 1 + CLASSES));
+        for (int n = 0; n < ANCHORS; n++)
+        {
+            float *anchor = outputs[o].data() + n * entriesNum * (COORDS + 1 + CLASSES);
+            for (uint32_t i = 0; i < entriesNum * COORDS; i++)
+            {
+                anchor[i] = coordDist(rng);
+            }
+            for (uint32_t i = 0; i < entriesNum; i++)
+            {
+                anchor[COORDS * entriesNum + i] = uniform(rng) < 0.02f ? objectDist(rng) : backgroundDist(rng);
+            }
+            for (uint32_t i = 0; i < entriesNum * CLASSES; i++)
+            {
+                anchor[(COORDS + 1) * entriesNum + i] = classDist(rng);
+            }
+        }
+        layouts[o].num = ANCHORS;
+        layouts[o].classes = CLASSES;
+        layouts[o].coords = COORDS;
+        layouts[o].sideW = sides[o];
+        layouts[o].sideH = sides[o];
+        layouts[o].anchors = anchors[o];
+    }
+
+    const float thresholds[] = {0.2f, 0.5f, 0.8f};
+    VADetections refBoxes;
+    VADetections boxes;
+    std::vector<uint32_t> cells;
+    uint32_t checksum = 0;
+    int ret = 0;
+    printf("decoding with %s\n", YOLODecodeIsa());
+    printf("%10s %8s %16s %16s\n", "threshold", "boxes", "reference us", "decode us");
+    for (uint32_t t = 0; t < sizeof(thresholds)/sizeof(thresholds[0]); t++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+        {
+            refBoxes.Clear();
+            for (int o = 0; o < 3; o++)
+            {
+                DecodeReference(outputs[o].data(), layouts[o], thresholds[t], refBoxes);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        double refTime = std::chrono::duration<double, std::micro>(end - start).count() / loops;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t l = 0; l < loops; l++)
+        {
+            boxes.Clear();
+            for (int o = 0; o < 3; o++)
+            {
+                YOLODecodeRegion(outputs[o].data(), layouts[o], INPUT_SIZE, INPUT_SIZE, thresholds[t], boxes, cells);
+            }
+        }
+        end = std::chrono::steady_clock::now();
+        double decodeTime = std::chrono::duration<double, std::micro>(end - start).count() / loops;
+
+        printf("%10.2f %8u %16.1f %16.1f\n", thresholds[t], (uint32_t)boxes.Size(), refTime, decodeTime);
+        if (!SameBoxes(refBoxes, boxes))
+        {
+            printf("ERROR: the boxes differ from the reference at threshold %.2f\n", thresholds[t]);
+            ret = -1;
+        }
+        checksum += boxes.Size();
+    }
+    // keep the loops from being optimized away
+    printf("checksum %u\n", checksum);
+    return ret;
+}